@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <Util/exceptions.h>
+#include <Util/fileIO.h>
 #include "bmp.h"
 
 typedef char BYTE;					/* 8 bits */
@@ -239,21 +240,20 @@ namespace Image
 		}
 	}
 
-	void BMPWriteImage( const Image32& img , FILE *fp )
+	/* Writes the file and info headers of a width x height image, returning the (padded) length of a row */
+	static int BMPWriteHeader( int width , int height , FILE *fp )
 	{
 		BITMAPFILEHEADER bmfh;
 		BITMAPINFOHEADER bmih;
-		int x, y;
 		int lineLength;
-		Pixel32 p;
 
-		lineLength = img.width() * 3;	/* RGB */
+		lineLength = width * 3;	/* RGB */
 		if( (lineLength % 4)!=0 ) lineLength = (lineLength / 4 + 1) * 4;
 
 		/* Write file header */
 
 		bmfh.bfType = BMP_BF_TYPE;
-		bmfh.bfSize = BMP_BF_OFF_BITS + lineLength * img.height();
+		bmfh.bfSize = BMP_BF_OFF_BITS + lineLength * height;
 		bmfh.bfReserved1 = 0;
 		bmfh.bfReserved2 = 0;
 		bmfh.bfOffBits = BMP_BF_OFF_BITS;
@@ -267,8 +267,8 @@ namespace Image
 		/* Write info header */
 
 		bmih.biSize = BMP_BI_SIZE;
-		bmih.biWidth = img.width();
-		bmih.biHeight = img.height();
+		bmih.biWidth = width;
+		bmih.biHeight = height;
 		bmih.biPlanes = 1;
 		bmih.biBitCount = 24;		/* RGB */
 		bmih.biCompression = BI_RGB;	/* RGB */
@@ -290,6 +290,16 @@ namespace Image
 		DWordWriteLE( bmih.biClrUsed , fp );
 		DWordWriteLE( bmih.biClrImportant , fp );
 
+		return lineLength;
+	}
+
+	void BMPWriteImage( const Image32& img , FILE *fp )
+	{
+		int x, y;
+		Pixel32 p;
+
+		BMPWriteHeader( img.width() , img.height() , fp );
+
 		/* Write pixels */
 		for( y=0 ; y<img.height() ; y++ )
 		{
@@ -331,4 +341,39 @@ namespace Image
 		BMPWriteImage( img , fp );
 		fclose(fp);
 	}
-}
\ No newline at end of file
+
+	///////////////
+	// BMPWriter //
+	///////////////
+	BMPWriter::BMPWriter( std::string fileName , int width , int height ) : ImageWriter( width , height )
+	{
+		_fp = fopen( fileName.c_str() , "wb" );
+		if( !_fp ) THROW( "Could not open file for writing: %s" , fileName.c_str() );
+		_lineLength = BMPWriteHeader( width , height , _fp );
+		_line.resize( _lineLength , 0 );
+	}
+
+	BMPWriter::~BMPWriter( void ){ if( _fp ) fclose( _fp ); }
+
+	void BMPWriter::_writeRows( const Image32 &rows , int y )
+	{
+		for( int j=0 ; j<rows.height() ; j++ )
+		{
+			for( int x=0 ; x<rows.width() ; x++ )
+			{
+				const Pixel32 &p = rows( x , j );
+				_line[3*x+0] = p.b , _line[3*x+1] = p.g , _line[3*x+2] = p.r;
+			}
+			/* The rows are stored bottom-up, so each one is written into place */
+			if( Util::Seek( _fp , BMP_BF_OFF_BITS + (long long)_lineLength * ( height()-1-(y+j) ) ) ) THROW( "Failed to seek to row: %d" , y+j );
+			if( fwrite( &_line[0] , 1 , _lineLength , _fp )!=_lineLength ) THROW( "Failed to write row: %d" , y+j );
+		}
+	}
+
+	void BMPWriter::_finish( void )
+	{
+		int error = fclose( _fp );
+		_fp = NULL;
+		if( error ) THROW( "Failed to close file" );
+	}
+}
@@ -14,5 +14,28 @@ namespace Image
 	void BMPWriteImage( const Image32& img , std::string fileName );
 	/** This function writes out a BMP file, returning 0 on failure.*/
 	void BMPWriteImage( const Image32& img , FILE *fp );
+
+	/** This class writes out a BMP file incrementally. The headers are written when the file is opened,
+	* and since BMP files store the rows bottom-up, each band of rows is written into place as it arrives.*/
+	class BMPWriter : public ImageWriter
+	{
+		/** The file being written */
+		FILE *_fp;
+
+		/** The length of a row in the file, padded to a multiple of four bytes */
+		int _lineLength;
+
+		/** The buffer in which a row is encoded */
+		std::vector< unsigned char > _line;
+	protected:
+		void _writeRows( const Image32 &rows , int y );
+		void _finish( void );
+	public:
+		/** The constructor opens the file and writes out the headers for an image of the prescribed dimensions */
+		BMPWriter( std::string fileName , int width , int height );
+
+		/** The destructor closes the file, if it has not been finished */
+		~BMPWriter( void );
+	};
 }
 #endif // BMP_INCLUDED
@@ -0,0 +1,365 @@
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <algorithm>
+#include <Util/exceptions.h>
+#include "convolution.h"
+#include "image.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONVOLUTION_USE_SSE
+#include <emmintrin.h>
+#endif // __SSE2__ || _M_X64 || _M_IX86_FP
+
+using namespace Util;
+using namespace Image;
+
+namespace {
+	/** The largest number of fractional bits with which weights are quantized */
+	const int MaxFractionBits = 14;
+
+	/** The largest magnitudes of 16-bit and 32-bit signed integers */
+	const int MaxInt16 = 32767;
+	const double MaxInt32 = 2147483647.;
+
+	/** This function returns the index of the pixel sampled at position i along an axis of n pixels, or -1 if a zero pixel is sampled */
+	int BorderIndex(int i, int n, BorderMode mode) {
+		if (i >= 0 && i < n) return i;
+		switch (mode) {
+		case BORDER_CLAMP:
+			return i < 0 ? 0 : n - 1;
+		case BORDER_MIRROR: {
+			if (n == 1) return 0;
+			const int period = 2 * n - 2;
+			i %= period;
+			if (i < 0) i += period;
+			return i < n ? i : period - i;
+		}
+		case BORDER_WRAP:
+			return (i % n + n) % n;
+		default:
+			return -1;
+		}
+	}
+
+	/** This class stores weights quantized to 16-bit integers with a common number of fractional bits.
+	*** The weights are laid out in rows, each padded with a zero weight to an even length so that the taps can be applied in pairs. */
+	struct QuantizedWeights {
+		/** The number of rows and the (padded) length of each row */
+		int rowNum, rowLength;
+
+		/** The number of fractional bits */
+		int shift;
+
+		/** The quantized weights */
+		std::vector<int> weights;
+
+		/** The constructor quantizes the width x height weights, which are to be applied to values of magnitude at most maxValue, with at least minShift fractional bits (where possible).
+		*** The fewest fractional bits with which the weights are exact are used. Failing that, the weights are rounded with the most fractional bits for which
+		*** they fit in 16 bits and the sums of their products with the values fit in 32 bits, and the largest weight is nudged so that the sum of the weights is preserved. */
+		QuantizedWeights(int width, int height, const std::vector<double>& w, int maxValue, int minShift = 0);
+
+		/** This method returns the weights of the prescribed row */
+		const int* row(int r) const { return &weights[static_cast<size_t>(r) * rowLength]; }
+
+		/** This method returns the largest magnitude of the sum of the products of the weights with values of magnitude at most maxValue */
+		long long bound(int maxValue) const;
+	};
+
+	QuantizedWeights::QuantizedWeights(int width, int height, const std::vector<double>& w, int maxValue, int minShift)
+		: rowNum(height), rowLength(width + (width & 1)), shift(-1) {
+		double maxWeight = 0, absSum = 0, sum = 0;
+		for (size_t i = 0; i < w.size(); i++) maxWeight = std::max(maxWeight, fabs(w[i])), absSum += fabs(w[i]), sum += w[i];
+
+		// Leave room for the rounding and the nudge, which change each weight by at most half of its count
+		int maxShift = MaxFractionBits;
+		while (maxShift >= 0 && (ldexp(maxWeight, maxShift) + w.size() > MaxInt16 ||
+		                         (ldexp(absSum, maxShift) + 2. * w.size()) * maxValue > MaxInt32))
+			maxShift--;
+		if (maxShift < 0) THROW("kernel weights are too large for fixed-point convolution");
+
+		std::vector<int> q(w.size());
+		for (int s = std::min(std::max(minShift, 0), maxShift); s <= maxShift && shift < 0; s++) {
+			bool exact = true;
+			for (size_t i = 0; i < w.size() && exact; i++) exact = ldexp(w[i], s) == floor(ldexp(w[i], s));
+			if (exact) shift = s;
+		}
+		if (shift >= 0)
+			for (size_t i = 0; i < w.size(); i++) q[i] = static_cast<int>(ldexp(w[i], shift));
+		else {
+			shift = maxShift;
+			size_t largest = 0;
+			long long qSum = 0;
+			for (size_t i = 0; i < w.size(); i++) {
+				q[i] = static_cast<int>(floor(ldexp(w[i], shift) + 0.5));
+				qSum += q[i];
+				if (fabs(w[i]) > fabs(w[largest])) largest = i;
+			}
+			q[largest] += static_cast<int>(static_cast<long long>(floor(ldexp(sum, shift) + 0.5)) - qSum);
+		}
+
+		weights.assign(static_cast<size_t>(rowNum) * rowLength, 0);
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++) weights[static_cast<size_t>(y) * rowLength + x] = q[static_cast<size_t>(y) * width + x];
+	}
+
+	long long QuantizedWeights::bound(int maxValue) const {
+		long long sum = 0;
+		for (size_t i = 0; i < weights.size(); i++) sum += std::abs(weights[i]);
+		return sum * maxValue;
+	}
+
+	/** This function returns the pixel that is zero in all channels (unlike the default pixel, which is opaque) */
+	inline Pixel32 ZeroPixel(void) {
+		Pixel32 p;
+		p.a = 0;
+		return p;
+	}
+
+	/** This function writes out the row of pixels extended by radius pixels on either side, as prescribed by the border mode, followed by a zero pixel */
+	void PadRow(const Pixel32* row, int width, int radius, BorderMode mode, Pixel32* padded) {
+		memcpy(padded + radius, row, sizeof(Pixel32) * width);
+		for (int i = 0; i < radius; i++) {
+			const int left = BorderIndex(i - radius, width, mode), right = BorderIndex(width + i, width, mode);
+			padded[i] = left < 0 ? ZeroPixel() : row[left];
+			padded[radius + width + i] = right < 0 ? ZeroPixel() : row[right];
+		}
+		padded[width + 2 * radius] = ZeroPixel();
+	}
+
+	/** These functions return the channels of a pixel */
+	inline const unsigned char* Channels(const Pixel32* p) { return reinterpret_cast<const unsigned char*>(p); }
+	inline unsigned char* Channels(Pixel32* p) { return reinterpret_cast<unsigned char*>(p); }
+
+#ifdef CONVOLUTION_USE_SSE
+	/** The sums of the products of the weights with the four channels, one per 32-bit lane */
+	typedef __m128i Sums;
+
+	inline Sums Zero(void) { return _mm_setzero_si128(); }
+
+	/** These functions return the channels of two pixels, interleaved as 16-bit values */
+	inline __m128i Interleave(const unsigned char* p0, const unsigned char* p1) {
+		int i0, i1;
+		memcpy(&i0, p0, sizeof(int)), memcpy(&i1, p1, sizeof(int));
+		return _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(i0), _mm_cvtsi32_si128(i1)), _mm_setzero_si128());
+	}
+
+	inline __m128i Interleave(const int16_t* p0, const int16_t* p1) {
+		return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p0)),
+		                          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p1)));
+	}
+
+	/** This function adds the products of the (even number of) weights with the pixels, stride channels apart, starting at the prescribed one.
+	*** Each pair of taps is applied with a single multiply-add of the interleaved channels with the interleaved weights. */
+	template <typename Channel>
+	inline Sums Accumulate(Sums sums, const Channel* p, ptrdiff_t stride, const int* w, int length) {
+		for (int t = 0; t < length; t += 2) {
+			const __m128i weights = _mm_set1_epi32(static_cast<int>((static_cast<unsigned int>(w[t + 1]) << 16) |
+			                                                        (static_cast<unsigned int>(w[t]) & 0xFFFF)));
+			sums = _mm_add_epi32(sums, _mm_madd_epi16(Interleave(p + t * stride, p + (t + 1) * stride), weights));
+		}
+		return sums;
+	}
+
+	/** These functions drop the prescribed number of fractional bits from the sums and write them out, clamped to the range of the channels */
+	inline void Store(Sums sums, int shift, unsigned char* out) {
+		const __m128i values = _mm_sra_epi32(sums, _mm_cvtsi32_si128(shift));
+		const int packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(values, values), _mm_setzero_si128()));
+		memcpy(out, &packed, sizeof(int));
+	}
+
+	inline void Store(Sums sums, int shift, int16_t* out) {
+		const __m128i values = _mm_sra_epi32(sums, _mm_cvtsi32_si128(shift));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packs_epi32(values, values));
+	}
+#else // !CONVOLUTION_USE_SSE
+	/** The sums of the products of the weights with the four channels */
+	struct Sums {
+		int c[4];
+	};
+
+	inline Sums Zero(void) {
+		Sums sums = {{0, 0, 0, 0}};
+		return sums;
+	}
+
+	/** This function adds the products of the weights with the pixels, stride channels apart, starting at the prescribed one */
+	template <typename Channel>
+	inline Sums Accumulate(Sums sums, const Channel* p, ptrdiff_t stride, const int* w, int length) {
+		for (int t = 0; t < length; t++)
+			for (int c = 0; c < 4; c++) sums.c[c] += w[t] * p[t * stride + c];
+		return sums;
+	}
+
+	/** These functions drop the prescribed number of fractional bits from the sums and write them out, clamped to the range of the channels */
+	inline void Store(Sums sums, int shift, unsigned char* out) {
+		for (int c = 0; c < 4; c++) out[c] = static_cast<unsigned char>(std::min(std::max(sums.c[c] >> shift, 0), 255));
+	}
+
+	inline void Store(Sums sums, int shift, int16_t* out) {
+		for (int c = 0; c < 4; c++) out[c] = static_cast<int16_t>(std::min(std::max(sums.c[c] >> shift, -MaxInt16 - 1), MaxInt16));
+	}
+#endif // CONVOLUTION_USE_SSE
+
+	/** This function convolves the image with the kernel directly, applying all its weights to each pixel */
+	void Convolve(const Pixel32* in, int width, int height, const ConvolutionKernel& kernel, BorderMode mode, Pixel32* out) {
+		const int kw = kernel.width(), kh = kernel.height(), rx = kw / 2, ry = kh / 2;
+
+		// The kernel is flipped, so that the convolution can be computed as a correlation
+		std::vector<double> flipped(static_cast<size_t>(kw) * kh);
+		for (int y = 0; y < kh; y++)
+			for (int x = 0; x < kw; x++) flipped[static_cast<size_t>(y) * kw + x] = kernel(kw - 1 - x, kh - 1 - y);
+		const QuantizedWeights weights(kw, kh, flipped, 255);
+
+		const size_t paddedWidth = width + 2 * rx + 1;
+		ParallelForRows(width, height, [&](int y0, int y1) {
+			// The padded rows of the band, and of the margins above and below it
+			std::vector<Pixel32> rows((y1 - y0 + 2 * ry) * paddedWidth);
+			for (int r = 0; r < y1 - y0 + 2 * ry; r++) {
+				const int y = BorderIndex(y0 - ry + r, height, mode);
+				if (y < 0) std::fill(rows.begin() + r * paddedWidth, rows.begin() + (r + 1) * paddedWidth, ZeroPixel());
+				else PadRow(in + static_cast<size_t>(y) * width, width, rx, mode, &rows[r * paddedWidth]);
+			}
+			for (int y = y0; y < y1; y++)
+				for (int x = 0; x < width; x++) {
+					Sums sums = Zero();
+					for (int j = 0; j < kh; j++)
+						sums = Accumulate(sums, Channels(&rows[(y - y0 + j) * paddedWidth + x]), 4, weights.row(j), weights.rowLength);
+					Store(sums, weights.shift, Channels(out + static_cast<size_t>(y) * width + x));
+				}
+		});
+	}
+
+	/** This function convolves the image with a separable kernel, filtering the rows with the row factor and then the columns of the result with the column factor.
+	*** The filtered rows are stored with 16 bits per channel, so fractional bits are dropped if the row factor's sums would not fit,
+	*** and the column factor is quantized with enough fractional bits to restore them. */
+	void ConvolveSeparable(const Pixel32* in, int width, int height, const ConvolutionKernel& kernel, BorderMode mode, Pixel32* out) {
+		const int kw = kernel.width(), kh = kernel.height(), rx = kw / 2, ry = kh / 2;
+
+		// The factors are flipped, so that the convolution can be computed as a correlation
+		const std::vector<double> rowFactor(kernel.rowWeights().rbegin(), kernel.rowWeights().rend());
+		const std::vector<double> columnFactor(kernel.columnWeights().rbegin(), kernel.columnWeights().rend());
+		const QuantizedWeights rowWeights(kw, 1, rowFactor, 255);
+		int rowShift = 0;
+		while (rowWeights.bound(255) > (static_cast<long long>(MaxInt16) << rowShift)) rowShift++;
+		const QuantizedWeights columnWeights(kh, 1, columnFactor, MaxInt16, rowShift - rowWeights.shift);
+		const int shift = rowWeights.shift - rowShift + columnWeights.shift;
+		if (shift < 0) THROW("kernel weights are too large for fixed-point convolution");
+
+		const size_t stride = static_cast<size_t>(width) * 4;
+		ParallelForRows(width, height, [&](int y0, int y1) {
+			const int rowNum = y1 - y0 + 2 * ry;
+			std::vector<Pixel32> padded(width + 2 * rx + 1);
+
+			// The filtered rows of the band, and of the margins above and below it, followed by a zero row
+			std::vector<int16_t> filtered((rowNum + 1) * stride, 0);
+			for (int r = 0; r < rowNum; r++) {
+				const int y = BorderIndex(y0 - ry + r, height, mode);
+				if (y < 0) continue;
+				PadRow(in + static_cast<size_t>(y) * width, width, rx, mode, &padded[0]);
+				for (int x = 0; x < width; x++)
+					Store(Accumulate(Zero(), Channels(&padded[x]), 4, rowWeights.row(0), rowWeights.rowLength), rowShift,
+					      &filtered[r * stride + 4 * x]);
+			}
+			for (int y = y0; y < y1; y++)
+				for (int x = 0; x < width; x++)
+					Store(Accumulate(Zero(), &filtered[(y - y0) * stride + 4 * x], stride, columnWeights.row(0), columnWeights.rowLength), shift,
+					      Channels(out + static_cast<size_t>(y) * width + x));
+		});
+	}
+
+	/** This function returns the weights of the rows in row-major order, checking that the rows have the same length */
+	std::vector<double> Flatten(const std::vector<std::vector<double>>& rows) {
+		std::vector<double> weights;
+		for (size_t r = 0; r < rows.size(); r++) {
+			if (rows[r].size() != rows[0].size())
+				THROW("kernel rows have different lengths: %d != %d", static_cast<int>(rows[r].size()), static_cast<int>(rows[0].size()));
+			weights.insert(weights.end(), rows[r].begin(), rows[r].end());
+		}
+		return weights;
+	}
+}
+
+///////////////////////
+// ConvolutionKernel //
+///////////////////////
+const double ConvolutionKernel::SeparabilityTolerance = 1e-9;
+
+ConvolutionKernel::ConvolutionKernel(void) : _width(1), _height(1), _weights(1, 1.) { _factor(); }
+
+ConvolutionKernel::ConvolutionKernel(int width, int height, const std::vector<double>& weights)
+	: _width(width), _height(height), _weights(weights) {
+	if (width <= 0 || height <= 0 || !(width & 1) || !(height & 1))
+		THROW("kernel dimensions must be odd: %d x %d", width, height);
+	if (weights.size() != static_cast<size_t>(width) * height)
+		THROW("number of weights does not match the kernel dimensions: %d != %d x %d", static_cast<int>(weights.size()), width,
+		      height);
+	_factor();
+}
+
+ConvolutionKernel::ConvolutionKernel(const std::vector<std::vector<double>>& rows)
+	: ConvolutionKernel(rows.empty() ? 0 : static_cast<int>(rows[0].size()), static_cast<int>(rows.size()), Flatten(rows)) {}
+
+void ConvolutionKernel::_factor(void) {
+	_rowWeights.clear(), _columnWeights.clear();
+
+	// A separable kernel is the outer product of the column through its largest weight (divided by that weight) and the row through it
+	size_t largest = 0;
+	for (size_t i = 0; i < _weights.size(); i++)
+		if (fabs(_weights[i]) > fabs(_weights[largest])) largest = i;
+	const double maxWeight = fabs(_weights[largest]);
+	if (!maxWeight) return;
+	const int px = static_cast<int>(largest % _width), py = static_cast<int>(largest / _width);
+
+	std::vector<double> row(_width), column(_height);
+	for (int x = 0; x < _width; x++) row[x] = (*this)(x, py);
+	for (int y = 0; y < _height; y++) column[y] = (*this)(px, y) / (*this)(px, py);
+	for (int y = 0; y < _height; y++)
+		for (int x = 0; x < _width; x++)
+			if (fabs((*this)(x, y) - column[y] * row[x]) > SeparabilityTolerance * maxWeight) return;
+	_rowWeights = row, _columnWeights = column;
+}
+
+ConvolutionKernel ConvolutionKernel::Separable(const std::vector<double>& rowWeights, const std::vector<double>& columnWeights) {
+	std::vector<double> weights(rowWeights.size() * columnWeights.size());
+	for (size_t y = 0; y < columnWeights.size(); y++)
+		for (size_t x = 0; x < rowWeights.size(); x++) weights[y * rowWeights.size() + x] = columnWeights[y] * rowWeights[x];
+	ConvolutionKernel kernel(static_cast<int>(rowWeights.size()), static_cast<int>(columnWeights.size()), weights);
+	// Use the factors as given, rather than those recovered from their product
+	if (kernel.separable()) kernel._rowWeights = rowWeights, kernel._columnWeights = columnWeights;
+	return kernel;
+}
+
+ConvolutionKernel ConvolutionKernel::Box(int radius) {
+	if (radius < 0) THROW("kernel radius must be non-negative: %d", radius);
+	const std::vector<double> weights(2 * radius + 1, 1. / (2 * radius + 1));
+	return Separable(weights, weights);
+}
+
+ConvolutionKernel ConvolutionKernel::Gaussian(double variance, int radius) {
+	if (radius < 0) THROW("kernel radius must be non-negative: %d", radius);
+	if (variance <= 0) THROW("variance must be positive: %g", variance);
+	std::vector<double> weights(2 * radius + 1);
+	double sum = 0;
+	for (int i = -radius; i <= radius; i++) sum += weights[i + radius] = exp(-0.5 * i * i / variance);
+	for (size_t i = 0; i < weights.size(); i++) weights[i] /= sum;
+	return Separable(weights, weights);
+}
+
+/////////////
+// Image32 //
+/////////////
+Image32 Image32::convolve(const ConvolutionKernel& kernel, BorderMode borderMode, bool convolveAlpha) const {
+	Image32 out;
+	out.setSize(_width, _height);
+	if (!_width || !_height) return out;
+	if (kernel.separable()) ConvolveSeparable(_pixels, _width, _height, kernel, borderMode, out._pixels);
+	else Convolve(_pixels, _width, _height, kernel, borderMode, out._pixels);
+	// The four channels are convolved together, so the input's alpha is restored afterwards
+	if (!convolveAlpha)
+		ParallelForRows(_width, _height, [&](int y0, int y1) {
+			for (size_t i = static_cast<size_t>(y0) * _width; i < static_cast<size_t>(y1) * _width; i++) out._pixels[i].a = _pixels[i].a;
+		});
+	return out;
+}
@@ -0,0 +1,73 @@
+#ifndef CONVOLUTION_INCLUDED
+#define CONVOLUTION_INCLUDED
+
+#include <vector>
+
+namespace Image {
+	/** The ways in which a convolution samples the pixels beyond the edges of the image */
+	enum BorderMode {
+		/** Pixels beyond the edges are zero in all channels */
+		BORDER_ZERO,
+		/** Pixels beyond the edges repeat the nearest edge pixel */
+		BORDER_CLAMP,
+		/** Pixels beyond the edges reflect the image about the edge pixels (which are not repeated) */
+		BORDER_MIRROR,
+		/** Pixels beyond the edges wrap around to the opposite edge */
+		BORDER_WRAP
+	};
+
+	/** This class stores the weights of a convolution kernel with odd dimensions, centered on its middle weight.
+	*** On construction the kernel is tested for separability (i.e. whether it is the outer product of a column and a row, as Gaussian and box kernels are),
+	*** in which case the convolution is performed as a horizontal pass followed by a vertical one. */
+	class ConvolutionKernel {
+		/** The dimensions of the kernel */
+		int _width, _height;
+
+		/** The weights, in row-major order */
+		std::vector<double> _weights;
+
+		/** The factors of a separable kernel, whose outer product is the kernel (empty if the kernel is not separable) */
+		std::vector<double> _rowWeights, _columnWeights;
+
+		/** This method tests the kernel for separability, setting the factors if it is */
+		void _factor(void);
+
+	public:
+		/** The largest deviation from the outer product of the factors, relative to the largest weight, for which a kernel is treated as separable */
+		static const double SeparabilityTolerance;
+
+		/** The default constructor creates the 1 x 1 identity kernel */
+		ConvolutionKernel(void);
+
+		/** This constructor creates a width x height kernel from weights given in row-major order.
+		*** An exception is thrown if the dimensions are not odd or do not match the number of weights. */
+		ConvolutionKernel(int width, int height, const std::vector<double>& weights);
+
+		/** This constructor creates a kernel from its rows */
+		ConvolutionKernel(const std::vector<std::vector<double>>& rows);
+
+		/** This static method returns the separable kernel that is the outer product of the column and row weights */
+		static ConvolutionKernel Separable(const std::vector<double>& rowWeights, const std::vector<double>& columnWeights);
+
+		/** This static method returns the normalized (2*radius+1) x (2*radius+1) box kernel */
+		static ConvolutionKernel Box(int radius);
+
+		/** This static method returns the normalized (2*radius+1) x (2*radius+1) Gaussian kernel with the prescribed variance */
+		static ConvolutionKernel Gaussian(double variance, int radius);
+
+		/** These methods return the dimensions of the kernel */
+		int width(void) const { return _width; }
+		int height(void) const { return _height; }
+
+		/** This method returns the weight at the prescribed position, with (0,0) the top-left weight */
+		double operator()(int x, int y) const { return _weights[static_cast<size_t>(y) * _width + x]; }
+
+		/** This method returns true if the kernel is separable */
+		bool separable(void) const { return !_rowWeights.empty(); }
+
+		/** These methods return the factors of a separable kernel */
+		const std::vector<double>& rowWeights(void) const { return _rowWeights; }
+		const std::vector<double>& columnWeights(void) const { return _columnWeights; }
+	};
+}
+#endif // CONVOLUTION_INCLUDED
@@ -3,6 +3,8 @@
 #include "image.h"
 #include <Util/cmdLineParser.h>
 #include <Util/exceptions.h>
+#include <Util/profiler.h>
+#include <Util/threadPool.h>
 #include <Image/bmp.h>
 #include <Image/jpeg.h>
 
@@ -18,6 +20,9 @@ Pixel32::Pixel32( void ) : r(0) , g(0) , b(0) , a(255) {}
 /////////////
 // Image32 //
 /////////////
+std::atomic< size_t > Image32::_AllocatedBytes( 0 );
+std::atomic< size_t > Image32::_PeakAllocatedBytes( 0 );
+
 Image32::Image32( void ) : _width(0) , _height(0) , _pixels(NULL) {}
 
 Image32::Image32( const Image32& img ) : _width(0) , _height(0) , _pixels(NULL)
@@ -55,12 +60,20 @@ void Image32::setSize( int width , int height )
 {
 	if( _width!=width || _height!=height )
 	{
-		if( _pixels ) delete[] _pixels;
+		if( _pixels )
+		{
+			_AllocatedBytes -= memoryUsage();
+			delete[] _pixels;
+		}
 		_pixels = NULL;
 		_width = _height = 0;
 		if( !width*height ) return;
 		_pixels = new Pixel32[width*height];
 		if( !_pixels ) THROW( "Failed to allocate memory for image: %d x %d" , width , height );;
+
+		// Moving the pixels between images does not change the tallies, so only the allocations need to be recorded
+		size_t allocated = _AllocatedBytes += sizeof(Pixel32)*width*height , peak = _PeakAllocatedBytes;
+		while( allocated>peak && !_PeakAllocatedBytes.compare_exchange_weak( peak , allocated ) );
 	}
 	_width = width;
 	_height = height;
@@ -88,6 +101,12 @@ int Image32::width( void ) const { return _width; }
 
 int Image32::height( void ) const { return _height; }
 
+size_t Image32::memoryUsage( void ) const { return sizeof(Pixel32) * _width * _height; }
+
+size_t Image32::AllocatedBytes( void ){ return _AllocatedBytes; }
+
+size_t Image32::PeakAllocatedBytes( void ){ return _PeakAllocatedBytes; }
+
 Image32 Image32::BeierNeelyMorph( const Image32& source , const Image32& destination , const OrientedLineSegmentPairs& olsp , double timeStep )
 {
 	OrientedLineSegmentPairs olsp1 , olsp2;
@@ -117,6 +136,7 @@ Image32 Image32::BeierNeelyMorph( const Image32& source , const Image32& destina
 
 void Image32::read( string fileName )
 {
+	PROFILE_ZONE( "image read" );
 	string ext = ToLower( GetFileExtension( fileName ) );
 	if     ( ext=="bmp" ) BMPReadImage( fileName , *this );
 	else if( ext=="jpg" || ext=="jpeg" ) JPEGReadImage( fileName , *this );
@@ -125,9 +145,85 @@ void Image32::read( string fileName )
 
 void Image32::write( string fileName ) const
 {
+	PROFILE_ZONE( "image write" );
 	string ext = ToLower( GetFileExtension( fileName ) );
 	if( !( width()*height() ) ) THROW( "Cannot write empty image: %s" , fileName.c_str() );
 	if     ( ext=="bmp" ) BMPWriteImage( *this , fileName );
 	else if( ext=="jpg" || ext=="jpeg" ) JPEGWriteImage( *this , fileName );
 	else THROW( "Unrecognized file extension: %s" , ext.c_str() );
-}
\ No newline at end of file
+}
+
+std::vector< unsigned char > Image32::encode( string ext ) const
+{
+	ext = ToLower( ext );
+	if( !( width()*height() ) ) THROW( "Cannot encode empty image" );
+
+	// The writers work on FILE pointers, so we encode into a temporary file and read the bytes back
+	FILE *fp = tmpfile();
+	if( !fp ) THROW( "Failed to create temporary file" );
+	try
+	{
+		if     ( ext=="bmp" ) BMPWriteImage( *this , fp );
+		else if( ext=="jpg" || ext=="jpeg" ) JPEGWriteImage( *this , fp , 100 );
+		else THROW( "Unrecognized file extension: %s" , ext.c_str() );
+	}
+	catch( ... ){ fclose( fp ) ; throw; }
+
+	std::vector< unsigned char > bytes( ftell( fp ) );
+	rewind( fp );
+	if( bytes.size() && fread( &bytes[0] , 1 , bytes.size() , fp )!=bytes.size() ){ fclose( fp ) ; THROW( "Failed to read back encoded image" ); }
+	fclose( fp );
+	return bytes;
+}
+
+/////////////////////
+// ParallelForRows //
+/////////////////////
+// The smallest number of pixels worth handing to another thread
+static const size_t MinBandPixels = 1<<14;
+
+void Image::ParallelForRows( int width , int height , const std::function< void ( int , int ) > &band )
+{
+	if( width<=0 || height<=0 ) return;
+	ThreadPool &pool = ThreadPool::Default();
+	size_t bandNum = std::min< size_t >( 4 * pool.threadNum() , (size_t)width * height / MinBandPixels );
+	bandNum = std::min< size_t >( bandNum , height );
+	if( bandNum<=1 ) band( 0 , height );
+	else pool.parallelFor( 0 , bandNum , [&]( size_t b ){ band( (int)( height*b/bandNum ) , (int)( height*(b+1)/bandNum ) ); } );
+}
+
+/////////////////
+// ImageWriter //
+/////////////////
+ImageWriter::ImageWriter( int width , int height ) : _width(width) , _height(height) , _rowNum(0) , _finished(false)
+{
+	if( width<=0 || height<=0 ) THROW( "Cannot write empty image: %d x %d" , width , height );
+}
+
+void ImageWriter::writeRows( const Image32 &rows )
+{
+	PROFILE_ZONE( "image write" );
+	if( _finished ) THROW( "Image has already been finished" );
+	if( rows.width()!=_width ) THROW( "Band width does not match image width: %d != %d" , rows.width() , _width );
+	if( _rowNum+rows.height()>_height ) THROW( "Band extends past the bottom of the image: %d + %d > %d" , _rowNum , rows.height() , _height );
+	if( !rows.height() ) return;
+	_writeRows( rows , _rowNum );
+	_rowNum += rows.height();
+}
+
+void ImageWriter::finish( void )
+{
+	if( _finished ) return;
+	if( _rowNum!=_height ) THROW( "Not all rows have been written: %d != %d" , _rowNum , _height );
+	_finish();
+	_finished = true;
+}
+
+std::unique_ptr< ImageWriter > ImageWriter::Get( string fileName , int width , int height )
+{
+	string ext = ToLower( GetFileExtension( fileName ) );
+	if     ( ext=="bmp" ) return std::unique_ptr< ImageWriter >( new BMPWriter( fileName , width , height ) );
+	else if( ext=="jpg" || ext=="jpeg" ) return std::unique_ptr< ImageWriter >( new JPEGWriter( fileName , width , height ) );
+	else THROW( "Unrecognized file extension: %s" , ext.c_str() );
+	return nullptr;
+}
@@ -2,10 +2,15 @@
 #define IMAGE_INCLUDED
 
 #include <stdio.h>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include <stdexcept>
 #include <Util/geometry.h>
 #include "lineSegments.h"
+#include "convolution.h"
 
 namespace Image {
 	/** This class represents a 4-channel, 32-bit, RGBA pixel. */
@@ -38,6 +43,9 @@ namespace Image {
 
 		/** The method validates that the pixel index is valid */
 		void _assertInBounds(int x, int y) const;
+
+		/** The number of bytes held by the pixels of all images, and the largest number held at any one time */
+		static std::atomic<size_t> _AllocatedBytes, _PeakAllocatedBytes;
 	public:
 		/** The default constructor */
 		Image32(void);
@@ -66,6 +74,13 @@ namespace Image {
 		/** This method returns the height of the image */
 		int height(void) const;
 
+		/** This method returns the number of bytes held by the pixels */
+		size_t memoryUsage(void) const;
+
+		/** These static methods return the number of bytes held by the pixels of all images, and the largest number held at any one time */
+		static size_t AllocatedBytes(void);
+		static size_t PeakAllocatedBytes(void);
+
 		/** This method returns a reference to the indexed pixel.
 		*** An exception is thrown if the index is out of bounds. */
 		Pixel32& operator()(int x, int y);
@@ -80,6 +95,9 @@ namespace Image {
 		/** This method writes in an image out to the specified file. It uses the file extension to determine if the file should be written out as a BMP file or as a JPEG file. */
 		void write(std::string fileName) const;
 
+		/** This method encodes the image as a BMP or JPEG file in memory and returns the bytes. The format is given by a file extension ("bmp", "jpg" or "jpeg"). */
+		std::vector<unsigned char> encode(std::string ext) const;
+
 		/** This method outputs a new image image with random noise added to each pixel.
 		*** The value of the input parameter should be in the range [0,1] representing the fraction
 		*** of noise that should be added. The actual amount of noise added is in the range [-noise,noise]. */
@@ -126,6 +144,12 @@ namespace Image {
 		/** This method outpus a new image highlighting the edges in the input using a 3x3 mask. */
 		Image32 edgeDetect3X3(void) const;
 
+		/** This method outputs the convolution of the image with the kernel, sampling the pixels beyond the edges as prescribed by the border mode.
+		*** The color channels (and the alpha channel, if requested) are convolved in fixed-point arithmetic, and the results are truncated and clamped to [0,255].
+		*** Otherwise the alpha of the input is kept.
+		*** Kernels whose weights are multiples of a power of two no smaller than 2^-14 (such as the binomial blur) are applied exactly. */
+		Image32 convolve(const ConvolutionKernel& kernel, BorderMode borderMode = BORDER_ZERO, bool convolveAlpha = false) const;
+
 		/** This method outputs a scaled image which is obtained using nearest-point sampling.
 		* The value of the input parameter is the factor by which the image is to be scaled.
 		*/
@@ -192,5 +216,54 @@ namespace Image {
 		*** The variance of the Gaussian and the radius over which the weighted summation is performed are specified by the parameters. */
 		Pixel32 gaussianSample(Util::Point2D p, double variance, double radius) const;
 	};
+
+	/** This function splits the rows of a width x height image into bands and calls the function on each band of rows [y0,y1),
+	*** running the bands in parallel on the default thread pool and returning once all of them are done.
+	*** Images too small to be worth splitting are processed as a single band.
+	*** Each band is processed from top to bottom, so a function that only writes to the pixels of its own rows gives the same result as a serial loop. */
+	void ParallelForRows(int width, int height, const std::function<void (int, int)>& band);
+
+	/** This abstract class writes out an image incrementally, in bands of rows handed over from top to bottom,
+	*** so that the whole image never needs to be held in memory. */
+	class ImageWriter {
+		/** The dimensions of the image */
+		int _width, _height;
+
+		/** The number of rows that have been written */
+		int _rowNum;
+
+		/** Set once the image has been finished */
+		bool _finished;
+	protected:
+		/** This method writes out the rows of the band, the first of which is row y of the image */
+		virtual void _writeRows(const Image32& rows, int y) = 0;
+
+		/** This method completes the file, once all the rows have been written */
+		virtual void _finish(void) = 0;
+	public:
+		/** The constructor sets the dimensions of the image to be written out */
+		ImageWriter(int width, int height);
+
+		virtual ~ImageWriter(void) {}
+
+		/** These methods return the dimensions of the image */
+		int width(void) const { return _width; }
+		int height(void) const { return _height; }
+
+		/** This method returns the number of rows that have been written */
+		int rowNum(void) const { return _rowNum; }
+
+		/** This method writes out the next band of rows, given as an image with the width of the written image.
+		*** An exception is thrown if the band has the wrong width or extends past the bottom of the image. */
+		void writeRows(const Image32& rows);
+
+		/** This method completes the file. An exception is thrown if not all the rows have been written.
+		*** If a writer is destroyed without being finished, the (incomplete) file is closed. */
+		void finish(void);
+
+		/** This static method returns a writer for an image of the prescribed dimensions.
+		*** It uses the file extension to determine if the file should be written out as a BMP file or as a JPEG file. */
+		static std::unique_ptr<ImageWriter> Get(std::string fileName, int width, int height);
+	};
 }
 #endif // IMAGE_INCLUDED
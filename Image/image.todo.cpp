@@ -28,24 +28,28 @@ Image32 Image32::addRandomNoise(double noise) const {
 }
 
 Image32 Image32::brighten(double brightness) const {
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		Pixel32 pixel = this->_pixels[i];
-		pixel.r = std::clamp(static_cast<int>(pixel.r * brightness), 0, 255);
-		pixel.g = std::clamp(static_cast<int>(pixel.g * brightness), 0, 255);
-		pixel.b = std::clamp(static_cast<int>(pixel.b * brightness), 0, 255);
-		this->_pixels[i] = pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			Pixel32 pixel = this->_pixels[i];
+			pixel.r = std::clamp(static_cast<int>(pixel.r * brightness), 0, 255);
+			pixel.g = std::clamp(static_cast<int>(pixel.g * brightness), 0, 255);
+			pixel.b = std::clamp(static_cast<int>(pixel.b * brightness), 0, 255);
+			this->_pixels[i] = pixel;
+		}
+	});
 	return Image32(*this);
 }
 
 Image32 Image32::luminance(void) const {
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		Pixel32 pixel = this->_pixels[i];
-		const unsigned char luminance = std::clamp(static_cast<int>(pixel.r * 0.3 + pixel.g * 0.59 + pixel.b * 0.11), 0,
-		                                           255);
-		pixel.r = pixel.g = pixel.b = luminance;
-		this->_pixels[i] = pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			Pixel32 pixel = this->_pixels[i];
+			const unsigned char luminance = std::clamp(static_cast<int>(pixel.r * 0.3 + pixel.g * 0.59 + pixel.b * 0.11), 0,
+			                                           255);
+			pixel.r = pixel.g = pixel.b = luminance;
+			this->_pixels[i] = pixel;
+		}
+	});
 	return Image32(*this);
 }
 
@@ -56,25 +60,29 @@ Image32 Image32::contrast(double contrast) const {
 		sum += pixel.r * 0.3 + pixel.g * 0.59 + pixel.b * 0.11;
 	}
 	const double avg_luminance = sum / (this->_width * this->_height);
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		Pixel32 pixel = this->_pixels[i];
-		pixel.r = std::clamp(static_cast<int>((pixel.r - avg_luminance) * contrast + avg_luminance), 0, 255);
-		pixel.g = std::clamp(static_cast<int>((pixel.g - avg_luminance) * contrast + avg_luminance), 0, 255);
-		pixel.b = std::clamp(static_cast<int>((pixel.b - avg_luminance) * contrast + avg_luminance), 0, 255);
-		this->_pixels[i] = pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			Pixel32 pixel = this->_pixels[i];
+			pixel.r = std::clamp(static_cast<int>((pixel.r - avg_luminance) * contrast + avg_luminance), 0, 255);
+			pixel.g = std::clamp(static_cast<int>((pixel.g - avg_luminance) * contrast + avg_luminance), 0, 255);
+			pixel.b = std::clamp(static_cast<int>((pixel.b - avg_luminance) * contrast + avg_luminance), 0, 255);
+			this->_pixels[i] = pixel;
+		}
+	});
 	return Image32(*this);
 }
 
 Image32 Image32::saturate(double saturation) const {
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		Pixel32 pixel = this->_pixels[i];
-		const double luminance = pixel.r * 0.3 + pixel.g * 0.59 + pixel.b * 0.11;
-		pixel.r = std::clamp(static_cast<int>((pixel.r - luminance) * saturation + luminance), 0, 255);
-		pixel.g = std::clamp(static_cast<int>((pixel.g - luminance) * saturation + luminance), 0, 255);
-		pixel.b = std::clamp(static_cast<int>((pixel.b - luminance) * saturation + luminance), 0, 255);
-		this->_pixels[i] = pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			Pixel32 pixel = this->_pixels[i];
+			const double luminance = pixel.r * 0.3 + pixel.g * 0.59 + pixel.b * 0.11;
+			pixel.r = std::clamp(static_cast<int>((pixel.r - luminance) * saturation + luminance), 0, 255);
+			pixel.g = std::clamp(static_cast<int>((pixel.g - luminance) * saturation + luminance), 0, 255);
+			pixel.b = std::clamp(static_cast<int>((pixel.b - luminance) * saturation + luminance), 0, 255);
+			this->_pixels[i] = pixel;
+		}
+	});
 	return Image32(*this);
 }
 
@@ -82,13 +90,15 @@ Image32 Image32::quantize(int bits) const {
 	const int num_colors = pow(2, bits);
 	const int factor = 256 / num_colors;
 	const int quantized_ceiling = 255 / factor;
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		Pixel32 pixel = this->_pixels[i];
-		pixel.r = std::clamp(pixel.r / factor * (255 / quantized_ceiling), 0, 255);
-		pixel.g = std::clamp(pixel.g / factor * (255 / quantized_ceiling), 0, 255);
-		pixel.b = std::clamp(pixel.b / factor * (255 / quantized_ceiling), 0, 255);
-		this->_pixels[i] = pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			Pixel32 pixel = this->_pixels[i];
+			pixel.r = std::clamp(pixel.r / factor * (255 / quantized_ceiling), 0, 255);
+			pixel.g = std::clamp(pixel.g / factor * (255 / quantized_ceiling), 0, 255);
+			pixel.b = std::clamp(pixel.b / factor * (255 / quantized_ceiling), 0, 255);
+			this->_pixels[i] = pixel;
+		}
+	});
 	return Image32(*this);
 }
 
@@ -103,21 +113,23 @@ Image32 Image32::orderedDither2X2(int bits) const {
 		{1 / 5.0, 3 / 5.0}, {4 / 5.0, 2 / 5.0}
 	};
 	const int factor = 255 / static_cast<int>(255 / (256 / pow(2, bits)));
-	for (int index = 0; index < this->_width * this->_height; index++) {
-		const int i = index % this->_width % 2;
-		const int j = index / this->_height % 2;
-		Pixel32 pixel = this->_pixels[index];
-		double r = pixel.r / 256.0 * (pow(2, bits) - 1);
-		double g = pixel.g / 256.0 * (pow(2, bits) - 1);
-		double b = pixel.b / 256.0 * (pow(2, bits) - 1);
-		r = r - floor(r) > matrix[i][j] ? ceil(r) : floor(r);
-		g = g - floor(g) > matrix[i][j] ? ceil(g) : floor(g);
-		b = b - floor(b) > matrix[i][j] ? ceil(b) : floor(b);
-		pixel.r = std::clamp(static_cast<int>(r) * factor, 0, 255);
-		pixel.g = std::clamp(static_cast<int>(g) * factor, 0, 255);
-		pixel.b = std::clamp(static_cast<int>(b) * factor, 0, 255);
-		this->_pixels[index] = pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int index = y0 * this->_width; index < y1 * this->_width; index++) {
+			const int i = index % this->_width % 2;
+			const int j = index / this->_height % 2;
+			Pixel32 pixel = this->_pixels[index];
+			double r = pixel.r / 256.0 * (pow(2, bits) - 1);
+			double g = pixel.g / 256.0 * (pow(2, bits) - 1);
+			double b = pixel.b / 256.0 * (pow(2, bits) - 1);
+			r = r - floor(r) > matrix[i][j] ? ceil(r) : floor(r);
+			g = g - floor(g) > matrix[i][j] ? ceil(g) : floor(g);
+			b = b - floor(b) > matrix[i][j] ? ceil(b) : floor(b);
+			pixel.r = std::clamp(static_cast<int>(r) * factor, 0, 255);
+			pixel.g = std::clamp(static_cast<int>(g) * factor, 0, 255);
+			pixel.b = std::clamp(static_cast<int>(b) * factor, 0, 255);
+			this->_pixels[index] = pixel;
+		}
+	});
 	return Image32(*this);
 }
 
@@ -181,88 +193,26 @@ Image32 Image32::floydSteinbergDither(int bits) const {
 }
 
 Image32 Image32::blur3X3(void) const {
-	// technically, this matrix is flipped both vertically and horizontally so (i, j) is (j, i),
-	// but it doesn't really matter since it's a gaussian filter
-	constexpr double kernel[3][3] =
+	const ConvolutionKernel kernel(3, 3,
 	{
-		{1 / 16.0, 2 / 16.0, 1 / 16.0},
-		{2 / 16.0, 4 / 16.0, 2 / 16.0},
-		{1 / 16.0, 2 / 16.0, 1 / 16.0}
-	};
-	constexpr int k_rows = 3, k_cols = 3;
-	auto blurred_image = Image32();
-	blurred_image.setSize(this->_width, this->_height);
-	// blur
-	for (int y = 0; y < this->_height; y++) {
-		for (int x = 0; x < this->_width; x++) {
-			double accumulator_r = 0;
-			double accumulator_g = 0;
-			double accumulator_b = 0;
-			// convolve
-			for (int i = 0; i < k_rows; i++) {
-				const int ii = k_rows - 1 - i; // reverse index (j, i) -> (i, j)
-				for (int j = 0; j < k_cols; j++) {
-					const int jj = k_cols - 1 - j; // reverse index (j, i) -> (i, j)
-
-					// overlay filter on top of input
-					const int yy = y + (k_cols / 2 - jj);
-					const int xx = x + (k_rows / 2 - ii);
-
-					if (yy >= 0 && yy < this->_height && xx >= 0 && xx < this->_width) {
-						const auto pixel = (*this)(xx, yy);
-						accumulator_r += pixel.r * kernel[ii][jj];
-						accumulator_g += pixel.g * kernel[ii][jj];
-						accumulator_b += pixel.b * kernel[ii][jj];
-					} // else, it's a black pixel (zero padding)
-				}
-			}
-			blurred_image(x, y).r = std::clamp(static_cast<int>(accumulator_r), 0, 255);
-			blurred_image(x, y).g = std::clamp(static_cast<int>(accumulator_g), 0, 255);
-			blurred_image(x, y).b = std::clamp(static_cast<int>(accumulator_b), 0, 255);
-		}
-	}
-	return blurred_image;
+		1 / 16.0, 2 / 16.0, 1 / 16.0,
+		2 / 16.0, 4 / 16.0, 2 / 16.0,
+		1 / 16.0, 2 / 16.0, 1 / 16.0
+	});
+	// the kernel is separable, and its weights are exact in fixed-point, so this matches the floating-point blur
+	// (only the color channels are blurred, the alpha is kept)
+	return convolve(kernel, BORDER_ZERO, false);
 }
 
 Image32 Image32::edgeDetect3X3(void) const {
-	constexpr double kernel[3][3] =
+	const ConvolutionKernel kernel(3, 3,
 	{
-		{-1 / 8.0, -1 / 8.0, -1 / 8.0},
-		{-1 / 8.0, 1.0, -1 / 8.0},
-		{-1 / 8.0, -1 / 8.0, -1 / 8.0}
-	};
-	constexpr int k_rows = 3, k_cols = 3;
-	auto edge_image = Image32();
-	edge_image.setSize(this->_width, this->_height);
-	// blur
-	for (int y = 0; y < this->_height; y++) {
-		for (int x = 0; x < this->_width; x++) {
-			double accumulator_r = 0;
-			double accumulator_g = 0;
-			double accumulator_b = 0;
-			// convolve
-			for (int i = 0; i < k_rows; i++) {
-				const int ii = k_rows - 1 - i; // reverse index (j, i) -> (i, j)
-				for (int j = 0; j < k_cols; j++) {
-					const int jj = k_cols - 1 - j; // reverse index (j, i) -> (i, j)
-
-					// overlay filter on top of input
-					const int yy = y + (k_cols / 2 - jj);
-					const int xx = x + (k_rows / 2 - ii);
-
-					if (yy >= 0 && yy < this->_height && xx >= 0 && xx < this->_width) {
-						const auto pixel = (*this)(xx, yy);
-						accumulator_r += pixel.r * kernel[ii][jj];
-						accumulator_g += pixel.g * kernel[ii][jj];
-						accumulator_b += pixel.b * kernel[ii][jj];
-					} // else, it's a black pixel (zero padding)
-				}
-			}
-			edge_image(x, y).r = std::clamp(static_cast<int>(accumulator_r), 0, 255);
-			edge_image(x, y).g = std::clamp(static_cast<int>(accumulator_g), 0, 255);
-			edge_image(x, y).b = std::clamp(static_cast<int>(accumulator_b), 0, 255);
-		}
-	}
+		-1 / 8.0, -1 / 8.0, -1 / 8.0,
+		-1 / 8.0, 1.0, -1 / 8.0,
+		-1 / 8.0, -1 / 8.0, -1 / 8.0
+	});
+	// only the color channels are filtered, since the kernel sums to zero and would make opaque pixels transparent
+	auto edge_image = convolve(kernel, BORDER_ZERO, false);
 	edge_image.brighten(10);
 	return edge_image;
 }
@@ -270,28 +220,32 @@ Image32 Image32::edgeDetect3X3(void) const {
 Image32 Image32::scaleNearest(double scaleFactor) const {
 	auto scaled_image = Image32();
 	scaled_image.setSize(this->_width * scaleFactor, this->_height * scaleFactor);
-	for (int i = 0; i < scaled_image._width * scaled_image._height; i++) {
-		const int x = i % scaled_image._width;
-		const int y = i / scaled_image._width;
-		const double source_x = x / scaleFactor;
-		const double source_y = y / scaleFactor;
-		const Pixel32 pixel = nearestSample(Point2D(source_x, source_y));
-		scaled_image._pixels[i] = pixel;
-	}
+	ParallelForRows(scaled_image._width, scaled_image._height, [&](int y0, int y1) {
+		for (int i = y0 * scaled_image._width; i < y1 * scaled_image._width; i++) {
+			const int x = i % scaled_image._width;
+			const int y = i / scaled_image._width;
+			const double source_x = x / scaleFactor;
+			const double source_y = y / scaleFactor;
+			const Pixel32 pixel = nearestSample(Point2D(source_x, source_y));
+			scaled_image._pixels[i] = pixel;
+		}
+	});
 	return scaled_image;
 }
 
 Image32 Image32::scaleBilinear(double scaleFactor) const {
 	auto scaled_image = Image32();
 	scaled_image.setSize(this->_width * scaleFactor, this->_height * scaleFactor);
-	for (int i = 0; i < scaled_image._width * scaled_image._height; i++) {
-		const int x = i % scaled_image._width;
-		const int y = i / scaled_image._width;
-		const double source_x = x / scaleFactor;
-		const double source_y = y / scaleFactor;
-		const Pixel32 pixel = bilinearSample(Point2D(source_x, source_y));
-		scaled_image._pixels[i] = pixel;
-	}
+	ParallelForRows(scaled_image._width, scaled_image._height, [&](int y0, int y1) {
+		for (int i = y0 * scaled_image._width; i < y1 * scaled_image._width; i++) {
+			const int x = i % scaled_image._width;
+			const int y = i / scaled_image._width;
+			const double source_x = x / scaleFactor;
+			const double source_y = y / scaleFactor;
+			const Pixel32 pixel = bilinearSample(Point2D(source_x, source_y));
+			scaled_image._pixels[i] = pixel;
+		}
+	});
 	return scaled_image;
 }
 
@@ -300,14 +254,16 @@ Image32 Image32::scaleGaussian(double scaleFactor) const {
 	const double radius = 3 / scaleFactor;
 	auto scaled_image = Image32();
 	scaled_image.setSize(this->_width * scaleFactor, this->_height * scaleFactor);
-	for (int i = 0; i < scaled_image._width * scaled_image._height; i++) {
-		const int x = i % scaled_image._width;
-		const int y = i / scaled_image._width;
-		const double source_x = x / scaleFactor;
-		const double source_y = y / scaleFactor;
-		const Pixel32 pixel = gaussianSample(Point2D(source_x, source_y), variance, radius);
-		scaled_image._pixels[i] = pixel;
-	}
+	ParallelForRows(scaled_image._width, scaled_image._height, [&](int y0, int y1) {
+		for (int i = y0 * scaled_image._width; i < y1 * scaled_image._width; i++) {
+			const int x = i % scaled_image._width;
+			const int y = i / scaled_image._width;
+			const double source_x = x / scaleFactor;
+			const double source_y = y / scaleFactor;
+			const Pixel32 pixel = gaussianSample(Point2D(source_x, source_y), variance, radius);
+			scaled_image._pixels[i] = pixel;
+		}
+	});
 	return scaled_image;
 }
 
@@ -316,14 +272,16 @@ Image32 Image32::rotateNearest(double angle) const {
 	auto rotated_image = Image32();
 	rotated_image.setSize(this->_width, this->_height);
 	const int center_x = (this->_width - 1) / 2, center_y = (this->_height - 1) / 2;
-	for (int i = 0; i < rotated_image._width * rotated_image._height; i++) {
-		const int x = i % rotated_image._width;
-		const int y = i / rotated_image._width;
-		const double source_x = (x - center_x) * cos_angle - (y - center_y) * sin_angle + center_x;
-		const double source_y = (x - center_x) * sin_angle + (y - center_y) * cos_angle + center_y;
-		const Pixel32 pixel = nearestSample(Point2D(source_x, source_y));
-		rotated_image._pixels[i] = pixel;
-	}
+	ParallelForRows(rotated_image._width, rotated_image._height, [&](int y0, int y1) {
+		for (int i = y0 * rotated_image._width; i < y1 * rotated_image._width; i++) {
+			const int x = i % rotated_image._width;
+			const int y = i / rotated_image._width;
+			const double source_x = (x - center_x) * cos_angle - (y - center_y) * sin_angle + center_x;
+			const double source_y = (x - center_x) * sin_angle + (y - center_y) * cos_angle + center_y;
+			const Pixel32 pixel = nearestSample(Point2D(source_x, source_y));
+			rotated_image._pixels[i] = pixel;
+		}
+	});
 	return rotated_image;
 }
 
@@ -332,14 +290,16 @@ Image32 Image32::rotateBilinear(double angle) const {
 	auto rotated_image = Image32();
 	rotated_image.setSize(this->_width, this->_height);
 	const int center_x = (this->_width - 1) / 2, center_y = (this->_height - 1) / 2;
-	for (int i = 0; i < rotated_image._width * rotated_image._height; i++) {
-		const int x = i % rotated_image._width;
-		const int y = i / rotated_image._width;
-		const double source_x = (x - center_x) * cos_angle - (y - center_y) * sin_angle + center_x;
-		const double source_y = (x - center_x) * sin_angle + (y - center_y) * cos_angle + center_y;
-		const Pixel32 pixel = bilinearSample(Point2D(source_x, source_y));
-		rotated_image._pixels[i] = pixel;
-	}
+	ParallelForRows(rotated_image._width, rotated_image._height, [&](int y0, int y1) {
+		for (int i = y0 * rotated_image._width; i < y1 * rotated_image._width; i++) {
+			const int x = i % rotated_image._width;
+			const int y = i / rotated_image._width;
+			const double source_x = (x - center_x) * cos_angle - (y - center_y) * sin_angle + center_x;
+			const double source_y = (x - center_x) * sin_angle + (y - center_y) * cos_angle + center_y;
+			const Pixel32 pixel = bilinearSample(Point2D(source_x, source_y));
+			rotated_image._pixels[i] = pixel;
+		}
+	});
 	return rotated_image;
 }
 
@@ -348,59 +308,69 @@ Image32 Image32::rotateGaussian(double angle) const {
 	auto rotated_image = Image32();
 	rotated_image.setSize(this->_width, this->_height);
 	const int center_x = (this->_width - 1) / 2, center_y = (this->_height - 1) / 2;
-	for (int i = 0; i < rotated_image._width * rotated_image._height; i++) {
-		const int x = i % rotated_image._width;
-		const int y = i / rotated_image._width;
-		const double source_x = (x - center_x) * cos_angle - (y - center_y) * sin_angle + center_x;
-		const double source_y = (x - center_x) * sin_angle + (y - center_y) * cos_angle + center_y;
-		const Pixel32 pixel = gaussianSample(Point2D(source_x, source_y), 1, 3);
-		rotated_image._pixels[i] = pixel;
-	}
+	ParallelForRows(rotated_image._width, rotated_image._height, [&](int y0, int y1) {
+		for (int i = y0 * rotated_image._width; i < y1 * rotated_image._width; i++) {
+			const int x = i % rotated_image._width;
+			const int y = i / rotated_image._width;
+			const double source_x = (x - center_x) * cos_angle - (y - center_y) * sin_angle + center_x;
+			const double source_y = (x - center_x) * sin_angle + (y - center_y) * cos_angle + center_y;
+			const Pixel32 pixel = gaussianSample(Point2D(source_x, source_y), 1, 3);
+			rotated_image._pixels[i] = pixel;
+		}
+	});
 	return rotated_image;
 }
 
 void Image32::setAlpha(const Image32& matte) {
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		this->_pixels[i].a = 255 - matte._pixels[i].b;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			this->_pixels[i].a = 255 - matte._pixels[i].b;
+		}
+	});
 }
 
 Image32 Image32::composite(const Image32& overlay) const {
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		const double foreground_opacity = overlay._pixels[i].a / 255.0;
-		const double blended_r = foreground_opacity * overlay._pixels[i].r + (1 - foreground_opacity) * this->_pixels[i]
-			.r;
-		const double blended_g = foreground_opacity * overlay._pixels[i].g + (1 - foreground_opacity) * this->_pixels[i]
-			.g;
-		const double blended_b = foreground_opacity * overlay._pixels[i].b + (1 - foreground_opacity) * this->_pixels[i]
-			.b;
-		this->_pixels[i].r = blended_r;
-		this->_pixels[i].g = blended_g;
-		this->_pixels[i].b = blended_b;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			const double foreground_opacity = overlay._pixels[i].a / 255.0;
+			const double blended_r = foreground_opacity * overlay._pixels[i].r + (1 - foreground_opacity) * this->_pixels[i]
+				.r;
+			const double blended_g = foreground_opacity * overlay._pixels[i].g + (1 - foreground_opacity) * this->_pixels[i]
+				.g;
+			const double blended_b = foreground_opacity * overlay._pixels[i].b + (1 - foreground_opacity) * this->_pixels[i]
+				.b;
+			this->_pixels[i].r = blended_r;
+			this->_pixels[i].g = blended_g;
+			this->_pixels[i].b = blended_b;
+		}
+	});
 	return *this;
 }
 
 Image32 Image32::CrossDissolve(const Image32& source, const Image32& destination, double blendWeight) {
 	auto blended_image = Image32();
 	blended_image.setSize(source._width, source._height);
-	for (int i = 0; i < source._width * source._height; i++) {
-		blended_image._pixels[i].r = (1 - blendWeight) * source._pixels[i].r + blendWeight * destination._pixels[i].r;
-		blended_image._pixels[i].g = (1 - blendWeight) * source._pixels[i].g + blendWeight * destination._pixels[i].g;
-		blended_image._pixels[i].b = (1 - blendWeight) * source._pixels[i].b + blendWeight * destination._pixels[i].b;
-	}
+	ParallelForRows(source._width, source._height, [&](int y0, int y1) {
+		for (int i = y0 * source._width; i < y1 * source._width; i++) {
+			blended_image._pixels[i].r = (1 - blendWeight) * source._pixels[i].r + blendWeight * destination._pixels[i].r;
+			blended_image._pixels[i].g = (1 - blendWeight) * source._pixels[i].g + blendWeight * destination._pixels[i].g;
+			blended_image._pixels[i].b = (1 - blendWeight) * source._pixels[i].b + blendWeight * destination._pixels[i].b;
+		}
+	});
 	return blended_image;
 }
 
 Image32 Image32::warp(const OrientedLineSegmentPairs& olsp) const {
 	auto warped_image = Image32();
 	warped_image.setSize(this->_width, this->_height);
-	for (int i = 0; i < this->_width * this->_height; i++) {
-		const auto dest_point = Point2D(i % this->_width, i / this->_width);
-		const Point2D source_point = olsp.getSourcePosition(dest_point);
-		const Pixel32 source_pixel = bilinearSample(source_point);
-		warped_image._pixels[i] = source_pixel;
-	}
+	ParallelForRows(this->_width, this->_height, [&](int y0, int y1) {
+		for (int i = y0 * this->_width; i < y1 * this->_width; i++) {
+			const auto dest_point = Point2D(i % this->_width, i / this->_width);
+			const Point2D source_point = olsp.getSourcePosition(dest_point);
+			const Pixel32 source_pixel = bilinearSample(source_point);
+			warped_image._pixels[i] = source_pixel;
+		}
+	});
 	return warped_image;
 }
 
@@ -411,22 +381,24 @@ Image32 Image32::funFilter(void) const {
 	auto swirl_image = Image32();
 	swirl_image.setSize(this->_width, this->_height);
 	const int center_x = (this->_width - 1) / 2, center_y = (this->_height - 1) / 2;
-	for (int i = 0; i < swirl_image._width * swirl_image._height; i++) {
-		const int x = i % swirl_image._width, y = i / swirl_image._width;
-		const double source_x = x - center_x, source_y = y - center_y;
-		const double distance = sqrt(pow(source_x, 2) + pow(source_y, 2));
-		double angle = atan2(source_y, source_x) * 3;
-		const double twist_amount = 1 - (distance / radius);
-		const double twist_angle = intensity * twist_amount;
-		angle += twist_angle;
-		const double u = cos(angle) * distance + center_x;
-		const double v = sin(angle) * distance + center_y;
-		Pixel32 pixel = bilinearSample(Point2D(u, v));
-		pixel.r = std::clamp(static_cast<int>(cos(angle) * pixel.r), 0, 255);
-		pixel.g = std::clamp(static_cast<int>(sin(angle) * pixel.g), 0, 255);
-		pixel.b = std::clamp(static_cast<int>(sin(angle) * cos(angle) * pixel.b), 0, 255);
-		swirl_image._pixels[i] = pixel;
-	}
+	ParallelForRows(swirl_image._width, swirl_image._height, [&](int y0, int y1) {
+		for (int i = y0 * swirl_image._width; i < y1 * swirl_image._width; i++) {
+			const int x = i % swirl_image._width, y = i / swirl_image._width;
+			const double source_x = x - center_x, source_y = y - center_y;
+			const double distance = sqrt(pow(source_x, 2) + pow(source_y, 2));
+			double angle = atan2(source_y, source_x) * 3;
+			const double twist_amount = 1 - (distance / radius);
+			const double twist_angle = intensity * twist_amount;
+			angle += twist_angle;
+			const double u = cos(angle) * distance + center_x;
+			const double v = sin(angle) * distance + center_y;
+			Pixel32 pixel = bilinearSample(Point2D(u, v));
+			pixel.r = std::clamp(static_cast<int>(cos(angle) * pixel.r), 0, 255);
+			pixel.g = std::clamp(static_cast<int>(sin(angle) * pixel.g), 0, 255);
+			pixel.b = std::clamp(static_cast<int>(sin(angle) * cos(angle) * pixel.b), 0, 255);
+			swirl_image._pixels[i] = pixel;
+		}
+	});
 	swirl_image = swirl_image.floydSteinbergDither(1);
 	return swirl_image;
 }
@@ -443,14 +415,12 @@ Image32 Image32::crop(int x1, int y1, int x2, int y2) const {
 		THROW("corner outside of image");
 	const auto cropped_image = new Image32();
 	cropped_image->setSize(cropped_width, cropped_height);
-	int i = 0;
-	for (int y = 0; y < this->_height; y++) {
-		if (y < top_y || y >= bot_y) continue;
-		for (int x = 0; x < this->_width; x++) {
-			if (x < left_x || x >= right_x) continue ;
-			cropped_image->_pixels[i++] = this->_pixels[x + this->_width * y];
+	ParallelForRows(cropped_width, cropped_height, [&](int y0, int y1) {
+		for (int y = y0; y < y1; y++) {
+			for (int x = 0; x < cropped_width; x++)
+				cropped_image->_pixels[x + cropped_width * y] = this->_pixels[left_x + x + this->_width * (top_y + y)];
 		}
-	}
+	});
 	return *cropped_image;
 }
 
@@ -110,16 +110,9 @@ namespace Image
 		jpeg_destroy_decompress( &cinfo );
 	}
 
-	void JPEGWriteImage( const Image32& img , FILE *fp , int quality )
+	/* Creates the compression object writing to the file, and starts compressing a width x height image */
+	static void JPEGStartCompress( struct jpeg_compress_struct &cinfo , struct jpeg_error_mgr &jerr , FILE *fp , int width , int height , int quality )
 	{
-		struct jpeg_compress_struct cinfo;
-		struct jpeg_error_mgr jerr;
-		unsigned char *pixels;
-		int i;
-
-		JSAMPROW row_pointer[1];      /* pointer to JSAMPLE row[s] */
-		int row_stride;               /* physical row width in image buffer */
-
 									  /* Step 1: allocate and initialize JPEG compression object */
 		cinfo.err = jpeg_std_error( &jerr );
 		jpeg_create_compress( &cinfo );
@@ -131,8 +124,8 @@ namespace Image
 		/* First we supply a description of the input image.                                                    
 		* Four fields of the cinfo struct must be filled in:
 		*/
-		cinfo.image_width = img.width();    /* image width and height, in pixels */
-		cinfo.image_height = img.height();
+		cinfo.image_width = width;    /* image width and height, in pixels */
+		cinfo.image_height = height;
 		cinfo.input_components = 3;           /* # of color components per pixel */
 		cinfo.in_color_space = JCS_RGB;       /* colorspace of input image */
 
@@ -140,6 +133,19 @@ namespace Image
 		jpeg_set_quality( &cinfo , quality , TRUE );
 
 		jpeg_start_compress( &cinfo , TRUE );
+	}
+
+	void JPEGWriteImage( const Image32& img , FILE *fp , int quality )
+	{
+		struct jpeg_compress_struct cinfo;
+		struct jpeg_error_mgr jerr;
+		unsigned char *pixels;
+		int i;
+
+		JSAMPROW row_pointer[1];      /* pointer to JSAMPLE row[s] */
+		int row_stride;               /* physical row width in image buffer */
+
+		JPEGStartCompress( cinfo , jerr , fp , img.width() , img.height() , quality );
 
 		row_stride = img.width() * 3;       /* JSAMPLEs per row in image_buffer */
 		pixels=new unsigned char[row_stride];
@@ -164,4 +170,58 @@ namespace Image
 		jpeg_finish_compress( &cinfo );
 		jpeg_destroy_compress( &cinfo );
 	}
-}
\ No newline at end of file
+
+	////////////////
+	// JPEGWriter //
+	////////////////
+	struct JPEGWriter::_Compressor
+	{
+		struct jpeg_compress_struct cinfo;
+		struct jpeg_error_mgr jerr;
+	};
+
+	JPEGWriter::JPEGWriter( std::string fileName , int width , int height , int quality ) : ImageWriter( width , height ) , _compressor( NULL )
+	{
+		_fp = fopen( fileName.c_str() , "wb" );
+		if( !_fp ) THROW( "Failed to open file for writing: %s" , fileName.c_str() );
+		_compressor = new _Compressor();
+		JPEGStartCompress( _compressor->cinfo , _compressor->jerr , _fp , width , height , quality );
+		_line.resize( 3*width );
+	}
+
+	JPEGWriter::~JPEGWriter( void )
+	{
+		if( _compressor )
+		{
+			jpeg_destroy_compress( &_compressor->cinfo );
+			delete _compressor;
+		}
+		if( _fp ) fclose( _fp );
+	}
+
+	void JPEGWriter::_writeRows( const Image32 &rows , int y )
+	{
+		JSAMPROW row_pointer[1];
+		row_pointer[0] = &_line[0];
+		for( int j=0 ; j<rows.height() ; j++ )
+		{
+			for( int i=0 ; i<rows.width() ; i++ )
+			{
+				const Pixel32 &p = rows( i , j );
+				_line[ i*3+0 ] = p.r , _line[ i*3+1 ] = p.g , _line[ i*3+2 ] = p.b;
+			}
+			(void) jpeg_write_scanlines( &_compressor->cinfo , row_pointer , 1 );
+		}
+	}
+
+	void JPEGWriter::_finish( void )
+	{
+		jpeg_finish_compress( &_compressor->cinfo );
+		jpeg_destroy_compress( &_compressor->cinfo );
+		delete _compressor;
+		_compressor = NULL;
+		int error = fclose( _fp );
+		_fp = NULL;
+		if( error ) THROW( "Failed to close file" );
+	}
+}
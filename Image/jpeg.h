@@ -14,5 +14,28 @@ namespace Image
 	void JPEGWriteImage( const Image32& img , std::string , int quality=100 );
 	/** This function writes out a JPEG file, returning 0 on failure.*/
 	void JPEGWriteImage( const Image32& img , FILE *fp , int quality );
+
+	/** This class writes out a JPEG file incrementally, compressing each band of rows as it arrives.*/
+	class JPEGWriter : public ImageWriter
+	{
+		/** The libjpeg compression state (hidden, so that the header does not depend on libjpeg) */
+		struct _Compressor;
+		_Compressor *_compressor;
+
+		/** The file being written */
+		FILE *_fp;
+
+		/** The buffer in which a row is passed to the compressor */
+		std::vector< unsigned char > _line;
+	protected:
+		void _writeRows( const Image32 &rows , int y );
+		void _finish( void );
+	public:
+		/** The constructor opens the file and starts compressing an image of the prescribed dimensions */
+		JPEGWriter( std::string fileName , int width , int height , int quality=100 );
+
+		/** The destructor closes the file, if it has not been finished */
+		~JPEGWriter( void );
+	};
 }
 #endif // JPEG_INCLUDED
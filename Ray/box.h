@@ -3,6 +3,7 @@
 #include <Util/geometry.h>
 #include "shape.h"
 #include "triangle.h"
+#include "tessellation.h"
 
 namespace Ray {
 	/** This class represents a box and is defined by its center and the length of the sides. */
@@ -19,8 +20,8 @@ namespace Ray {
 		/** The lengths of the sides of the box */
 		Util::Point3D length;
 
-		/** The mesh of the box */
-		std::vector<Triangle> mesh;
+		/** The mesh of the box, about its center, shared by all boxes with the same dimensions */
+		std::shared_ptr<const TessellatedMesh> mesh;
 
 		/** This static method returns the directive describing the shape. */
 		static std::string Directive(void) { return "shape_box"; }
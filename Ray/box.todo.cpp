@@ -40,102 +40,44 @@ void Box::initOpenGL(void) {
 	// |  / |
 	// | /  |
 	// v2--v4
-	// top face
-	const auto v1 = new Vertex();
-	const auto v2 = new Vertex();
-	const auto v3 = new Vertex();
-	const auto v4 = new Vertex();
-	v1->position = center + (Point3D(-1., 1., -1.) * length);
-	v2->position = center + (Point3D(-1., 1., 1.) * length);
-	v3->position = center + (Point3D(1., 1., -1.) * length);
-	v4->position = center + (Point3D(1., 1., 1.) * length);
-	v1->normal = v2->normal = v3->normal = v4->normal = Point3D(0., 1., 0.);
-	v1->texCoordinate = Point2D(0, 0);
-	v2->texCoordinate = Point2D(0, 1);
-	v3->texCoordinate = Point2D(1, 0);
-	v4->texCoordinate = Point2D(1, 1);
-	mesh.emplace_back(v1, v2, v3);
-	mesh.emplace_back(v3, v2, v4);
-	// bottom face
-	const auto v5 = new Vertex();
-	const auto v6 = new Vertex();
-	const auto v7 = new Vertex();
-	const auto v8 = new Vertex();
-	v5->position = center + (Point3D(-1., -1., -1.) * length);
-	v6->position = center + (Point3D(-1., -1., 1.) * length);
-	v7->position = center + (Point3D(1., -1., -1.) * length);
-	v8->position = center + (Point3D(1., -1., 1.) * length);
-	v5->normal = v6->normal = v7->normal = v8->normal = Point3D(0., -1., 0.);
-	v5->texCoordinate = Point2D(0, 0);
-	v6->texCoordinate = Point2D(0, 1);
-	v7->texCoordinate = Point2D(1, 0);
-	v8->texCoordinate = Point2D(1, 1);
-	mesh.emplace_back(v5, v7, v6); // invert order on negative faces
-	mesh.emplace_back(v7, v8, v6); // invert order on negative faces
-	// front face
-	const auto v9 = new Vertex();
-	const auto v10 = new Vertex();
-	const auto v11 = new Vertex();
-	const auto v12 = new Vertex();
-	v9->position = center + (Point3D(-1., 1., 1.) * length);
-	v10->position = center + (Point3D(-1., -1., 1.) * length);
-	v11->position = center + (Point3D(1., 1., 1.) * length);
-	v12->position = center + (Point3D(1., -1., 1.) * length);
-	v9->normal = v10->normal = v11->normal = v12->normal = Point3D(0., 0., 1.);
-	v9->texCoordinate = Point2D(0, 0);
-	v10->texCoordinate = Point2D(0, 1);
-	v11->texCoordinate = Point2D(1, 0);
-	v12->texCoordinate = Point2D(1, 1);
-	mesh.emplace_back(v9, v10, v11);
-	mesh.emplace_back(v11, v10, v12);
-	// back face
-	const auto v13 = new Vertex();
-	const auto v14 = new Vertex();
-	const auto v15 = new Vertex();
-	const auto v16 = new Vertex();
-	v13->position = center + (Point3D(-1., 1., -1.) * length);
-	v14->position = center + (Point3D(-1., -1., -1.) * length);
-	v15->position = center + (Point3D(1., 1., -1.) * length);
-	v16->position = center + (Point3D(1., -1., -1.) * length);
-	v13->normal = v14->normal = v15->normal = v16->normal = Point3D(0., 0., -1.);
-	v13->texCoordinate = Point2D(0, 0);
-	v14->texCoordinate = Point2D(0, 1);
-	v15->texCoordinate = Point2D(1, 0);
-	v16->texCoordinate = Point2D(1, 1);
-	mesh.emplace_back(v13, v15, v14); // invert order on negative faces
-	mesh.emplace_back(v15, v16, v14); // invert order on negative faces
-	// right face
-	const auto v17 = new Vertex();
-	const auto v18 = new Vertex();
-	const auto v19 = new Vertex();
-	const auto v20 = new Vertex();
-	v17->position = center + (Point3D(1., 1., -1.) * length);
-	v18->position = center + (Point3D(1., -1., -1.) * length);
-	v19->position = center + (Point3D(1., 1., 1.) * length);
-	v20->position = center + (Point3D(1., -1., 1.) * length);
-	v17->normal = v18->normal = v19->normal = v20->normal = Point3D(1., 0., 0.);
-	v17->texCoordinate = Point2D(0, 0);
-	v18->texCoordinate = Point2D(0, 1);
-	v19->texCoordinate = Point2D(1, 0);
-	v20->texCoordinate = Point2D(1, 1);
-	mesh.emplace_back(v17, v19, v18); // invert order on negative faces (x is flipped)
-	mesh.emplace_back(v19, v20, v18); // invert order on negative faces (x is flipped)
-	// left face
-	const auto v21 = new Vertex();
-	const auto v22 = new Vertex();
-	const auto v23 = new Vertex();
-	const auto v24 = new Vertex();
-	v21->position = center + (Point3D(-1., 1., -1.) * length);
-	v22->position = center + (Point3D(-1., -1., -1.) * length);
-	v23->position = center + (Point3D(-1., 1., 1.) * length);
-	v24->position = center + (Point3D(-1., -1., 1.) * length);
-	v21->normal = v22->normal = v23->normal = v24->normal = Point3D(-1., 0., 0.);
-	v21->texCoordinate = Point2D(0, 0);
-	v22->texCoordinate = Point2D(0, 1);
-	v23->texCoordinate = Point2D(1, 0);
-	v24->texCoordinate = Point2D(1, 1);
-	mesh.emplace_back(v21, v22, v23);
-	mesh.emplace_back(v23, v22, v24);
+	const Point3D length = this->length;
+	mesh = TessellationCache::Get(Directive(), {length[0], length[1], length[2]}, OpenGLTessellationComplexity,
+	                              [length](TessellatedMesh& m) {
+		// This function adds the four corners of a face, with the prescribed normal, and returns the index of the first
+		auto addFace = [&](Point3D c1, Point3D c2, Point3D c3, Point3D c4, Point3D normal) {
+			const unsigned int v = m.addVertex(c1 * length, normal, Point2D(0, 0));
+			m.addVertex(c2 * length, normal, Point2D(0, 1));
+			m.addVertex(c3 * length, normal, Point2D(1, 0));
+			m.addVertex(c4 * length, normal, Point2D(1, 1));
+			return v;
+		};
+		unsigned int v;
+		// top face
+		v = addFace(Point3D(-1., 1., -1.), Point3D(-1., 1., 1.), Point3D(1., 1., -1.), Point3D(1., 1., 1.), Point3D(0., 1., 0.));
+		m.triangles.emplace_back(v, v + 1, v + 2);
+		m.triangles.emplace_back(v + 2, v + 1, v + 3);
+		// bottom face
+		v = addFace(Point3D(-1., -1., -1.), Point3D(-1., -1., 1.), Point3D(1., -1., -1.), Point3D(1., -1., 1.), Point3D(0., -1., 0.));
+		m.triangles.emplace_back(v, v + 2, v + 1); // invert order on negative faces
+		m.triangles.emplace_back(v + 2, v + 3, v + 1); // invert order on negative faces
+		// front face
+		v = addFace(Point3D(-1., 1., 1.), Point3D(-1., -1., 1.), Point3D(1., 1., 1.), Point3D(1., -1., 1.), Point3D(0., 0., 1.));
+		m.triangles.emplace_back(v, v + 1, v + 2);
+		m.triangles.emplace_back(v + 2, v + 1, v + 3);
+		// back face
+		v = addFace(Point3D(-1., 1., -1.), Point3D(-1., -1., -1.), Point3D(1., 1., -1.), Point3D(1., -1., -1.), Point3D(0., 0., -1.));
+		m.triangles.emplace_back(v, v + 2, v + 1); // invert order on negative faces
+		m.triangles.emplace_back(v + 2, v + 3, v + 1); // invert order on negative faces
+		// right face
+		v = addFace(Point3D(1., 1., -1.), Point3D(1., -1., -1.), Point3D(1., 1., 1.), Point3D(1., -1., 1.), Point3D(1., 0., 0.));
+		m.triangles.emplace_back(v, v + 2, v + 1); // invert order on negative faces (x is flipped)
+		m.triangles.emplace_back(v + 2, v + 3, v + 1); // invert order on negative faces (x is flipped)
+		// left face
+		v = addFace(Point3D(-1., 1., -1.), Point3D(-1., -1., -1.), Point3D(-1., 1., 1.), Point3D(-1., -1., 1.), Point3D(-1., 0., 0.));
+		m.triangles.emplace_back(v, v + 1, v + 2);
+		m.triangles.emplace_back(v + 2, v + 1, v + 3);
+	});
+	mesh->initOpenGL();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -155,8 +97,8 @@ bool Box::isInside(Point3D p) const {
 	///////////////////////////////////////////////////
 	// Determine if the point is inside the box here //
 	///////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	for (int d = 0; d < 3; d++) if (fabs(p[d] - center[d]) >= length[d] / 2) return false;
+	return true;
 }
 
 void Box::drawOpenGL(GLSLProgram* glslProgram) const {
@@ -164,7 +106,10 @@ void Box::drawOpenGL(GLSLProgram* glslProgram) const {
 	// Do OpenGL rendering here //
 	//////////////////////////////
 	_material->drawOpenGL(glslProgram);
-	for (const auto& triangle : mesh) triangle.drawOpenGL(glslProgram);
+	glPushMatrix();
+	glTranslated(center[0], center[1], center[2]);
+	mesh->drawOpenGL();
+	glPopMatrix();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -26,4 +26,25 @@ namespace Ray
 	{
 		return stream << "#camera  " << camera.position << "  " << camera.forward << "  " << camera.up << "  " << camera.heightAngle;
 	}
-}
\ No newline at end of file
+}
+
+void Camera::getFrustum( int i0 , int j0 , int i1 , int j1 , int width , int height , Plane3D planes[5] ) const
+{
+	// The points on the view plane are affine in the pixel coordinates, so the rays through the tile lie in the cone spanned by the rays through its corners
+	Point3D corners[] = { getRay( i0 , j0 , width , height ).direction , getRay( i1 , j0 , width , height ).direction , getRay( i1 , j1 , width , height ).direction , getRay( i0 , j1 , width , height ).direction };
+	Point3D center = corners[0] + corners[1] + corners[2] + corners[3];
+
+	// The planes are set directly, so that the normals of degenerate planes (e.g. for a single pixel) stay zero and no point is outside them
+	auto SetPlane = [&]( Plane3D &plane , Point3D normal )
+	{
+		double l = normal.length();
+		plane.normal = l>0 ? normal / l : Point3D();
+		plane.distance = -plane.normal.dot( position );
+	};
+	for( int c=0 ; c<4 ; c++ )
+	{
+		Point3D normal = Point3D::CrossProduct( corners[c] , corners[(c+1)%4] );
+		SetPlane( planes[c] , normal.dot( center )<0 ? -normal : normal );
+	}
+	SetPlane( planes[4] , center );
+}
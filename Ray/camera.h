@@ -44,6 +44,11 @@ namespace Ray
 
 		/** This function returns the ray that leaves the camera and goes through pixel (i,j) of the view plane */
 		Util::Ray3D getRay( int i , int j , int width , int height ) const;
+
+		/** This function returns the planes bounding the frustum of rays that leave the camera and go through the pixels in [i0,i1]x[j0,j1] of the view plane.
+		* The first four planes contain the camera's position and the rays through the corner pixels, and the last passes through the position, facing the pixels.
+		* The planes are oriented so that the points on the rays evaluate to non-negative values. */
+		void getFrustum( int i0 , int j0 , int i1 , int j1 , int width , int height , Util::Plane3D planes[5] ) const;
 	};
 
 	/** This operator writes the camera out to a stream. */
@@ -10,7 +10,7 @@ using namespace Util;
 // Cone //
 //////////
 
-Cone::Cone( void ) : height(0) , radius(0) , _material(NULL) , _elementBufferID(0) , _vertexBufferID(0) {}
+Cone::Cone( void ) : height(0) , radius(0) , _material(NULL) {}
 
 void Cone::_read( std::istream &stream )
 {
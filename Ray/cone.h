@@ -4,18 +4,13 @@
 #include <Util/polynomial.h>
 #include "shape.h"
 #include "triangle.h"
+#include "tessellation.h"
 
 namespace Ray {
 	/** This class represents a cone whose central axis is parallel to the y-axis, and 
 	* is defined by the center of the cone, the height from the tip to the base
 	* and the base of the cone. */
 	class Cone : public Shape {
-		/** The OpenGL vertex buffer identifier */
-		GLuint _vertexBufferID = 0;
-
-		/** The OpenGL element buffer identifier */
-		GLuint _elementBufferID = 0;
-
 		/** The index of the material associated with the box */
 		int _materialIndex;
 
@@ -31,8 +26,8 @@ namespace Ray {
 		/** The radius of the cone */
 		double radius;
 
-		/** The mesh of the cone */
-		std::vector<Triangle> mesh;
+		/** The mesh of the cone, about its center, shared by all cones with the same dimensions */
+		std::shared_ptr<const TessellatedMesh> mesh;
 
 		/** This static method returns the directive describing the shape. */
 		static std::string Directive(void) { return "shape_cone"; }
@@ -48,38 +48,35 @@ void Cone::initOpenGL(void) {
 	//    / |
 	//   /  |
 	// v1--v2
-	const int complexity = OpenGLTessellationComplexity;
-	const auto bot = new Vertex();
-	bot->position = center;
-	bot->normal = Point3D(0., -1., 0.);
-	for (int i = 0; i < 2 * complexity; i++) {
-		const double sin_theta = sin(Pi / complexity * i);
-		const double cos_theta = cos(Pi / complexity * i);
-		const double sin_phi = sin(Pi / complexity * (i + 1));
-		const double cos_phi = cos(Pi / complexity * (i + 1));
-		const auto v1 = new Vertex();
-		const auto v2 = new Vertex();
-		v1->position = bot->position + Point3D(radius * cos_theta, 0, radius * sin_theta);
-		v2->position = bot->position + Point3D(radius * cos_phi, 0, radius * sin_phi);
-		v1->normal = v2->normal = Point3D(0., -1., 0.);
-		mesh.emplace_back(v2, bot, v1);
-		const auto v3 = new Vertex();
-		const auto v4 = new Vertex();
-		v3->position = v1->position;
-		v4->position = v2->position;
-		v3->normal = (v3->position - bot->position).unit();
-		v3->normal = Point3D(v3->normal[0] * height / radius, radius / height, v3->normal[2] * height / radius).unit();
-		v4->normal = (v4->position - bot->position).unit();
-		v4->normal = Point3D(v4->normal[0] * height / radius, radius / height, v4->normal[2] * height / radius).unit();
-		v3->texCoordinate = Point2D(static_cast<double>(i) / (2 * complexity), 0);
-		v4->texCoordinate = Point2D(static_cast<double>(i + 1) / (2 * complexity), 0);
-		// each triangle gets a new top so we can wrap a texture properly
-		const auto top = new Vertex();
-		top->position = center + Point3D(0., height, 0.);
-		top->normal = Point3D(0., 1., 0.);
-		top->texCoordinate = Point2D(static_cast<double>(i) / (2 * complexity), 1);
-		mesh.emplace_back(v4, v3, top);
-	}
+	const double radius = this->radius, height = this->height;
+	mesh = TessellationCache::Get(Directive(), {radius, height}, OpenGLTessellationComplexity,
+	                              [radius, height](TessellatedMesh& m) {
+		const int complexity = OpenGLTessellationComplexity;
+		const Point3D bot_position;
+		const unsigned int bot = m.addVertex(bot_position, Point3D(0., -1., 0.));
+		for (int i = 0; i < 2 * complexity; i++) {
+			const double sin_theta = sin(Pi / complexity * i);
+			const double cos_theta = cos(Pi / complexity * i);
+			const double sin_phi = sin(Pi / complexity * (i + 1));
+			const double cos_phi = cos(Pi / complexity * (i + 1));
+			const Point3D p1 = bot_position + Point3D(radius * cos_theta, 0, radius * sin_theta);
+			const Point3D p2 = bot_position + Point3D(radius * cos_phi, 0, radius * sin_phi);
+			const unsigned int v1 = m.addVertex(p1, Point3D(0., -1., 0.));
+			const unsigned int v2 = m.addVertex(p2, Point3D(0., -1., 0.));
+			m.triangles.emplace_back(v2, bot, v1);
+			Point3D n3 = (p1 - bot_position).unit();
+			n3 = Point3D(n3[0] * height / radius, radius / height, n3[2] * height / radius).unit();
+			Point3D n4 = (p2 - bot_position).unit();
+			n4 = Point3D(n4[0] * height / radius, radius / height, n4[2] * height / radius).unit();
+			const unsigned int v3 = m.addVertex(p1, n3, Point2D(static_cast<double>(i) / (2 * complexity), 0));
+			const unsigned int v4 = m.addVertex(p2, n4, Point2D(static_cast<double>(i + 1) / (2 * complexity), 0));
+			// each triangle gets a new top so we can wrap a texture properly
+			const unsigned int top = m.addVertex(Point3D(0., height, 0.), Point3D(0., 1., 0.),
+			                                     Point2D(static_cast<double>(i) / (2 * complexity), 1));
+			m.triangles.emplace_back(v4, v3, top);
+		}
+	});
+	mesh->initOpenGL();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -99,8 +96,11 @@ bool Cone::isInside(Point3D p) const {
 	///////////////////////////////////////////////////
 	// Determine if the point is inside the box here //
 	///////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	// The base lies at the bottom of the bounding box and the apex at the top
+	const Point3D q = p - center;
+	if (fabs(q[1]) >= height / 2) return false;
+	const double r = radius * (height / 2 - q[1]) / height;
+	return q[0] * q[0] + q[2] * q[2] < r * r;
 }
 
 void Cone::drawOpenGL(GLSLProgram* glslProgram) const {
@@ -108,7 +108,10 @@ void Cone::drawOpenGL(GLSLProgram* glslProgram) const {
 	// Do OpenGL rendering here //
 	//////////////////////////////
 	_material->drawOpenGL(glslProgram);
-	for (const auto& triangle : mesh) triangle.drawOpenGL(glslProgram);
+	glPushMatrix();
+	glTranslated(center[0], center[1], center[2]);
+	mesh->drawOpenGL();
+	glPopMatrix();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -10,7 +10,7 @@ using namespace Util;
 // Cylinder //
 //////////////
 
-Cylinder::Cylinder( void ) : height(0) , radius(0) , _material(NULL) , _elementBufferID(0) , _vertexBufferID(0) {}
+Cylinder::Cylinder( void ) : height(0) , radius(0) , _material(NULL) {}
 
 void Cylinder::_read( std::istream &stream )
 {
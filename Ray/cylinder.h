@@ -4,18 +4,13 @@
 #include <Util/polynomial.h>
 #include "shape.h"
 #include "triangle.h"
+#include "tessellation.h"
 
 namespace Ray {
 	/** This class represents a cylinder whose central axis is parallel to the y-axis, 
 	* and is defined by the center of the cylinder, the height from the top cap
 	* to the bottom cap, and the radius of the cylinder. */
 	class Cylinder : public Shape {
-		/** The OpenGL vertex buffer identifier */
-		GLuint _vertexBufferID = 0;
-
-		/** The OpenGL element buffer identifier */
-		GLuint _elementBufferID = 0;
-
 		/** The index of the material associated with the box */
 		int _materialIndex;
 
@@ -31,8 +26,8 @@ namespace Ray {
 		/** The radius of the cylinder */
 		double radius;
 
-		/** The mesh of the cylinder */
-		std::vector<Triangle> mesh;
+		/** The mesh of the cylinder, about its center, shared by all cylinders with the same dimensions */
+		std::shared_ptr<const TessellatedMesh> mesh;
 
 		/** This static method returns the directive describing the shape. */
 		static std::string Directive(void) { return "shape_cylinder"; }
@@ -47,49 +47,41 @@ void Cylinder::initOpenGL(void) {
 	// |  / |
 	// | /  |
 	// v2--v4
-	const int complexity = OpenGLTessellationComplexity;
-	const auto top = new Vertex();
-	const auto bot = new Vertex();
-	top->position = center + Point3D(0., height, 0.);
-	top->normal = Point3D(0., 1., 0.);
-	bot->position = center;
-	bot->normal = Point3D(0., -1., 0.);
-	for (int i = 0; i < 2 * complexity; i++) {
-		const double sin_theta = sin(Pi / complexity * i);
-		const double cos_theta = cos(Pi / complexity * i);
-		const double sin_phi = sin(Pi / complexity * (i + 1));
-		const double cos_phi = cos(Pi / complexity * (i + 1));
-		const auto v1 = new Vertex();
-		const auto v2 = new Vertex();
-		const auto v3 = new Vertex();
-		const auto v4 = new Vertex();
-		v1->position = top->position + Point3D(radius * cos_theta, 0, radius * sin_theta);
-		v2->position = bot->position + Point3D(radius * cos_theta, 0, radius * sin_theta);
-		v3->position = top->position + Point3D(radius * cos_phi, 0, radius * sin_phi);
-		v4->position = bot->position + Point3D(radius * cos_phi, 0, radius * sin_phi);
-		v1->normal = v3->normal = Point3D(0., 1., 0.);
-		v2->normal = v4->normal = Point3D(0., -1., 0.);
-		mesh.emplace_back(v1, top, v3);
-		mesh.emplace_back(v4, bot, v2);
-		const auto v5 = new Vertex();
-		const auto v6 = new Vertex();
-		const auto v7 = new Vertex();
-		const auto v8 = new Vertex();
-		v5->position = v1->position;
-		v6->position = v2->position;
-		v7->position = v3->position;
-		v8->position = v4->position;
-		v5->normal = (v5->position - top->position).unit();
-		v6->normal = (v6->position - bot->position).unit();
-		v7->normal = (v7->position - top->position).unit();
-		v8->normal = (v8->position - bot->position).unit();
-		v5->texCoordinate = Point2D(static_cast<double>(i) / (2 * complexity), 0);
-		v6->texCoordinate = Point2D(static_cast<double>(i) / (2 * complexity), 1);
-		v7->texCoordinate = Point2D(static_cast<double>(i + 1) / (2 * complexity), 0);
-		v8->texCoordinate = Point2D(static_cast<double>(i + 1) / (2 * complexity), 1);
-		mesh.emplace_back(v5, v7, v6);
-		mesh.emplace_back(v6, v7, v8);
-	}
+	const double radius = this->radius, height = this->height;
+	mesh = TessellationCache::Get(Directive(), {radius, height}, OpenGLTessellationComplexity,
+	                              [radius, height](TessellatedMesh& m) {
+		const int complexity = OpenGLTessellationComplexity;
+		const Point3D top_position(0., height / 2, 0.), bot_position(0., -height / 2, 0.);
+		const unsigned int top = m.addVertex(top_position, Point3D(0., 1., 0.));
+		const unsigned int bot = m.addVertex(bot_position, Point3D(0., -1., 0.));
+		for (int i = 0; i < 2 * complexity; i++) {
+			const double sin_theta = sin(Pi / complexity * i);
+			const double cos_theta = cos(Pi / complexity * i);
+			const double sin_phi = sin(Pi / complexity * (i + 1));
+			const double cos_phi = cos(Pi / complexity * (i + 1));
+			const Point3D p1 = top_position + Point3D(radius * cos_theta, 0, radius * sin_theta);
+			const Point3D p2 = bot_position + Point3D(radius * cos_theta, 0, radius * sin_theta);
+			const Point3D p3 = top_position + Point3D(radius * cos_phi, 0, radius * sin_phi);
+			const Point3D p4 = bot_position + Point3D(radius * cos_phi, 0, radius * sin_phi);
+			const unsigned int v1 = m.addVertex(p1, Point3D(0., 1., 0.));
+			const unsigned int v2 = m.addVertex(p2, Point3D(0., -1., 0.));
+			const unsigned int v3 = m.addVertex(p3, Point3D(0., 1., 0.));
+			const unsigned int v4 = m.addVertex(p4, Point3D(0., -1., 0.));
+			m.triangles.emplace_back(v1, top, v3);
+			m.triangles.emplace_back(v4, bot, v2);
+			const unsigned int v5 = m.addVertex(p1, (p1 - top_position).unit(),
+			                                    Point2D(static_cast<double>(i) / (2 * complexity), 0));
+			const unsigned int v6 = m.addVertex(p2, (p2 - bot_position).unit(),
+			                                    Point2D(static_cast<double>(i) / (2 * complexity), 1));
+			const unsigned int v7 = m.addVertex(p3, (p3 - top_position).unit(),
+			                                    Point2D(static_cast<double>(i + 1) / (2 * complexity), 0));
+			const unsigned int v8 = m.addVertex(p4, (p4 - bot_position).unit(),
+			                                    Point2D(static_cast<double>(i + 1) / (2 * complexity), 1));
+			m.triangles.emplace_back(v5, v7, v6);
+			m.triangles.emplace_back(v6, v7, v8);
+		}
+	});
+	mesh->initOpenGL();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -109,8 +101,8 @@ bool Cylinder::isInside(Point3D p) const {
 	////////////////////////////////////////////////////////
 	// Determine if the point is inside the cylinder here //
 	////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	const Point3D q = p - center;
+	return fabs(q[1]) < height / 2 && q[0] * q[0] + q[2] * q[2] < radius * radius;
 }
 
 void Cylinder::drawOpenGL(GLSLProgram* glslProgram) const {
@@ -118,27 +110,10 @@ void Cylinder::drawOpenGL(GLSLProgram* glslProgram) const {
 	// Do OpenGL rendering here //
 	//////////////////////////////
 	_material->drawOpenGL(glslProgram);
-
-	GLUquadric* q = gluNewQuadric();
-
-	glPushMatrix();
-
-	glTranslatef(center[0], center[1] - height / 2, center[2]);
-	glRotatef(90, -1, 0, 0);
-	gluCylinder(q, radius, radius, height, OpenGLTessellationComplexity, OpenGLTessellationComplexity);
-
 	glPushMatrix();
-	glTranslatef(0, 0, height);
-	gluDisk(q, 0, radius, OpenGLTessellationComplexity, OpenGLTessellationComplexity);
+	glTranslated(center[0], center[1], center[2]);
+	mesh->drawOpenGL();
 	glPopMatrix();
-
-	glRotatef(180, 1, 0, 0); // Normals pointing out
-	gluDisk(q, 0, radius, OpenGLTessellationComplexity, OpenGLTessellationComplexity);
-
-	glPopMatrix();
-
-	gluDeleteQuadric(q);
-
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
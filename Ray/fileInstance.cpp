@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "fileInstance.h"
+#include "transformFlattener.h"
 
 using namespace Ray;
 using namespace Util;
@@ -40,3 +41,13 @@ bool FileInstance::isInside( Point3D p ) const { return _file->isInside(p); }
 void FileInstance::drawOpenGL( GLSLProgram * glslProgram ) const { _file->drawOpenGL( glslProgram ); }
 
 size_t FileInstance::primitiveNum( void ) const { return _file->primitiveNum(); }
+
+Shape *FileInstance::flatten( TransformFlattener &flattener )
+{
+	// The file is flattened on its own when it is initialized, so it is only copied if it is transformed
+	if( !flattener.transformed() ) return this;
+	flattener.enterFile();
+	Shape *shape = const_cast< File * >( _file )->flatten( flattener );
+	flattener.leaveFile();
+	return shape;
+}
@@ -36,6 +36,7 @@ namespace Ray
 		bool isInside( Util::Point3D p ) const;
 		void drawOpenGL( GLSLProgram * glslProgram ) const;
 		size_t primitiveNum( void ) const;
+		Shape *flatten( class TransformFlattener &flattener );
 	};
 }
 #endif // RAY_FILE_INSTANCE_INCLUDED
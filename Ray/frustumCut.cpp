@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <typeinfo>
+#include <Util/exceptions.h>
+#include "frustumCut.h"
+#include "scene.h"
+
+using namespace Ray;
+using namespace Util;
+
+////////////////
+// FrustumCut //
+////////////////
+unsigned int FrustumCut::MaxSize = 64;
+
+int FrustumCut::classify(const BoundingBox3D& bBox) const {
+	if (bBox.isEmpty()) return STRADDLING;
+	bool inside = true;
+	for (const Plane3D& plane : _planes) {
+		// The corners of the box farthest along and against the plane's normal
+		Point3D pMax, pMin;
+		for (int d = 0; d < 3; d++)
+			pMax[d] = plane.normal[d] >= 0 ? bBox[1][d] : bBox[0][d], pMin[d] = plane.normal[d] >= 0 ? bBox[0][d] : bBox[1][d];
+		if (plane(pMax) < -Epsilon) return OUTSIDE;
+		if (plane(pMin) < Epsilon) inside = false;
+	}
+	return inside ? INSIDE : STRADDLING;
+}
+
+void FrustumCut::_add(const Shape* shape) {
+	const int classification = classify(shape->boundingBox());
+	if (classification == OUTSIDE) return;
+	// Only plain shape lists are opened up, as the surfaces of the other groupings (e.g. unions) are not the surfaces of their children
+	const ShapeList* shapeList = typeid(*shape) == typeid(ShapeList) ? static_cast<const ShapeList*>(shape) : nullptr;
+	if (classification == STRADDLING && shapeList && _shapes.size() + shapeList->shapes.size() <= MaxSize)
+		for (const Shape* child : shapeList->shapes) _add(child);
+	else _shapes.push_back(shape);
+}
+
+void FrustumCut::set(const ShapeList& shapeList, const Plane3D planes[5]) {
+	for (int p = 0; p < 5; p++) _planes[p] = planes[p];
+	_shapes.clear();
+	for (const Shape* shape : shapeList.shapes) _add(shape);
+}
+
+double FrustumCut::intersect(const Ray3D& ray, RayShapeIntersectionInfo& iInfo) const {
+	const SlabRay slabRay(ray);
+	std::vector<ShapeBoundingBoxHit>& hits = _hits;
+	hits.clear();
+	for (const Shape* shape : _shapes) {
+		double tEntry, tExit;
+		if (!shape->boundingBox().intersect(slabRay, tEntry, tExit)) continue;
+		ShapeBoundingBoxHit hit{};
+		hit.t = std::max<double>(tEntry, 0);
+		hit.shape = shape;
+		hits.push_back(hit);
+	}
+	std::sort(hits.begin(), hits.end(), ShapeBoundingBoxHit::Compare);
+
+	// Visit the shapes in the order in which the ray enters their boxes, until the remaining boxes are entered beyond the closest intersection
+	double t = Infinity;
+	for (const ShapeBoundingBoxHit& hit : hits) {
+		if (hit.t > t) break;
+		RayShapeIntersectionInfo _iInfo;
+		const double _t = hit.shape->intersect(ray, _iInfo, BoundingBox1D(Point1D(Epsilon), Point1D(t)));
+		if (_t < t) t = _t, iInfo = _iInfo;
+	}
+	return t;
+}
@@ -0,0 +1,51 @@
+#ifndef FRUSTUM_CUT_INCLUDED
+#define FRUSTUM_CUT_INCLUDED
+
+#include <vector>
+#include <Util/geometry.h>
+#include "shape.h"
+#include "shapeList.h"
+
+namespace Ray {
+	/** This class stores the part of the scene that can be seen through an image tile: a cut through the hierarchy of shape lists,
+	*** consisting of the shapes whose bounding boxes intersect the frustum of the tile's primary rays.
+	*** Shape lists that straddle the frustum are opened up (as long as the cut stays small), so that primary rays skip the geometry outside of it. */
+	class FrustumCut {
+		/** The shapes in the cut */
+		std::vector<const Shape*> _shapes;
+
+		/** The planes bounding the frustum */
+		Util::Plane3D _planes[5];
+
+		/** The boxes hit by the current ray, kept across calls so that intersecting does not allocate (a cut is only used by one thread) */
+		mutable std::vector<ShapeBoundingBoxHit> _hits;
+
+		/** This method adds the shape to the cut if its bounding box intersects the frustum, opening it up if it is a shape list that is only partially inside */
+		void _add(const Shape* shape);
+
+	public:
+		/** The maximum number of shapes in a cut */
+		static unsigned int MaxSize;
+
+		/** This method sets the cut to the shapes in the list that intersect the frustum bounded by the planes (as returned by Camera::getFrustum) */
+		void set(const ShapeList& shapeList, const Util::Plane3D planes[5]);
+
+		/** This method returns the number of shapes in the cut */
+		size_t size(void) const { return _shapes.size(); }
+
+		/** This method returns the closest intersection of a ray within the frustum with the shapes in the cut.
+		*** It returns Infinity if the ray does not hit any of them, and otherwise sets the intersection information. */
+		double intersect(const Util::Ray3D& ray, class RayShapeIntersectionInfo& iInfo) const;
+
+		/** The results of classifying a bounding box against the frustum */
+		enum {
+			OUTSIDE,
+			STRADDLING,
+			INSIDE
+		};
+
+		/** This method classifies the bounding box against the frustum. (Boxes that are outside of it may be classified as straddling.) */
+		int classify(const Util::BoundingBox3D& bBox) const;
+	};
+}
+#endif // FRUSTUM_CUT_INCLUDED
@@ -0,0 +1,475 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <Util/exceptions.h>
+#include <Util/cmdLineParser.h>
+#include <Util/fileIO.h>
+#include "outOfCoreMesh.h"
+#include "rayBatch.h"
+#include "scene.h"
+
+using namespace Ray;
+using namespace Util;
+
+namespace {
+	/** The most nodes that can be pending during a traversal. Since the hierarchies are built by median splits, this bounds meshes of up to 2^64 triangles. */
+	const int MaxStackSize = 128;
+
+	/** This function traverses the hierarchy front to back, calling the leaf function on each leaf whose box is entered before tMax
+	*** (passing the leaf and the parameter at which its box is entered).
+	*** Since tMax is passed by reference, the leaf function can shrink it as closer intersections are found. */
+	template <typename LeafFunction>
+	void Traverse(const std::vector<OutOfCoreMesh::Node>& nodes, const SlabRay& slabRay, double tMin, const double& tMax,
+	              LeafFunction leaf) {
+		if (nodes.empty()) return;
+		struct Entry {
+			unsigned int node;
+			double tEntry;
+		} stack[MaxStackSize];
+		int stackSize = 0;
+
+		double tEntry, tExit;
+		RayTracingStats::IncrementRayBoundingBoxIntersectionNum();
+		if (!slabRay.intersect(nodes[0].bBox, tEntry, tExit) || tExit < tMin) return;
+		stack[stackSize++] = {0, tEntry};
+		while (stackSize) {
+			const Entry entry = stack[--stackSize];
+			if (entry.tEntry > tMax) continue;
+			const OutOfCoreMesh::Node& node = nodes[entry.node];
+			if (node.num) {
+				leaf(node, entry.tEntry);
+				continue;
+			}
+
+			// Push the farther child first, so that the nearer one is visited first
+			Entry children[2];
+			int childNum = 0;
+			RayTracingStats::IncrementRayBoundingBoxIntersectionNum(2);
+			for (unsigned int c = node.first; c < node.first + 2; c++)
+				if (slabRay.intersect(nodes[c].bBox, tEntry, tExit) && tExit >= tMin && tEntry <= tMax)
+					children[childNum++] = {c, tEntry};
+			if (childNum == 2 && children[0].tEntry < children[1].tEntry) std::swap(children[0], children[1]);
+			for (int c = 0; c < childNum; c++) stack[stackSize++] = children[c];
+		}
+	}
+}
+
+///////////////////
+// OutOfCoreMesh //
+///////////////////
+unsigned int OutOfCoreMesh::ClusterSize = 4096;
+std::string OutOfCoreMesh::Directory;
+
+struct OutOfCoreMesh::_BuildTriangle {
+	TriangleIndex vIndices;
+	BoundingBox3D bBox;
+	Point3D centroid;
+};
+
+size_t OutOfCoreMesh::Cluster::memoryUsage(void) const {
+	return sizeof(Cluster) + nodes.size() * sizeof(Node) + triangles.size() * sizeof(ClusterTriangle);
+}
+
+OutOfCoreMesh::OutOfCoreMesh(void) : _tNum(0), _file(nullptr), _materialIndex(-1), _material(nullptr) {}
+
+OutOfCoreMesh::~OutOfCoreMesh(void) {
+	ClusterCache::Remove(this);
+	if (_file) fclose(_file);
+	if (!_fileName.empty()) remove(_fileName.c_str());
+}
+
+void OutOfCoreMesh::_write(std::ostream& stream) const {
+	WriteInset(stream);
+	stream << "#" << Directive() << "  " << _materialIndex << std::endl;
+	WriteInsetSize++;
+	WriteInset(stream);
+	stream << "#" << ShapeList::Directive() << std::endl;
+	WriteInsetSize++;
+	auto writeTriangle = [&](const unsigned int vIndices[3]) {
+		WriteInset(stream);
+		stream << "#" << Triangle::Directive() << "  " << vIndices[0] << " " << vIndices[1] << " " << vIndices[2] << std::endl;
+	};
+	// Once the clusters have been written out, the triangles are read back from them
+	if (_clusters.empty())
+		for (const TriangleIndex& triangle : _triangles) {
+			const unsigned int vIndices[] = {triangle[0], triangle[1], triangle[2]};
+			writeTriangle(vIndices);
+		}
+	else
+		for (unsigned int c = 0; c < _clusters.size(); c++) {
+			std::shared_ptr<const Cluster> cluster = readCluster(c);
+			for (const ClusterTriangle& triangle : cluster->triangles) writeTriangle(triangle.vIndices);
+		}
+	WriteInsetSize--;
+	WriteInset(stream);
+	stream << "#shape_list_end";
+	WriteInsetSize--;
+}
+
+void OutOfCoreMesh::_read(std::istream& stream) {
+	if (!(stream >> _materialIndex))
+		THROW("failed to read material index for %s", name().c_str());
+	std::string keyword = ReadDirective(stream);
+	if (keyword != ShapeList::Directive())
+		THROW("%s expects next shape to be: %s", name().c_str(), ShapeList::Directive().c_str());
+
+	// The triangles may be grouped in nested lists, which are flattened as only the triangles are kept
+	const std::string endDirective = "shape_list_end";
+	for (int depth = 1; depth;) {
+		keyword = ReadDirective(stream);
+		if (keyword == ShapeList::Directive()) depth++;
+		else if (keyword == endDirective) depth--;
+		else if (keyword == Triangle::Directive()) {
+			TriangleIndex triangle;
+			for (int i = 0; i < 3; i++)
+				if (!(stream >> triangle[i]))
+					THROW("failed to read index for %s", Triangle::Directive().c_str());
+			_triangles.push_back(triangle);
+		}
+		else
+			THROW("unexpected directive in %s: %s", name().c_str(), keyword.c_str());
+	}
+	_tNum = _triangles.size();
+}
+
+void OutOfCoreMesh::init(const LocalSceneData& data) {
+	if (_materialIndex >= static_cast<int>(data.materials.size()))
+		THROW("shape specifies a material that is out of bounds: %d <= %d", _materialIndex,
+	      static_cast<int>(data.materials.size()));
+	else if (_materialIndex < 0)
+		THROW("negative material index: %d", _materialIndex);
+	else _material = &data.materials[_materialIndex];
+
+	if (_file || _triangles.empty()) return;
+
+	std::vector<_BuildTriangle> triangles(_triangles.size());
+	for (size_t i = 0; i < _triangles.size(); i++) {
+		Point3D p[3];
+		for (int j = 0; j < 3; j++) {
+			if (_triangles[i][j] >= data.vertices.size())
+				THROW("vertex index out of bounds: %d <= %d", static_cast<int>(_triangles[i][j]),
+			      static_cast<int>(data.vertices.size()));
+			p[j] = data.vertices[_triangles[i][j]].position;
+		}
+		triangles[i].vIndices = _triangles[i];
+		triangles[i].bBox = BoundingBox3D(p, 3);
+		for (int j = 0; j < 3; j++) triangles[i].bBox[0][j] -= Epsilon, triangles[i].bBox[1][j] += Epsilon;
+		triangles[i].centroid = (p[0] + p[1] + p[2]) / 3;
+	}
+	std::vector<TriangleIndex>().swap(_triangles);
+
+	if (Directory.empty()) _file = tmpfile();
+	else {
+		static std::atomic<unsigned int> FileCount(0);
+		_fileName = Directory + std::string(1, FileSeparator) + "mesh." + std::to_string(FileCount++) + ".clusters";
+		_file = fopen(_fileName.c_str(), "w+b");
+	}
+	if (!_file) THROW("failed to create cluster file: %s", _fileName.empty() ? "(temporary)" : _fileName.c_str());
+
+	// Partition the triangles, writing out a cluster wherever few enough remain and keeping the hierarchy above the clusters
+	_nodes.resize(1);
+	_Build(triangles, 0, triangles.size(), _nodes, 0, ClusterSize, [&](size_t start, size_t end, Node& node) {
+		node.first = _writeCluster(triangles, start, end, data);
+		node.num = 1;
+	});
+	fflush(_file);
+}
+
+void OutOfCoreMesh::_Build(std::vector<_BuildTriangle>& triangles, size_t start, size_t end, std::vector<Node>& nodes,
+                           unsigned int node, unsigned int leafSize,
+                           const std::function<void (size_t, size_t, Node&)>& leaf) {
+	// The centroids' extent is accumulated directly, as a box around a single point would be treated as empty by the union
+	BoundingBox3D bBox = triangles[start].bBox;
+	Point3D centroidMin = triangles[start].centroid, centroidMax = triangles[start].centroid;
+	for (size_t i = start + 1; i < end; i++) {
+		bBox += triangles[i].bBox;
+		for (int d = 0; d < 3; d++)
+			centroidMin[d] = std::min<double>(centroidMin[d], triangles[i].centroid[d]),
+			centroidMax[d] = std::max<double>(centroidMax[d], triangles[i].centroid[d]);
+	}
+	nodes[node].bBox = bBox;
+	if (end - start <= leafSize) {
+		leaf(start, end, nodes[node]);
+		return;
+	}
+
+	// Split at the median centroid along the axis over which the centroids are most spread out
+	int axis = 0;
+	for (int d = 1; d < 3; d++)
+		if (centroidMax[d] - centroidMin[d] > centroidMax[axis] - centroidMin[axis]) axis = d;
+	const size_t mid = (start + end) / 2;
+	std::nth_element(triangles.begin() + start, triangles.begin() + mid, triangles.begin() + end,
+	                 [&](const _BuildTriangle& t1, const _BuildTriangle& t2) { return t1.centroid[axis] < t2.centroid[axis]; });
+
+	const unsigned int children = static_cast<unsigned int>(nodes.size());
+	nodes.resize(children + 2);
+	nodes[node].first = children, nodes[node].num = 0;
+	_Build(triangles, start, mid, nodes, children, leafSize, leaf);
+	_Build(triangles, mid, end, nodes, children + 1, leafSize, leaf);
+}
+
+unsigned int OutOfCoreMesh::_writeCluster(std::vector<_BuildTriangle>& triangles, size_t start, size_t end,
+                                          const LocalSceneData& data) {
+	Cluster cluster;
+	cluster.nodes.resize(1);
+	_Build(triangles, start, end, cluster.nodes, 0, LeafSize, [&](size_t s, size_t e, Node& node) {
+		node.first = static_cast<unsigned int>(s - start), node.num = static_cast<unsigned int>(e - s);
+	});
+	cluster.triangles.resize(end - start);
+	for (size_t i = start; i < end; i++) {
+		ClusterTriangle& triangle = cluster.triangles[i - start];
+		for (int j = 0; j < 3; j++) {
+			const Vertex& vertex = data.vertices[triangles[i].vIndices[j]];
+			triangle.position[j] = vertex.position;
+			triangle.normal[j] = vertex.normal;
+			triangle.texCoordinate[j] = vertex.texCoordinate;
+			triangle.vIndices[j] = triangles[i].vIndices[j];
+		}
+	}
+
+	_ClusterRecord record;
+	record.bBox = cluster.nodes[0].bBox;
+	record.offset = Tell(_file);
+	record.nodeNum = static_cast<unsigned int>(cluster.nodes.size());
+	record.triangleNum = static_cast<unsigned int>(cluster.triangles.size());
+	// The nodes and triangles only store coordinates and indices, so they are written out (and read back in) as raw bytes
+	if (fwrite(&cluster.nodes[0], sizeof(Node), cluster.nodes.size(), _file) != cluster.nodes.size() ||
+		fwrite(&cluster.triangles[0], sizeof(ClusterTriangle), cluster.triangles.size(), _file) != cluster.triangles.size())
+		THROW("failed to write cluster %d", static_cast<int>(_clusters.size()));
+	_clusters.push_back(record);
+	return static_cast<unsigned int>(_clusters.size() - 1);
+}
+
+std::shared_ptr<const OutOfCoreMesh::Cluster> OutOfCoreMesh::readCluster(unsigned int c) const {
+	const _ClusterRecord& record = _clusters[c];
+	std::shared_ptr<Cluster> cluster = std::make_shared<Cluster>();
+	cluster->nodes.resize(record.nodeNum);
+	cluster->triangles.resize(record.triangleNum);
+
+	std::lock_guard<std::mutex> lock(_fileMutex);
+	if (Seek(_file, record.offset) ||
+		fread(&cluster->nodes[0], sizeof(Node), record.nodeNum, _file) != record.nodeNum ||
+		fread(&cluster->triangles[0], sizeof(ClusterTriangle), record.triangleNum, _file) != record.triangleNum)
+		THROW("failed to read cluster %d", static_cast<int>(c));
+	return cluster;
+}
+
+void OutOfCoreMesh::initOpenGL(void) {}
+
+void OutOfCoreMesh::updateBoundingBox(void) {
+	if (!_nodes.empty()) _bBox = _nodes[0].bBox;
+}
+
+void OutOfCoreMesh::_intersect(const Cluster& cluster, const SlabRay& slabRay, const BoundingBox1D& range,
+                               const std::function<bool (double)>& validityLambda, double& t,
+                               RayShapeIntersectionInfo& iInfo) const {
+	Traverse(cluster.nodes, slabRay, range[0][0], t, [&](const Node& node, double) {
+		for (unsigned int i = node.first; i < node.first + node.num; i++) {
+			const ClusterTriangle& triangle = cluster.triangles[i];
+			double beta, gamma;
+			RayTracingStats::IncrementRayPrimitiveIntersectionNum();
+			const double _t = Triangle::Intersect(slabRay.ray, triangle.position[0], triangle.position[1] - triangle.position[0],
+			                                      triangle.position[2] - triangle.position[0], range[0][0], t, beta, gamma);
+			if (isinf(_t) || !validityLambda(_t)) continue;
+			// The hit is reconstructed from the barycentric coordinates, so that the round-off in the parameter does not move it off the surface
+			const double alpha = 1. - beta - gamma;
+			t = _t;
+			iInfo.position = alpha * triangle.position[0] + beta * triangle.position[1] + gamma * triangle.position[2];
+			iInfo.normal = (alpha * triangle.normal[0] + beta * triangle.normal[1] + gamma * triangle.normal[2]).unit();
+			iInfo.texture = alpha * triangle.texCoordinate[0] + beta * triangle.texCoordinate[1] + gamma * triangle.texCoordinate[2];
+			iInfo.material = _material;
+		}
+	});
+}
+
+double OutOfCoreMesh::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingBox1D range,
+                                std::function<bool (double)> validityLambda) const {
+	const SlabRay slabRay(ray);
+	double t = range[1][0];
+	bool hit = false;
+	Traverse(_nodes, slabRay, range[0][0], t, [&](const Node& node, double) {
+		std::shared_ptr<const Cluster> cluster = ClusterCache::Get(this, node.first);
+		const double tBefore = t;
+		_intersect(*cluster, slabRay, range, validityLambda, t, iInfo);
+		hit |= t < tBefore;
+	});
+	return hit ? t : Infinity;
+}
+
+void OutOfCoreMesh::intersectBatch(RayBatch& batch) const {
+	// Find the clusters each ray reaches, in front-to-back order, and the parameter at which the ray enters each one
+	struct Request {
+		unsigned int rank, cluster, ray;
+		double tEntry;
+		bool operator<(const Request& r) const {
+			return rank != r.rank ? rank < r.rank : cluster != r.cluster ? cluster < r.cluster : ray < r.ray;
+		}
+	};
+	std::vector<SlabRay> slabRays;
+	slabRays.reserve(batch.size());
+	std::vector<Request> requests;
+	for (size_t i = 0; i < batch.size(); i++) {
+		slabRays.emplace_back(batch.rays[i]);
+		unsigned int rank = 0;
+		Traverse(_nodes, slabRays[i], Epsilon, batch.t[i], [&](const Node& node, double tEntry) {
+			requests.push_back({rank++, node.first, static_cast<unsigned int>(i), tEntry});
+		});
+	}
+
+	// The requests are served in rounds, the k-th round intersecting each ray with the k-th cluster it reaches.
+	// Within a round each cluster is paged in once for all the rays reaching it,
+	// and a cluster is skipped for rays that have already hit something in front of it (and altogether if no such ray remains).
+	std::sort(requests.begin(), requests.end());
+	const std::function<bool (double)> validityLambda = [](double) { return true; };
+	for (size_t r = 0; r < requests.size();) {
+		size_t end = r;
+		bool live = false;
+		for (; end < requests.size() && requests[end].rank == requests[r].rank && requests[end].cluster == requests[r].cluster; end++)
+			live |= requests[end].tEntry <= batch.t[requests[end].ray];
+		if (live) {
+			std::shared_ptr<const Cluster> cluster = ClusterCache::Get(this, requests[r].cluster);
+			for (; r < end; r++) {
+				const unsigned int i = requests[r].ray;
+				if (requests[r].tEntry > batch.t[i]) continue;
+				_intersect(*cluster, slabRays[i], BoundingBox1D(Point1D(Epsilon), Point1D(batch.t[i])), validityLambda,
+				           batch.t[i], batch.iInfo[i]);
+			}
+		}
+		r = end;
+	}
+}
+
+bool OutOfCoreMesh::isInside(Point3D p) const { return false; }
+
+void OutOfCoreMesh::drawOpenGL(GLSLProgram* glslProgram) const { WARN_ONCE("out-of-core meshes are not drawn"); }
+
+size_t OutOfCoreMesh::primitiveNum(void) const { return _tNum; }
+
+void OutOfCoreMesh::addMemoryUsage(MemoryStats& stats) const {
+	// The paged-in clusters belong to the cache, which is tallied separately
+	if (!stats.visit(this)) return;
+	stats.bytes[MemoryStats::SHAPES] += _triangles.capacity() * sizeof(TriangleIndex);
+	stats.bytes[MemoryStats::ACCELERATION] += _nodes.capacity() * sizeof(Node) + _clusters.capacity() * sizeof(_ClusterRecord);
+}
+
+//////////////////
+// ClusterCache //
+//////////////////
+std::list<std::pair<ClusterCache::_Key, std::shared_ptr<const OutOfCoreMesh::Cluster>>> ClusterCache::_Clusters;
+std::map<ClusterCache::_Key, decltype(ClusterCache::_Clusters)::iterator> ClusterCache::_Positions;
+std::mutex ClusterCache::_Mutex;
+size_t ClusterCache::_Size = 0;
+size_t ClusterCache::_PageInNum = 0;
+size_t ClusterCache::_HitNum = 0;
+size_t ClusterCache::_BytesRead = 0;
+size_t ClusterCache::Budget = std::numeric_limits<size_t>::max();
+std::atomic<unsigned int> ClusterCache::_Generation(0);
+std::vector<std::shared_ptr<std::atomic<size_t>>> ClusterCache::_ThreadHitNums;
+
+struct ClusterCache::_ThreadCache {
+	_Key keys[ThreadCacheSize];
+	std::shared_ptr<const OutOfCoreMesh::Cluster> clusters[ThreadCacheSize];
+	unsigned int generation = 0;
+	int next = 0;
+	std::shared_ptr<std::atomic<size_t>> hitNum;
+};
+
+std::shared_ptr<const OutOfCoreMesh::Cluster> ClusterCache::Get(const OutOfCoreMesh* mesh, unsigned int c) {
+	static thread_local _ThreadCache threadCache;
+	const _Key key(mesh, c);
+	if (!threadCache.hitNum) {
+		threadCache.hitNum = std::make_shared<std::atomic<size_t>>(0);
+		std::lock_guard<std::mutex> lock(_Mutex);
+		_ThreadHitNums.push_back(threadCache.hitNum);
+	}
+
+	// The thread's own clusters are checked first, without locking
+	const unsigned int generation = _Generation.load(std::memory_order_acquire);
+	if (threadCache.generation != generation) {
+		for (int k = 0; k < ThreadCacheSize; k++) threadCache.clusters[k].reset();
+		threadCache.generation = generation;
+	}
+	for (int k = 0; k < ThreadCacheSize; k++)
+		if (threadCache.clusters[k] && threadCache.keys[k] == key) {
+			threadCache.hitNum->store(threadCache.hitNum->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return threadCache.clusters[k];
+		}
+
+	std::shared_ptr<const OutOfCoreMesh::Cluster> cluster = _Get(key);
+	threadCache.keys[threadCache.next] = key;
+	threadCache.clusters[threadCache.next] = cluster;
+	threadCache.next = (threadCache.next + 1) % ThreadCacheSize;
+	return cluster;
+}
+
+std::shared_ptr<const OutOfCoreMesh::Cluster> ClusterCache::_Get(const _Key& key) {
+	{
+		std::lock_guard<std::mutex> lock(_Mutex);
+		auto iter = _Positions.find(key);
+		if (iter != _Positions.end()) {
+			_HitNum++;
+			_Clusters.splice(_Clusters.begin(), _Clusters, iter->second);
+			return iter->second->second;
+		}
+	}
+
+	// The cluster is read without holding the lock, so that other threads' hits are not held up by the disk
+	std::shared_ptr<const OutOfCoreMesh::Cluster> cluster = key.first->readCluster(key.second);
+	const size_t size = cluster->memoryUsage();
+
+	std::lock_guard<std::mutex> lock(_Mutex);
+	_PageInNum++;
+	_BytesRead += size;
+
+	// Another thread may have paged the cluster in meanwhile, in which case its copy is kept
+	auto iter = _Positions.find(key);
+	if (iter != _Positions.end()) {
+		_Clusters.splice(_Clusters.begin(), _Clusters, iter->second);
+		return iter->second->second;
+	}
+
+	// Evict the least recently used clusters to make room (always keeping the new one, even if it alone exceeds the budget)
+	while (!_Clusters.empty() && _Size + size > Budget) {
+		_Size -= _Clusters.back().second->memoryUsage();
+		_Positions.erase(_Clusters.back().first);
+		_Clusters.pop_back();
+	}
+	_Clusters.emplace_front(key, cluster);
+	_Positions[key] = _Clusters.begin();
+	_Size += size;
+	return cluster;
+}
+
+void ClusterCache::Remove(const OutOfCoreMesh* mesh) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	_Generation++;
+	for (auto iter = _Clusters.begin(); iter != _Clusters.end();)
+		if (iter->first.first == mesh) {
+			_Size -= iter->second->memoryUsage();
+			_Positions.erase(iter->first);
+			iter = _Clusters.erase(iter);
+		}
+		else iter++;
+}
+
+size_t ClusterCache::PageInNum(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	return _PageInNum;
+}
+
+size_t ClusterCache::HitNum(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	size_t hitNum = _HitNum;
+	for (const std::shared_ptr<std::atomic<size_t>>& threadHitNum : _ThreadHitNums) hitNum += threadHitNum->load(std::memory_order_relaxed);
+	return hitNum;
+}
+
+size_t ClusterCache::BytesRead(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	return _BytesRead;
+}
+
+size_t ClusterCache::MemoryUsage(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	return _Size;
+}
@@ -0,0 +1,208 @@
+#ifndef OUT_OF_CORE_MESH_INCLUDED
+#define OUT_OF_CORE_MESH_INCLUDED
+
+#include <atomic>
+#include <cstdio>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Util/geometry.h>
+#include "shape.h"
+#include "triangle.h"
+
+namespace Ray {
+	/** This class represents a triangle mesh whose geometry lives on disk rather than in memory.
+	*** The triangles are partitioned into spatial clusters, each stored in a file together with a bounding-volume hierarchy over its triangles.
+	*** Only the hierarchy over the clusters stays resident; clusters are paged in on demand through the ClusterCache.
+	*** It reads the same directive as a TriangleList, and can be used in its place by registering it with the shape factories. */
+	class OutOfCoreMesh : public Shape {
+	public:
+		/** This class represents a node of a bounding-volume hierarchy.
+		*** Interior nodes have no items and their children are stored consecutively, starting at the first index.
+		*** Leaves reference the prescribed number of items, starting at the first index: triangles within a cluster, or a single cluster at the top level. */
+		struct Node {
+			Util::BoundingBox3D bBox;
+			unsigned int first, num;
+		};
+
+		/** This class stores a triangle of a cluster, with the attributes of its vertices */
+		struct ClusterTriangle {
+			Util::Point3D position[3], normal[3];
+			Util::Point2D texCoordinate[3];
+
+			/** The indices of the vertices in the scene's vertex list, used when writing the mesh back out */
+			unsigned int vIndices[3];
+		};
+
+		/** This class stores a cluster that has been paged in */
+		struct Cluster {
+			/** The hierarchy over the triangles, with the root first */
+			std::vector<Node> nodes;
+
+			/** The triangles, in the order in which the leaves reference them */
+			std::vector<ClusterTriangle> triangles;
+
+			/** This method returns the number of bytes used to store the cluster */
+			size_t memoryUsage(void) const;
+		};
+
+		/** The (maximum) number of triangles in a cluster */
+		static unsigned int ClusterSize;
+
+		/** The (maximum) number of triangles in a leaf of a cluster's hierarchy */
+		static const unsigned int LeafSize = 4;
+
+		/** The directory in which the cluster files are created (the system's temporary directory, if empty) */
+		static std::string Directory;
+
+	private:
+		/** The record of where a cluster is stored */
+		struct _ClusterRecord {
+			Util::BoundingBox3D bBox;
+			long long offset;
+			unsigned int nodeNum, triangleNum;
+		};
+
+		/** The triangles, as read from the stream (released once the clusters are written) */
+		std::vector<TriangleIndex> _triangles;
+
+		/** The number of triangles in the mesh */
+		size_t _tNum;
+
+		/** The resident hierarchy over the clusters, with the root first */
+		std::vector<Node> _nodes;
+
+		/** The clusters */
+		std::vector<_ClusterRecord> _clusters;
+
+		/** The file storing the clusters */
+		FILE* _file;
+
+		/** The name of the file storing the clusters (empty if it is an anonymous temporary file) */
+		std::string _fileName;
+
+		/** The mutex guarding accesses to the file */
+		mutable std::mutex _fileMutex;
+
+		/** The index of the material associated with the mesh */
+		int _materialIndex;
+
+		/** The material associated with the mesh */
+		const class Material* _material;
+
+		/** The information about a triangle used while partitioning the mesh */
+		struct _BuildTriangle;
+
+		/** This method recursively partitions the prescribed range of triangles into the subtree rooted at the prescribed node.
+		*** Ranges with no more than the leaf size are turned into leaves by the leaf function. */
+		static void _Build(std::vector<_BuildTriangle>& triangles, size_t start, size_t end, std::vector<Node>& nodes,
+		                   unsigned int node, unsigned int leafSize, const std::function<void (size_t, size_t, Node&)>& leaf);
+
+		/** This method writes out the cluster spanning the prescribed range of triangles and returns its index */
+		unsigned int _writeCluster(std::vector<_BuildTriangle>& triangles, size_t start, size_t end,
+		                           const class LocalSceneData& data);
+
+		/** This method intersects the ray with a paged-in cluster, updating the closest intersection if a closer valid one is found */
+		void _intersect(const Cluster& cluster, const SlabRay& slabRay, const Util::BoundingBox1D& range,
+		                const std::function<bool (double)>& validityLambda, double& t,
+		                class RayShapeIntersectionInfo& iInfo) const;
+
+	public:
+		/** This static method returns the directive describing the shape. */
+		static std::string Directive(void) { return "shape_triangles"; }
+
+		/** The default constructor */
+		OutOfCoreMesh(void);
+
+		/** The destructor closes (and removes) the cluster file and evicts the mesh's clusters from the cache */
+		~OutOfCoreMesh(void);
+
+		/** This method reads the prescribed cluster from disk */
+		std::shared_ptr<const Cluster> readCluster(unsigned int c) const;
+
+		/** This method returns the number of clusters */
+		size_t clusterNum(void) const { return _clusters.size(); }
+
+		///////////////////
+		// Shape methods //
+		///////////////////
+	private:
+		void _write(std::ostream& stream) const override;
+		void _read(std::istream& stream) override;
+	public:
+		std::string name(void) const override { return "out-of-core triangles"; }
+		void init(const class LocalSceneData& data) override;
+		void initOpenGL(void) override;
+		void updateBoundingBox(void) override;
+		double intersect(Util::Ray3D ray, class RayShapeIntersectionInfo& iInfo,
+		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
+		                 std::function<bool (double)> validityFunction = [](double t) { return true; }) const override;
+		void intersectBatch(class RayBatch& batch) const override;
+		bool isInside(Util::Point3D p) const override;
+		void drawOpenGL(GLSLProgram* glslProgram) const override;
+		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
+	};
+
+	/** This class is a process-wide least-recently-used cache of the clusters of out-of-core meshes, holding at most a budgeted number of bytes.
+	*** Clusters are handed out as shared pointers, so a cluster that is evicted remains valid for as long as it is in use.
+	*** Each thread also keeps the last few clusters it was handed, and checks them before taking the cache's lock,
+	*** so these may outlive their eviction (and exceed the budget) by up to ThreadCacheSize clusters per thread. */
+	class ClusterCache {
+		/** The key identifying a cluster */
+		typedef std::pair<const OutOfCoreMesh*, unsigned int> _Key;
+
+		/** The clusters most recently handed to a thread */
+		struct _ThreadCache;
+
+		/** The number of times a mesh's clusters have been removed. Threads drop the clusters they keep when it changes,
+		*** so that a new mesh allocated at the address of a removed one is not handed the removed mesh's clusters. */
+		static std::atomic<unsigned int> _Generation;
+
+		/** The number of requests served from each thread's clusters (each one is only written by its thread) */
+		static std::vector<std::shared_ptr<std::atomic<size_t>>> _ThreadHitNums;
+
+		/** This function returns the prescribed cluster from the shared cache, paging it in if it is not cached */
+		static std::shared_ptr<const OutOfCoreMesh::Cluster> _Get(const _Key& key);
+
+		/** The cached clusters, with the most recently used first */
+		static std::list<std::pair<_Key, std::shared_ptr<const OutOfCoreMesh::Cluster>>> _Clusters;
+
+		/** The positions of the cached clusters in the list */
+		static std::map<_Key, decltype(_Clusters)::iterator> _Positions;
+
+		/** The mutex guarding the cache */
+		static std::mutex _Mutex;
+
+		/** The number of bytes used by the cached clusters */
+		static size_t _Size;
+
+		/** The statistics */
+		static size_t _PageInNum, _HitNum, _BytesRead;
+
+	public:
+		/** The maximum number of bytes the cached clusters may use */
+		static size_t Budget;
+
+		/** The number of clusters each thread keeps */
+		static const int ThreadCacheSize = 4;
+
+		/** This function returns the prescribed cluster of the mesh, paging it in (and evicting the least recently used clusters) if it is not cached */
+		static std::shared_ptr<const OutOfCoreMesh::Cluster> Get(const OutOfCoreMesh* mesh, unsigned int c);
+
+		/** This function evicts all the clusters of the mesh */
+		static void Remove(const OutOfCoreMesh* mesh);
+
+		/** These functions return the number of clusters paged in, the number of requests served from the cache, and the number of bytes paged in */
+		static size_t PageInNum(void);
+		static size_t HitNum(void);
+		static size_t BytesRead(void);
+
+		/** This function returns the number of bytes used by the cached clusters */
+		static size_t MemoryUsage(void);
+	};
+}
+#endif // OUT_OF_CORE_MESH_INCLUDED
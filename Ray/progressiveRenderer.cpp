@@ -0,0 +1,122 @@
+#include <vector>
+#include <algorithm>
+#include <Util/threadPool.h>
+#include "progressiveRenderer.h"
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+namespace {
+	/** The refinement schedule: each level divides the resolution by the scale and uses
+	*** the prescribed number of light samples (zero meaning the full number) */
+	struct RefinementLevel {
+		int scale;
+		unsigned int lightSamples;
+	};
+
+	const RefinementLevel RefinementLevels[] = { { 8, 1 }, { 4, 1 }, { 2, 1 }, { 1, 1 }, { 1, 0 } };
+
+	/** The size of the tiles handed out to the thread pool.
+	*** Small tiles keep the latency of abandoning a view low. */
+	const int PreviewTileSize = 16;
+}
+
+/////////////////////////
+// ProgressiveRenderer //
+/////////////////////////
+const int ProgressiveRenderer::LevelNum = sizeof(RefinementLevels) / sizeof(RefinementLevel);
+
+ProgressiveRenderer::ProgressiveRenderer(Scene& scene, int rLimit, double cLimit, unsigned int lightSamples)
+	: _scene(scene), _rLimit(rLimit), _cLimit(cLimit), _lightSamples(lightSamples), _width(0), _height(0),
+	  _generation(0), _quit(false), _level(-1), _imageIsNew(false) {
+	_thread = std::thread(&ProgressiveRenderer::_run, this);
+}
+
+ProgressiveRenderer::~ProgressiveRenderer(void) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+		_generation++;
+	}
+	_condition.notify_all();
+	_thread.join();
+}
+
+void ProgressiveRenderer::restart(const Camera& camera, int width, int height) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_camera = camera;
+		_width = width, _height = height;
+		_level = -1;
+		_imageIsNew = false;
+		_generation++;
+	}
+	_condition.notify_all();
+}
+
+bool ProgressiveRenderer::update(Image32& img) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_imageIsNew)
+		return false;
+	img = _image;
+	_imageIsNew = false;
+	return true;
+}
+
+int ProgressiveRenderer::level(void) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _level;
+}
+
+void ProgressiveRenderer::_run(void) {
+	unsigned int renderedGeneration = 0;
+	while (true) {
+		// Wait for a view that has not been rendered
+		Camera camera;
+		int width, height;
+		unsigned int generation;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [&] { return _quit || _generation != renderedGeneration; });
+			if (_quit)
+				return;
+			camera = _camera;
+			width = _width, height = _height;
+			generation = renderedGeneration = _generation;
+		}
+		if (width <= 0 || height <= 0)
+			continue;
+
+		for (int l = 0; l < LevelNum && generation == _generation; l++) {
+			const int w = std::max<int>(1, width / RefinementLevels[l].scale);
+			const int h = std::max<int>(1, height / RefinementLevels[l].scale);
+			const unsigned int lightSamples = RefinementLevels[l].lightSamples
+				                                  ? std::min<unsigned int>(RefinementLevels[l].lightSamples, _lightSamples)
+				                                  : _lightSamples;
+
+			Image32 img;
+			img.setSize(w, h);
+			const std::vector<ImageTile> tiles = ImageTile::Partition(w, h, PreviewTileSize);
+
+			// The tiles run on the shared pool, and are skipped once the view changes
+			ThreadPool::Default().parallelFor(0, tiles.size(), [&](size_t t) {
+				if (generation != _generation)
+					return;
+				const ImageTile& tile = tiles[t];
+				Image32 tileImage = _scene.rayTraceTile(camera, w, h, tile, _rLimit, _cLimit, lightSamples);
+				for (int j = 0; j < tile.height(); j++)
+					for (int i = 0; i < tile.width(); i++)
+						img(tile.x0 + i, tile.y0 + j) = tileImage(i, j);
+			});
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (generation != _generation)
+				break;
+			_image = std::move(img);
+			_level = l;
+			_imageIsNew = true;
+		}
+	}
+}
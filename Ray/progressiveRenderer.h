@@ -0,0 +1,78 @@
+#ifndef PROGRESSIVE_RENDERER_INCLUDED
+#define PROGRESSIVE_RENDERER_INCLUDED
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <Image/image.h>
+#include "camera.h"
+#include "scene.h"
+
+namespace Ray {
+	/** This class ray-traces a scene in the background, for interactive preview.
+	*** Each view is first rendered at a coarse resolution and then refined, level by level, up to full resolution with the full number of light samples.
+	*** Requesting a new view abandons the current one as soon as the tiles in flight are done.
+	*** The scene must not be modified while the renderer is running. */
+	class ProgressiveRenderer {
+		/** The scene being rendered */
+		Scene& _scene;
+
+		/** The rendering parameters */
+		int _rLimit;
+		double _cLimit;
+		unsigned int _lightSamples;
+
+		/** The mutex and condition variable guarding the view and the result */
+		std::mutex _mutex;
+		std::condition_variable _condition;
+
+		/** The requested view */
+		Camera _camera;
+		int _width, _height;
+
+		/** The generation of the requested view, incremented with every request */
+		std::atomic<unsigned int> _generation;
+
+		/** Has the renderer been asked to stop */
+		bool _quit;
+
+		/** The most refined image rendered for the current view */
+		Image::Image32 _image;
+
+		/** The refinement level of the image (-1 if none is available) */
+		int _level;
+
+		/** Has the image been updated since it was last retrieved */
+		bool _imageIsNew;
+
+		/** The thread scheduling the rendering */
+		std::thread _thread;
+
+		/** The function run by the scheduling thread */
+		void _run(void);
+
+	public:
+		/** The number of refinement levels */
+		static const int LevelNum;
+
+		/** The constructor starts the scheduling thread. The tiles are rendered on the process-wide thread pool. */
+		ProgressiveRenderer(Scene& scene, int rLimit, double cLimit, unsigned int lightSamples);
+
+		/** The destructor stops the scheduling thread */
+		~ProgressiveRenderer(void);
+
+		ProgressiveRenderer(const ProgressiveRenderer&) = delete;
+		ProgressiveRenderer& operator =(const ProgressiveRenderer&) = delete;
+
+		/** This method (re)starts rendering the view from the prescribed camera into a width x height image */
+		void restart(const Camera& camera, int width, int height);
+
+		/** This method returns true and sets the image if a more refined image has become available since the last call */
+		bool update(Image::Image32& img);
+
+		/** This method returns the refinement level of the most recent image (-1 if none is available) */
+		int level(void);
+	};
+}
+#endif // PROGRESSIVE_RENDERER_INCLUDED
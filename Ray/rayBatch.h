@@ -0,0 +1,33 @@
+#ifndef RAY_BATCH_INCLUDED
+#define RAY_BATCH_INCLUDED
+
+#include <vector>
+#include <Util/geometry.h>
+#include "scene.h"
+
+namespace Ray {
+	/** This class stores a batch of rays that are traced through the scene together, along with the closest intersection found so far for each.
+	*** Tracing rays in batches lets shapes share work across rays, e.g. paging in a block of geometry once for all the rays that reach it.
+	*** All rays in a batch use the default range, starting at Epsilon, and the trivial validity function. */
+	class RayBatch {
+	public:
+		/** The rays */
+		std::vector<Util::Ray3D> rays;
+
+		/** The parameter of the closest intersection found for each ray (Infinity if none has been found) */
+		std::vector<double> t;
+
+		/** The intersection information for each ray, set if an intersection has been found */
+		std::vector<RayShapeIntersectionInfo> iInfo;
+
+		/** This method returns the number of rays in the batch */
+		size_t size(void) const { return rays.size(); }
+
+		/** This method removes all the rays from the batch (keeping the allocated memory) */
+		void clear(void) { rays.clear(), t.clear(), iInfo.clear(); }
+
+		/** This method adds a ray, without an intersection, to the batch */
+		void add(const Util::Ray3D& ray) { rays.push_back(ray), t.push_back(Util::Infinity), iInfo.emplace_back(); }
+	};
+}
+#endif // RAY_BATCH_INCLUDED
@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <Util/exceptions.h>
+#include <Util/fileIO.h>
+#include <Util/timer.h>
+#include "renderCheckpoint.h"
+
+#if defined( _WIN32 ) || defined( _WIN64 )
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif // !NOMINMAX
+#include <windows.h>
+#endif // _WIN32 || _WIN64
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+namespace {
+	/** The values identifying the file format */
+	const char CheckpointMagic[] = "RAYCKPT";
+	const unsigned int CheckpointVersion = 2;
+
+	/** These functions read/write a value in (native) binary form */
+	template <typename T>
+	bool ReadValue(FILE* fp, T& value) { return fread(&value, sizeof(T), 1, fp) == 1; }
+
+	template <typename T>
+	bool WriteValue(FILE* fp, const T& value) { return fwrite(&value, sizeof(T), 1, fp) == 1; }
+}
+
+//////////////////////
+// RenderCheckpoint //
+//////////////////////
+RenderCheckpoint::RenderCheckpoint(const Scene& scene, int width, int height, int rLimit, double cLimit,
+                                   unsigned int lightSamples, int tileSize)
+	: _sceneHash(scene.hash()), _settingsHash(Scene::SettingsHash()), _width(width), _height(height), _rLimit(rLimit), _tileSize(tileSize), _cLimit(cLimit),
+	  _lightSamples(lightSamples) {
+	_tiles = ImageTile::Partition(width, height, tileSize);
+	_completed.resize(_tiles.size(), 0);
+	_image.setSize(width, height);
+}
+
+bool RenderCheckpoint::read(const std::string& fileName) {
+	FILE* fp = fopen(fileName.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	char magic[sizeof(CheckpointMagic)];
+	unsigned int version, lightSamples;
+	unsigned long long sceneHash, settingsHash;
+	int width, height, rLimit, tileSize;
+	double cLimit;
+	bool success = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) && !memcmp(magic, CheckpointMagic, sizeof(magic)) &&
+		ReadValue(fp, version) && version == CheckpointVersion;
+	success = success && ReadValue(fp, sceneHash) && ReadValue(fp, settingsHash) && ReadValue(fp, width) &&
+		ReadValue(fp, height) && ReadValue(fp, rLimit) && ReadValue(fp, cLimit) && ReadValue(fp, lightSamples) &&
+		ReadValue(fp, tileSize);
+	if (!success) {
+		fclose(fp);
+		THROW("not a valid checkpoint file: %s", fileName.c_str());
+	}
+	if (sceneHash != _sceneHash) {
+		fclose(fp);
+		THROW("checkpoint was written for a different scene: %s", fileName.c_str());
+	}
+	if (settingsHash != _settingsHash) {
+		fclose(fp);
+		THROW("checkpoint was written with different settings (e.g. --roulette, --adaptive, --singlePrecision, --cull): %s",
+		      fileName.c_str());
+	}
+	if (width != _width || height != _height || rLimit != _rLimit || cLimit != _cLimit ||
+		lightSamples != _lightSamples || tileSize != _tileSize) {
+		fclose(fp);
+		THROW("checkpoint was written with different render parameters: %s", fileName.c_str());
+	}
+
+	success = fread(&_completed[0], 1, _completed.size(), fp) == _completed.size() &&
+		fread(&_image(0, 0), sizeof(Pixel32), static_cast<size_t>(_width) * _height, fp) ==
+		static_cast<size_t>(_width) * _height;
+	fclose(fp);
+	if (!success) {
+		std::fill(_completed.begin(), _completed.end(), 0);
+		THROW("truncated checkpoint file: %s", fileName.c_str());
+	}
+	return true;
+}
+
+void RenderCheckpoint::write(const std::string& fileName) const {
+	const std::string tempFileName = fileName + ".tmp";
+	FILE* fp = fopen(tempFileName.c_str(), "wb");
+	if (!fp)
+		THROW("failed to open file for writing: %s", tempFileName.c_str());
+
+	bool success = fwrite(CheckpointMagic, 1, sizeof(CheckpointMagic), fp) == sizeof(CheckpointMagic) &&
+		WriteValue(fp, CheckpointVersion);
+	success = success && WriteValue(fp, _sceneHash) && WriteValue(fp, _settingsHash) && WriteValue(fp, _width) &&
+		WriteValue(fp, _height) && WriteValue(fp, _rLimit) && WriteValue(fp, _cLimit) && WriteValue(fp, _lightSamples) &&
+		WriteValue(fp, _tileSize);
+	success = success && fwrite(&_completed[0], 1, _completed.size(), fp) == _completed.size() &&
+		fwrite(&_image(0, 0), sizeof(Pixel32), static_cast<size_t>(_width) * _height, fp) ==
+		static_cast<size_t>(_width) * _height;
+	// The contents must reach the disk before the rename, or a crash could leave the checkpoint renamed but not written
+	success = success && Sync(fp) == 0;
+	success = fclose(fp) == 0 && success;
+	if (!success) {
+		remove(tempFileName.c_str());
+		THROW("failed to write checkpoint: %s", tempFileName.c_str());
+	}
+
+	// Replace the previous checkpoint in one step
+#if defined( _WIN32 ) || defined( _WIN64 )
+	// On Windows rename fails if the destination exists, so the file is moved over it instead
+	const bool replaced = MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else // !_WIN32 && !_WIN64
+	const bool replaced = rename(tempFileName.c_str(), fileName.c_str()) == 0;
+#endif // _WIN32 || _WIN64
+	if (!replaced)
+		THROW("failed to replace checkpoint: %s", fileName.c_str());
+}
+
+size_t RenderCheckpoint::completedNum(void) const {
+	size_t count = 0;
+	for (size_t t = 0; t < _completed.size(); t++)
+		if (_completed[t])
+			count++;
+	return count;
+}
+
+void RenderCheckpoint::rayTrace(Scene& scene, const std::string& fileName, double interval) {
+	scene.updateBoundingBox();
+
+	Timer timer;
+	for (size_t t = 0; t < _tiles.size(); t++) {
+		if (_completed[t])
+			continue;
+		const ImageTile& tile = _tiles[t];
+		Image32 img = scene.rayTraceTile(_width, _height, tile, _rLimit, _cLimit, _lightSamples);
+		for (int j = 0; j < tile.height(); j++)
+			for (int i = 0; i < tile.width(); i++)
+				_image(tile.x0 + i, tile.y0 + j) = img(i, j);
+		_completed[t] = 1;
+
+		if (timer.elapsed() >= interval) {
+			write(fileName);
+			timer.reset();
+		}
+	}
+	write(fileName);
+}
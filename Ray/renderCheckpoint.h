@@ -0,0 +1,54 @@
+#ifndef RENDER_CHECKPOINT_INCLUDED
+#define RENDER_CHECKPOINT_INCLUDED
+
+#include <string>
+#include <vector>
+#include <Image/image.h>
+#include "scene.h"
+
+namespace Ray {
+	/** This class stores the state of a partially completed, tiled, ray-tracing job so that it can be resumed after the process is stopped.
+	*** The state consists of the render parameters, hashes of the scene and of the settings that change the pixels (see Scene::SettingsHash),
+	*** the set of completed tiles, and the pixels rendered so far. */
+	class RenderCheckpoint {
+		/** The hashes of the scene being rendered and of the settings with which it is rendered */
+		unsigned long long _sceneHash, _settingsHash;
+
+		/** The render parameters */
+		int _width, _height, _rLimit, _tileSize;
+		double _cLimit;
+		unsigned int _lightSamples;
+
+		/** The tiles of the image */
+		std::vector<ImageTile> _tiles;
+
+		/** Has the corresponding tile been completed */
+		std::vector<unsigned char> _completed;
+
+		/** The image */
+		Image::Image32 _image;
+
+	public:
+		/** The constructor sets up an empty checkpoint for rendering the scene with the prescribed parameters */
+		RenderCheckpoint(const Scene& scene, int width, int height, int rLimit, double cLimit, unsigned int lightSamples,
+		                 int tileSize);
+
+		/** This method reads the completed tiles in from a checkpoint file, returning false if the file does not exist.
+		*** An exception is thrown if the file is corrupt or was written for a different scene or with different parameters or settings. */
+		bool read(const std::string& fileName);
+
+		/** This method writes the checkpoint out to a file.
+		*** The data is first written to a temporary file which then replaces the checkpoint, so the checkpoint is never left partially written. */
+		void write(const std::string& fileName) const;
+
+		/** This method returns the number of completed tiles */
+		size_t completedNum(void) const;
+
+		/** This method returns the (possibly partial) image */
+		const Image::Image32& image(void) const { return _image; }
+
+		/** This method ray-traces the tiles that have not been completed, writing a checkpoint every interval seconds (and once done). */
+		void rayTrace(Scene& scene, const std::string& fileName, double interval);
+	};
+}
+#endif // RENDER_CHECKPOINT_INCLUDED
@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <algorithm>
+#include <Util/exceptions.h>
+#include "renderCostMap.h"
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+namespace {
+	/** The colors through which the normalized cost is interpolated */
+	const float HeatMapColors[][3] = {
+		{0.f, 0.f, 0.f},
+		{0.f, 0.f, 1.f},
+		{0.8f, 0.f, 0.8f},
+		{1.f, 0.55f, 0.f},
+		{1.f, 1.f, 0.6f}
+	};
+	const int HeatMapColorNum = sizeof(HeatMapColors) / sizeof(HeatMapColors[0]);
+
+	/** This function returns the false color for a cost in the range [0,1] */
+	Pixel32 HeatMapColor(float v) {
+		v = std::min<float>(std::max<float>(v, 0.f), 1.f) * (HeatMapColorNum - 1);
+		int i = std::min<int>(static_cast<int>(v), HeatMapColorNum - 2);
+		float s = v - i;
+		Pixel32 p;
+		p.r = static_cast<unsigned char>((HeatMapColors[i][0] * (1.f - s) + HeatMapColors[i + 1][0] * s) * 255);
+		p.g = static_cast<unsigned char>((HeatMapColors[i][1] * (1.f - s) + HeatMapColors[i + 1][1] * s) * 255);
+		p.b = static_cast<unsigned char>((HeatMapColors[i][2] * (1.f - s) + HeatMapColors[i + 1][2] * s) * 255);
+		return p;
+	}
+}
+
+///////////////////
+// RenderCostMap //
+///////////////////
+const char* RenderCostMap::ChannelNames[] = {"rays", "bBoxTests", "primitiveTests", "time"};
+
+RenderCostMap::RenderCostMap(void) : _width(0), _height(0) {}
+
+void RenderCostMap::resize(int width, int height) {
+	_width = width, _height = height;
+	_costs.assign(static_cast<size_t>(width) * height * CHANNEL_NUM, 0.f);
+}
+
+float RenderCostMap::maximum(int channel) const {
+	float m = 0;
+	for (size_t i = channel; i < _costs.size(); i += CHANNEL_NUM)
+		m = std::max<float>(m, _costs[i]);
+	return m;
+}
+
+Image32 RenderCostMap::heatMap(int channel) const {
+	Image32 img;
+	img.setSize(_width, _height);
+	float m = maximum(channel);
+	for (int j = 0; j < _height; j++)
+		for (int i = 0; i < _width; i++)
+			img(i, j) = HeatMapColor(m > 0 ? (*this)(i, j, channel) / m : 0.f);
+	return img;
+}
+
+void RenderCostMap::write(const std::string& fileName) const {
+	size_t dot = fileName.find_last_of('.');
+	if (dot == std::string::npos)
+		THROW("image file name has no extension: %s", fileName.c_str());
+	std::string header = fileName.substr(0, dot), ext = fileName.substr(dot + 1);
+
+	for (int c = 0; c < CHANNEL_NUM; c++)
+		heatMap(c).write(header + "." + ChannelNames[c] + "." + ext);
+
+	std::string costFileName = header + ".cost";
+	FILE* fp = fopen(costFileName.c_str(), "wb");
+	if (!fp)
+		THROW("failed to open file for writing: %s", costFileName.c_str());
+	bool success = fprintf(fp, "COST %d %d %d\n", _width, _height, static_cast<int>(CHANNEL_NUM)) > 0 &&
+		fwrite(_costs.data(), sizeof(float), _costs.size(), fp) == _costs.size();
+	success = fclose(fp) == 0 && success;
+	if (!success)
+		THROW("failed to write costs: %s", costFileName.c_str());
+}
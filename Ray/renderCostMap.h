@@ -0,0 +1,60 @@
+#ifndef RENDER_COST_MAP_INCLUDED
+#define RENDER_COST_MAP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <Image/image.h>
+
+namespace Ray {
+	/** This class stores, for every pixel of a rendered image, what it cost to ray-trace the pixel:
+	*** the number of rays cast, bounding-box tests, and primitive tests (as counted by RayTracingStats) and the wall-clock time. */
+	class RenderCostMap {
+		/** The dimensions of the image */
+		int _width, _height;
+
+		/** The per-pixel costs, stored channel-interleaved in row-major order */
+		std::vector<float> _costs;
+
+	public:
+		/** The cost channels */
+		enum {
+			RAYS,
+			BOUNDING_BOX_TESTS,
+			PRIMITIVE_TESTS,
+			SECONDS,
+			CHANNEL_NUM
+		};
+
+		/** The names of the channels, used to name the heat-map files */
+		static const char* ChannelNames[CHANNEL_NUM];
+
+		/** The default constructor creates an empty map */
+		RenderCostMap(void);
+
+		/** This method resizes the map, zeroing out all the costs */
+		void resize(int width, int height);
+
+		/** These methods return the dimensions of the map */
+		int width(void) const { return _width; }
+		int height(void) const { return _height; }
+
+		/** These methods return the cost of the prescribed pixel in the prescribed channel */
+		float& operator()(int x, int y, int channel) { return _costs[(static_cast<size_t>(y) * _width + x) * CHANNEL_NUM + channel]; }
+		const float& operator()(int x, int y, int channel) const {
+			return _costs[(static_cast<size_t>(y) * _width + x) * CHANNEL_NUM + channel];
+		}
+
+		/** This method returns the maximum cost in the prescribed channel */
+		float maximum(int channel) const;
+
+		/** This method returns a false-color image of the prescribed channel, with costs normalized by the channel's maximum.
+		*** Costs are mapped from black (none), through blue, magenta and orange, to yellow (most expensive). */
+		Image::Image32 heatMap(int channel) const;
+
+		/** This method writes out the heat maps and the raw costs, deriving the file names from the name of the rendered image.
+		*** For an image "<header>.<ext>" the heat map of each channel is written to "<header>.<channel>.<ext>" and the raw costs to "<header>.cost".
+		*** The raw file consists of a text line "COST <width> <height> <channels>" followed by the channel-interleaved, row-major, (native) 32-bit floats. */
+		void write(const std::string& fileName) const;
+	};
+}
+#endif // RENDER_COST_MAP_INCLUDED
@@ -0,0 +1,210 @@
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <Util/exceptions.h>
+#include <Util/socket.h>
+#include "renderFarm.h"
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+////////////////
+// RenderFarm //
+////////////////
+const unsigned int RenderFarm::Magic = 0x52415946; // "RAYF"
+const unsigned int RenderFarm::Version = 2;
+
+namespace {
+	/** The commands sent from the coordinator to the workers */
+	enum {
+		COMMAND_TILE = 1,
+		COMMAND_DONE = 2
+	};
+
+	/** The state shared between the threads servicing the workers */
+	struct TileQueue {
+		/** The tiles */
+		std::vector<ImageTile> tiles;
+
+		/** The indices of the tiles that have not been handed out */
+		std::deque<size_t> pending;
+
+		/** The number of tiles that have not been received */
+		size_t remaining;
+
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		/** This method blocks until a tile is available, returning false if all tiles have been received */
+		bool pop(size_t& t) {
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&] { return !pending.empty() || !remaining; });
+			if (!remaining)
+				return false;
+			t = pending.front();
+			pending.pop_front();
+			return true;
+		}
+
+		/** This method returns a tile whose worker failed to the front of the queue */
+		void requeue(size_t t) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pending.push_front(t);
+			}
+			condition.notify_all();
+		}
+
+		/** This method marks a tile as received */
+		void complete(void) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				remaining--;
+			}
+			condition.notify_all();
+		}
+
+		/** This method returns true if all tiles have been received */
+		bool done(void) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return !remaining;
+		}
+	};
+
+	/** This function services a single worker until all tiles have been received or the worker fails */
+	void ServiceWorker(Socket socket, unsigned long long sceneHash, unsigned long long settingsHash, int width, int height,
+	                   int rLimit, double cLimit, unsigned int lightSamples, double timeout, TileQueue& queue, Image32& img) {
+		socket.setTimeout(timeout);
+
+		// Handshake
+		uint32_t magic, version;
+		uint64_t hash, settings;
+		if (!socket.receiveUInt(magic) || !socket.receiveUInt(version) || !socket.receiveUInt64(hash) ||
+			!socket.receiveUInt64(settings)) {
+			WARN("failed to receive worker handshake");
+			return;
+		}
+		// The workers must render with the same settings, or their tiles would not match
+		if (magic != RenderFarm::Magic || version != RenderFarm::Version || hash != sceneHash || settings != settingsHash) {
+			WARN("rejecting worker: protocol, scene, or settings mismatch");
+			socket.sendUInt(0);
+			return;
+		}
+		if (!socket.sendUInt(1) || !socket.sendUInt(width) || !socket.sendUInt(height) || !socket.sendUInt(rLimit) ||
+			!socket.sendDouble(cLimit) || !socket.sendUInt(lightSamples)) {
+			WARN("failed to send job to worker");
+			return;
+		}
+
+		size_t t;
+		std::vector<Pixel32> pixels;
+		while (queue.pop(t)) {
+			const ImageTile& tile = queue.tiles[t];
+			bool success = socket.sendUInt(COMMAND_TILE) && socket.sendUInt(tile.x0) && socket.sendUInt(tile.y0) &&
+				socket.sendUInt(tile.x1) && socket.sendUInt(tile.y1);
+
+			uint32_t x0, y0, x1, y1;
+			success = success && socket.receiveUInt(x0) && socket.receiveUInt(y0) && socket.receiveUInt(x1) &&
+				socket.receiveUInt(y1);
+			success = success && x0 == tile.x0 && y0 == tile.y0 && x1 == tile.x1 && y1 == tile.y1;
+			if (success) {
+				pixels.resize(static_cast<size_t>(tile.width()) * tile.height());
+				success = socket.receive(&pixels[0], sizeof(Pixel32) * pixels.size());
+			}
+			if (!success) {
+				WARN("worker failed on tile [%d,%d) x [%d,%d), re-issuing", tile.x0, tile.x1, tile.y0, tile.y1);
+				queue.requeue(t);
+				return;
+			}
+
+			// Tiles are disjoint so no lock is needed to write the pixels
+			for (int j = 0; j < tile.height(); j++)
+				for (int i = 0; i < tile.width(); i++)
+					img(tile.x0 + i, tile.y0 + j) = pixels[j * tile.width() + i];
+			queue.complete();
+		}
+		socket.sendUInt(COMMAND_DONE);
+	}
+}
+
+Image32 RenderFarm::Coordinate(const Scene& scene, int port, int width, int height, int rLimit, double cLimit,
+                               unsigned int lightSamples, int tileSize, double timeout) {
+	Image32 img;
+	img.setSize(width, height);
+
+	TileQueue queue;
+	queue.tiles = ImageTile::Partition(width, height, tileSize);
+	for (size_t t = 0; t < queue.tiles.size(); t++)
+		queue.pending.push_back(t);
+	queue.remaining = queue.tiles.size();
+
+	const unsigned long long sceneHash = scene.hash(), settingsHash = Scene::SettingsHash();
+	ListenSocket listenSocket(port);
+	std::cout << "\tWaiting for workers on port " << listenSocket.port() << " (" << queue.tiles.size() << " tiles)" <<
+		std::endl;
+
+	// Accept workers until all of the tiles are in
+	std::vector<std::thread> threads;
+	while (!queue.done()) {
+		if (!listenSocket.waitForConnection(0.25))
+			continue;
+		Socket socket = listenSocket.accept();
+		if (!socket.isValid())
+			continue;
+		threads.emplace_back(ServiceWorker, std::move(socket), sceneHash, settingsHash, width, height, rLimit, cLimit,
+		                     lightSamples, timeout, std::ref(queue), std::ref(img));
+	}
+	for (auto& thread : threads)
+		thread.join();
+	return img;
+}
+
+size_t RenderFarm::Work(Scene& scene, const std::string& host, int port) {
+	// The coordinator may not be listening yet, so retry for a while
+	Socket socket;
+	for (int tries = 0; !socket.isValid(); tries++) {
+		try { socket = Socket::Connect(host, port); }
+		catch (const Exception&) {
+			if (tries == 9)
+				throw;
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+		}
+	}
+
+	uint32_t accepted;
+	if (!socket.sendUInt(Magic) || !socket.sendUInt(Version) || !socket.sendUInt64(scene.hash()) ||
+		!socket.sendUInt64(Scene::SettingsHash()) || !socket.receiveUInt(accepted))
+		THROW("failed to perform handshake with coordinator: %s:%d", host.c_str(), port);
+	if (!accepted)
+		THROW("coordinator rejected worker (is it rendering the same scene, with the same settings?)");
+
+	uint32_t width, height, rLimit, lightSamples;
+	double cLimit;
+	if (!socket.receiveUInt(width) || !socket.receiveUInt(height) || !socket.receiveUInt(rLimit) ||
+		!socket.receiveDouble(cLimit) || !socket.receiveUInt(lightSamples))
+		THROW("failed to receive job from coordinator");
+
+	scene.updateBoundingBox();
+
+	size_t tileNum = 0;
+	uint32_t command;
+	while (socket.receiveUInt(command) && command == COMMAND_TILE) {
+		uint32_t x0, y0, x1, y1;
+		if (!socket.receiveUInt(x0) || !socket.receiveUInt(y0) || !socket.receiveUInt(x1) || !socket.receiveUInt(y1))
+			THROW("failed to receive tile from coordinator");
+		ImageTile tile(x0, y0, x1, y1);
+		Image32 img = scene.rayTraceTile(width, height, tile, rLimit, cLimit, lightSamples);
+		if (!socket.sendUInt(x0) || !socket.sendUInt(y0) || !socket.sendUInt(x1) || !socket.sendUInt(y1) ||
+			!socket.send(&img(0, 0), sizeof(Pixel32) * tile.width() * tile.height()))
+			THROW("failed to send tile to coordinator");
+		tileNum++;
+	}
+	if (!socket.isValid())
+		WARN("lost connection to coordinator");
+	return tileNum;
+}
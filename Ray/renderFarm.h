@@ -0,0 +1,33 @@
+#ifndef RENDER_FARM_INCLUDED
+#define RENDER_FARM_INCLUDED
+
+#include <string>
+#include <Image/image.h>
+#include "scene.h"
+
+namespace Ray {
+	/** This class distributes the ray-tracing of an image across multiple processes.
+	*** A coordinator partitions the image into tiles and hands them out over TCP to the workers that connect to it.
+	*** Each worker reads in the same .ray file, ray-traces the tiles it is given, and sends back the pixels.
+	*** Workers whose scene or pixel-changing settings (see Scene::SettingsHash) differ from the coordinator's are turned away.
+	*** If a worker fails (or times out) its outstanding tile is handed to another worker. */
+	class RenderFarm {
+	public:
+		/** The value identifying the protocol in the handshake */
+		static const unsigned int Magic;
+
+		/** The version of the protocol */
+		static const unsigned int Version;
+
+		/** This static method listens on the prescribed port, hands out tiles of size tileSize x tileSize to the workers
+		*** that connect, and returns the assembled image once all tiles have been received.
+		*** A worker that does not return a tile within timeout seconds is dropped and its tile is re-issued. */
+		static Image::Image32 Coordinate(const Scene& scene, int port, int width, int height, int rLimit, double cLimit,
+		                                 unsigned int lightSamples, int tileSize, double timeout);
+
+		/** This static method connects to the coordinator at the prescribed host and port and ray-traces the tiles
+		*** it is given until the coordinator reports that the image is done. It returns the number of tiles rendered. */
+		static size_t Work(Scene& scene, const std::string& host, int port);
+	};
+}
+#endif // RENDER_FARM_INCLUDED
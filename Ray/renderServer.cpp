@@ -0,0 +1,112 @@
+#include <cmath>
+#include <sstream>
+#include <iostream>
+#include <limits>
+#include <Util/cmdLineParser.h>
+#include <Util/exceptions.h>
+#include <Util/socket.h>
+#include <Util/timer.h>
+#include "renderServer.h"
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+//////////////////
+// RenderServer //
+//////////////////
+size_t RenderServer::Serve(Scene& scene, int port) {
+	ListenSocket listenSocket(port, true);
+	std::cout << "\tServing on port " << listenSocket.port() << std::endl;
+
+	// Everything that does not depend on the request is done once, up front
+	scene.updateBoundingBox();
+	const Camera camera = scene._globalData.camera;
+
+	size_t requestNum = 0;
+	bool quit = false;
+	while (!quit) {
+		Socket socket = listenSocket.accept();
+		std::string line;
+		while (!quit && socket.receiveLine(line)) {
+			Timer timer;
+			std::stringstream stream(line);
+			std::string command;
+			stream >> command;
+			if (command == "quit") {
+				socket.sendString("OK 0 0\n");
+				quit = true;
+				continue;
+			}
+
+			try {
+				if (command != "render")
+					THROW("unrecognized command: %s", command.c_str());
+
+				// Each field is validated before anything is rendered
+				// (the light samples are read as a signed value, as a negative count would otherwise wrap to a huge one)
+				int width, height, rLimit;
+				double cLimit;
+				long long lightSamples;
+				std::string ext, token;
+				stream >> width >> height >> rLimit >> cLimit >> lightSamples >> ext;
+				if (!stream)
+					THROW("poorly formed request: %s", line.c_str());
+				if (width <= 0 || height <= 0)
+					THROW("resolution must be positive: %d x %d", width, height);
+				if (width > MaxResolution || height > MaxResolution ||
+					static_cast<long long>(width) * height > MaxPixelNum)
+					THROW("resolution too large: %d x %d", width, height);
+				if (rLimit < 0)
+					THROW("recursion limit must be non-negative: %d", rLimit);
+				if (!std::isfinite(cLimit) || cLimit < 0)
+					THROW("cut-off must be non-negative: %g", cLimit);
+				if (lightSamples < 0 || lightSamples > std::numeric_limits<unsigned int>::max())
+					THROW("light samples out of range: %lld", lightSamples);
+				if (ToLower(ext) != "bmp" && ToLower(ext) != "jpg" && ToLower(ext) != "jpeg")
+					THROW("unrecognized image format: %s", ext.c_str());
+
+				Camera requestCamera = camera;
+				if (stream >> token) {
+					if (token != "camera")
+						THROW("expected camera: %s", token.c_str());
+					if (!(stream >> requestCamera))
+						THROW("poorly formed camera: %s", line.c_str());
+					if (!std::isfinite(requestCamera.heightAngle) || requestCamera.heightAngle <= 0 || requestCamera.heightAngle >= Pi)
+						THROW("camera's height angle must be in (0,pi): %g", requestCamera.heightAngle);
+					// A zero direction normalizes to NaNs, and parallel directions leave the right vector zero
+					const double rightLength = requestCamera.right.length();
+					if (!std::isfinite(rightLength) || rightLength < 1e-8)
+						THROW("camera's forward and up directions must be non-zero and not parallel: %s", line.c_str());
+					if (stream >> token)
+						THROW("unexpected trailing input: %s", token.c_str());
+				}
+				scene._globalData.camera = requestCamera;
+
+				RayTracingStats::Reset();
+				std::vector<unsigned char> bytes =
+					scene.rayTraceTile(width, height, ImageTile(0, 0, width, height), rLimit, cLimit,
+					                  static_cast<unsigned int>(lightSamples)).
+					      encode(ext);
+				const double latency = timer.elapsed();
+
+				std::stringstream header;
+				header << "OK " << bytes.size() << " " << latency << "\n";
+				if (!socket.sendString(header.str()) || !socket.send(&bytes[0], bytes.size()))
+					WARN("failed to send image to client");
+				std::cout << "\tRequest " << ++requestNum << ": " << width << " x " << height << " , " <<
+					RayTracingStats::RayNum() << " rays , " << latency << " seconds" << std::endl;
+			}
+			catch (const std::exception& e) {
+				// The reply is a single line, so flatten the (multi-line) message
+				std::string message = e.what();
+				for (char& c : message)
+					if (c == '\n' || c == '\r')
+						c = ' ';
+				socket.sendString("ERROR " + message + "\n");
+			}
+		}
+	}
+	return requestNum;
+}
@@ -0,0 +1,30 @@
+#ifndef RENDER_SERVER_INCLUDED
+#define RENDER_SERVER_INCLUDED
+
+#include "scene.h"
+
+namespace Ray {
+	/** This class keeps a scene resident and ray-traces it on request, so that repeated renders
+	*** (e.g. from different view-points) do not pay for parsing, texture loading, and bounding-box construction.
+	***
+	*** Clients connect over TCP (on the local machine) and send one request per line:
+	***		render <width> <height> <rLimit> <cutOff> <lSamples> <bmp|jpg> [camera <position> <forward> <up> <heightAngle>]
+	***		quit
+	*** If no camera is given, the camera from the .ray file is used.
+	*** A successful render is answered by the line "OK <bytes> <seconds>" followed by the encoded image.
+	*** A failed request is answered by the line "ERROR <message>".
+	*** Requests for images wider or taller than MaxResolution, or with more than MaxPixelNum pixels, are refused. */
+	class RenderServer {
+	public:
+		/** The largest width and height that can be requested */
+		static const int MaxResolution = 16384;
+
+		/** The largest number of pixels that can be requested (keeping an image's size well within an int) */
+		static const long long MaxPixelNum = 1 << 26;
+
+		/** This static method serves render requests on the prescribed port until a client sends "quit".
+		*** It returns the number of requests served. */
+		static size_t Serve(Scene& scene, int port);
+	};
+}
+#endif // RENDER_SERVER_INCLUDED
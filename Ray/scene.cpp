@@ -1,12 +1,24 @@
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <Util/exceptions.h>
 #include <Util/cmdLineParser.h>
+#include <Util/timer.h>
+#include <Util/threadPool.h>
+#include <Util/profiler.h>
 #include <Image/bmp.h>
 #include "scene.h"
 #include "fileInstance.h"
 #include "shapeList.h"
+#include "rayBatch.h"
+#include "frustumCut.h"
+#include "transformFlattener.h"
+#include "shadowDenoiser.h"
+#include "sphereLight.h"
+#include "tessellation.h"
+#include "outOfCoreMesh.h"
 #include "jitters.h"
 
 using namespace std;
@@ -185,6 +197,9 @@ namespace Ray {
 				Material material;
 				stream >> material;
 				data.materials.push_back(material);
+				// Start decoding the texture, so that it overlaps with the rest of the parsing
+				if (material._texIndex >= 0 && material._texIndex < data.textures.size())
+					data.textures[material._texIndex].startDecoding();
 			}
 
 				// Reading the vertices
@@ -213,9 +228,13 @@ namespace Ray {
 				// Otherwise we are reading beyond the global data
 			else {
 				UnreadDirective(stream, keyword);
-				return stream;
+				break;
 			}
 		}
+		// Start decoding the textures referenced by materials that preceded them
+		for (int i = 0; i < data.materials.size(); i++)
+			if (data.materials[i]._texIndex >= 0 && data.materials[i]._texIndex < data.textures.size())
+				data.textures[data.materials[i]._texIndex].startDecoding();
 		return stream;
 	}
 }
@@ -256,8 +275,7 @@ namespace Ray {
 	istream& operator >>(istream& stream, Texture& texture) {
 		if (!(stream >> texture._filename))
 			THROW("Failed to parse texture");
-		std::string fileName = GetFileName(Scene::BaseDir, texture._filename);
-		texture._image.read(fileName);
+		// The image is decoded later, once it is known to be referenced
 		return stream;
 	}
 
@@ -266,6 +284,26 @@ namespace Ray {
 	}
 }
 
+void Texture::startDecoding(void) {
+	if (_decoded || _decoding) return;
+	const std::string fileName = GetFileName(Scene::BaseDir, _filename);
+	_decoding = std::make_shared<std::future<Image32>>(ThreadPool::Default().submit([fileName](void) {
+		Image32 image;
+		image.read(fileName);
+		return image;
+	}));
+}
+
+void Texture::finishDecoding(void) {
+	if (_decoded) return;
+	startDecoding();
+	// This may be called from a pool task, so the pool runs other tasks while the image is decoded
+	ThreadPool::Default().wait(*_decoding);
+	_image = _decoding->get();
+	_decoding.reset();
+	_decoded = true;
+}
+
 ////////////
 // Shader //
 ////////////
@@ -338,16 +376,21 @@ namespace Ray {
 ///////////////////
 void SceneGeometry::drawOpenGL(GLSLProgram* glslProgram) const { _shapeList.drawOpenGL(glslProgram); }
 
-bool SceneGeometry::isInside(Point3D p) const { return _shapeList.isInside(p); }
+bool SceneGeometry::FlattenTransforms = false;
+
+bool SceneGeometry::isInside(Point3D p) const { return _tracedShapeList().isInside(p); }
 
 double SceneGeometry::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingBox1D range,
                                 std::function<bool (double)> validityLambda) const {
-	return _shapeList.intersect(ray, iInfo, range, validityLambda);
+	return _tracedShapeList().intersect(ray, iInfo, range, validityLambda);
 }
 
+void SceneGeometry::intersectBatch(RayBatch& batch) const { _tracedShapeList().intersectBatch(batch); }
+
 void SceneGeometry::init(void) {
-	// Set the material / vertex pointers
-	for (int i = 0; i < _localData.files.size(); i++) _localData.files[i].init();
+	PROFILE_ZONE("init");
+	// Set the material / vertex pointers (the included files are independent, so they are initialized in parallel)
+	ThreadPool::Default().parallelFor(0, _localData.files.size(), [&](size_t i) { _localData.files[i].init(); });
 	// Set the texture pointers in the materials
 	for (int i = 0; i < _localData.materials.size(); i++) {
 		size_t index = _localData.materials[i]._texIndex;
@@ -355,9 +398,19 @@ void SceneGeometry::init(void) {
 		else if (index >= _localData.textures.size())
 			THROW("material specifies a texture out of texture bounds: %d <= %d", index,
 		      static_cast<int>(_localData.textures.size()));
-		else _localData.materials[i].tex = &_localData.textures[index];
+		else {
+			_localData.textures[index].finishDecoding();
+			_localData.materials[i].tex = &_localData.textures[index];
+		}
 	}
 	init(_localData);
+
+	if (FlattenTransforms) {
+		PROFILE_ZONE("flatten");
+		_flattener = std::make_shared<TransformFlattener>();
+		Shape* flattened = flatten(*_flattener);
+		if (flattened != &_shapeList) _flattened = static_cast<ShapeList*>(flattened);
+	}
 }
 
 void SceneGeometry::init(const LocalSceneData& localData) {
@@ -366,9 +419,11 @@ void SceneGeometry::init(const LocalSceneData& localData) {
 }
 
 void SceneGeometry::updateBoundingBox(void) {
-	for (int i = 0; i < _localData.files.size(); i++) _localData.files[i].updateBoundingBox();
-	_shapeList.updateBoundingBox();
-	_bBox = _shapeList.boundingBox();
+	PROFILE_ZONE("bvh");
+	// The files are updated first, as flattened file instances wrap shapes whose bounding boxes are updated by the files
+	ThreadPool::Default().parallelFor(0, _localData.files.size(), [&](size_t i) { _localData.files[i].updateBoundingBox(); });
+	_tracedShapeList().updateBoundingBox();
+	_bBox = _tracedShapeList().boundingBox();
 }
 
 void SceneGeometry::initOpenGL(void) {
@@ -423,6 +478,37 @@ void SceneGeometry::_read(istream& stream) {
 
 size_t SceneGeometry::primitiveNum(void) const { return _shapeList.primitiveNum(); }
 
+Shape* SceneGeometry::flatten(TransformFlattener& flattener) { return _shapeList.flatten(flattener); }
+
+void SceneGeometry::addMemoryUsage(MemoryStats& stats) const {
+	if (!stats.visit(this)) return;
+	stats.bytes[MemoryStats::SCENE_DATA] += _localData.vertices.capacity() * sizeof(Vertex) +
+		_localData.materials.capacity() * sizeof(Material) + _localData.textures.capacity() * sizeof(Texture) +
+		_localData.files.capacity() * sizeof(File);
+	for (int i = 0; i < _localData.textures.size(); i++) {
+		const size_t size = _localData.textures[i].memoryUsage();
+		stats.bytes[MemoryStats::SCENE_DATA] += size;
+		stats.bytes[MemoryStats::IMAGES] -= std::min(size, stats.bytes[MemoryStats::IMAGES]);
+	}
+	for (int i = 0; i < _localData.files.size(); i++) _localData.files[i].addMemoryUsage(stats);
+	_shapeList.addMemoryUsage(stats);
+	if (_flattener) _flattener->addMemoryUsage(stats);
+	if (_flattened) _flattened->addMemoryUsage(stats);
+}
+
+///////////////
+// ImageTile //
+///////////////
+std::vector<ImageTile> ImageTile::Partition(int width, int height, int tileSize) {
+	if (tileSize <= 0)
+		THROW("tile size must be positive: %d", tileSize);
+	std::vector<ImageTile> tiles;
+	for (int y = 0; y < height; y += tileSize)
+		for (int x = 0; x < width; x += tileSize)
+			tiles.emplace_back(x, y, std::min<int>(x + tileSize, width), std::min<int>(y + tileSize, height));
+	return tiles;
+}
+
 ///////////
 // Scene //
 ///////////
@@ -444,8 +530,11 @@ namespace Ray {
 	}
 
 	istream& operator >>(istream& stream, Scene& scene) {
-		stream >> scene._globalData;
-		stream >> static_cast<SceneGeometry&>(scene);
+		{
+			PROFILE_ZONE("parse");
+			stream >> scene._globalData;
+			stream >> static_cast<SceneGeometry&>(scene);
+		}
 
 		scene.init();
 		return stream;
@@ -487,6 +576,11 @@ void accPerspective(GLdouble vfov, GLdouble aspect, GLdouble zNear, GLdouble zFa
 
 unsigned int Scene::aa_samples = 1;
 
+bool Scene::BatchPrimaryRays = false;
+bool Scene::CullPrimaryRays = false;
+double Scene::ContributionCutOff = 0;
+double Scene::RouletteThreshold = 0;
+
 void Scene::drawOpenGL(void) const {
 
 	if (_globalData.shader && _globalData.shader->glslProgram) _globalData.shader->glslProgram->use();
@@ -528,30 +622,232 @@ void Scene::drawOpenGL(void) const {
 	ASSERT_OPEN_GL_STATE();
 }
 
-Image32 Scene::rayTrace(int width, int height, int rLimit, double cLimit, unsigned int lightSamples) {
+Image32 Scene::rayTrace(int width, int height, int rLimit, double cLimit, unsigned int lightSamples,
+                        RenderCostMap* costMap, ShadowDenoiser* denoiser) {
+	PROFILE_ZONE("render");
+	updateBoundingBox();
+	if (costMap)
+		costMap->resize(width, height);
+	if (denoiser)
+		denoiser->resize(width, height);
+	return rayTraceTile(_globalData.camera, width, height, ImageTile(0, 0, width, height), rLimit, cLimit, lightSamples,
+	                    costMap, denoiser);
+}
+
+void Scene::rayTrace(int width, int height, int rLimit, double cLimit, unsigned int lightSamples, ImageWriter& writer,
+                     int bandHeight) {
+	if (bandHeight <= 0)
+		THROW("band height must be positive: %d", bandHeight);
+	if (writer.width() != width || writer.height() != height)
+		THROW("image and writer dimensions differ: %d x %d != %d x %d", width, height, writer.width(), writer.height());
+	PROFILE_ZONE("render");
 	updateBoundingBox();
+
+	// The previous band is encoded on the pool while the next one is traced
+	std::future<void> writing;
+	for (int y = 0; y < height; y += bandHeight) {
+		Image32 band;
+		try {
+			band = rayTraceTile(_globalData.camera, width, height, ImageTile(0, y, width, std::min<int>(y + bandHeight, height)),
+			                    rLimit, cLimit, lightSamples);
+		}
+		catch (...) {
+			// The pending write references the writer, so it must complete before the exception is propagated
+			if (writing.valid()) writing.wait();
+			throw;
+		}
+		if (writing.valid()) writing.get();
+		writing = ThreadPool::Default().submit([&writer, band = std::move(band)](void) { writer.writeRows(band); });
+	}
+	if (writing.valid()) writing.get();
+	writer.finish();
+}
+
+Image32 Scene::rayTraceTile(int width, int height, const ImageTile& tile, int rLimit, double cLimit,
+                            unsigned int lightSamples) {
+	return rayTraceTile(_globalData.camera, width, height, tile, rLimit, cLimit, lightSamples);
+}
+
+Image32 Scene::rayTraceTile(const Camera& camera, int width, int height, const ImageTile& tile, int rLimit,
+                            double cLimit, unsigned int lightSamples, RenderCostMap* costMap,
+                            ShadowDenoiser* denoiser) {
+	PROFILE_ZONE("tile");
 	Image32 img;
 
-	img.setSize(width, height);
-	for (int j = 0; j < height; j++) {
-		for (int i = 0; i < width; i++) {
+	img.setSize(tile.width(), tile.height());
+	SphereLight::StartTileSampleBudget();
+	if (BatchPrimaryRays && !costMap) {
+		_rayTraceBatches(camera, width, height, tile, rLimit, cLimit, lightSamples, img, denoiser);
+		RayTracingStats::Flush();
+		return img;
+	}
+	if (CullPrimaryRays && !costMap) {
+		_rayTraceCulled(camera, width, height, tile, rLimit, cLimit, lightSamples, img, denoiser);
+		RayTracingStats::Flush();
+		return img;
+	}
+	// The timer is only read (and restarted for each pixel) when costs are recorded
+	Timer timer;
+	for (int j = tile.y0; j < tile.y1; j++) {
+		SphereLight::AddSampleBudget(tile.width(), static_cast<size_t>(width) * height);
+		for (int i = tile.x0; i < tile.x1; i++) {
 			try {
-				Ray3D ray = _globalData.camera.getRay(i, height - j - 1, width, height);
-				Point3D c = getColor(ray, rLimit, Point3D(cLimit, cLimit, cLimit), lightSamples);
+				RayTracingStats::Counts before;
+				if (costMap) {
+					before = RayTracingStats::ThreadCounts();
+					timer.reset();
+				}
+				_SeedRoulette(i, j);
+				Ray3D ray = camera.getRay(i, height - j - 1, width, height);
+				Point3D c = getColor(ray, rLimit, Point3D(cLimit, cLimit, cLimit), lightSamples,
+				                     denoiser ? &(*denoiser)(i, j) : nullptr);
 				Pixel32 p;
 				p.r = static_cast<int>(c[0] * 255);
 				p.g = static_cast<int>(c[1] * 255);
 				p.b = static_cast<int>(c[2] * 255);
-				img(i, j) = p;
+				img(i - tile.x0, j - tile.y0) = p;
+				if (costMap) {
+					RenderCostMap& costs = *costMap;
+					RayTracingStats::Counts after = RayTracingStats::ThreadCounts();
+					costs(i, j, RenderCostMap::SECONDS) = static_cast<float>(timer.elapsed());
+					costs(i, j, RenderCostMap::RAYS) = static_cast<float>(after.rayNum - before.rayNum);
+					costs(i, j, RenderCostMap::BOUNDING_BOX_TESTS) =
+						static_cast<float>(after.boundingBoxIntersectionNum - before.boundingBoxIntersectionNum);
+					costs(i, j, RenderCostMap::PRIMITIVE_TESTS) =
+						static_cast<float>(after.primitiveIntersectionNum - before.primitiveIntersectionNum);
+				}
 			}
 			catch (std::exception& e) { ERROR_OUT("failed to generate pixel ( %d , %d )\n%s", i, j, e.what()); }
 		}
 	}
+	RayTracingStats::Flush();
 	return img;
 }
 
+void Scene::_rayTraceBatches(const Camera& camera, int width, int height, const ImageTile& tile, int rLimit,
+                             double cLimit, unsigned int lightSamples, Image32& img, ShadowDenoiser* denoiser) {
+	RayBatch batch;
+	for (int y0 = tile.y0; y0 < tile.y1; y0 += BatchSize)
+		for (int x0 = tile.x0; x0 < tile.x1; x0 += BatchSize) {
+			const ImageTile block(x0, y0, std::min<int>(x0 + BatchSize, tile.x1), std::min<int>(y0 + BatchSize, tile.y1));
+			batch.clear();
+			for (int j = block.y0; j < block.y1; j++)
+				for (int i = block.x0; i < block.x1; i++) batch.add(camera.getRay(i, height - j - 1, width, height));
+			try { intersectBatch(batch); }
+			catch (std::exception& e) {
+				ERROR_OUT("failed to intersect block ( %d , %d ) x ( %d , %d )\n%s", block.x0, block.y0, block.x1, block.y1,
+				          e.what());
+			}
+
+			size_t k = 0;
+			for (int j = block.y0; j < block.y1; j++) {
+				SphereLight::AddSampleBudget(block.width(), static_cast<size_t>(width) * height);
+				for (int i = block.x0; i < block.x1; i++, k++) {
+					try {
+						_SeedRoulette(i, j);
+						Point3D c;
+						if (!isinf(batch.t[k]))
+							c = getColor(batch.rays[k], batch.iInfo[k], rLimit, Point3D(cLimit, cLimit, cLimit), lightSamples,
+							             denoiser ? &(*denoiser)(i, j) : nullptr);
+						Pixel32 p;
+						p.r = static_cast<int>(c[0] * 255);
+						p.g = static_cast<int>(c[1] * 255);
+						p.b = static_cast<int>(c[2] * 255);
+						img(i - tile.x0, j - tile.y0) = p;
+					}
+					catch (std::exception& e) { ERROR_OUT("failed to generate pixel ( %d , %d )\n%s", i, j, e.what()); }
+				}
+			}
+		}
+}
+
+void Scene::_rayTraceCulled(const Camera& camera, int width, int height, const ImageTile& tile, int rLimit,
+                            double cLimit, unsigned int lightSamples, Image32& img, ShadowDenoiser* denoiser) {
+	FrustumCut cut;
+	for (int y0 = tile.y0; y0 < tile.y1; y0 += CullSize)
+		for (int x0 = tile.x0; x0 < tile.x1; x0 += CullSize) {
+			const ImageTile block(x0, y0, std::min<int>(x0 + CullSize, tile.x1), std::min<int>(y0 + CullSize, tile.y1));
+			// The camera counts rows from the bottom of the image
+			Plane3D planes[5];
+			camera.getFrustum(block.x0, height - block.y1, block.x1 - 1, height - block.y0 - 1, width, height, planes);
+			cut.set(shapeList(), planes);
+
+			for (int j = block.y0; j < block.y1; j++) {
+				SphereLight::AddSampleBudget(block.width(), static_cast<size_t>(width) * height);
+				for (int i = block.x0; i < block.x1; i++) {
+					try {
+						const Ray3D ray = camera.getRay(i, height - j - 1, width, height);
+						_SeedRoulette(i, j);
+						RayShapeIntersectionInfo iInfo;
+						RayTracingStats::IncrementRayNum();
+						Point3D c;
+						if (!isinf(cut.intersect(ray, iInfo)))
+							c = getColor(ray, iInfo, rLimit, Point3D(cLimit, cLimit, cLimit), lightSamples,
+							             denoiser ? &(*denoiser)(i, j) : nullptr);
+						Pixel32 p;
+						p.r = static_cast<int>(c[0] * 255);
+						p.g = static_cast<int>(c[1] * 255);
+						p.b = static_cast<int>(c[2] * 255);
+						img(i - tile.x0, j - tile.y0) = p;
+					}
+					catch (std::exception& e) { ERROR_OUT("failed to generate pixel ( %d , %d )\n%s", i, j, e.what()); }
+				}
+			}
+		}
+}
+
+namespace {
+	/** This function returns the 64-bit FNV-1a hash of the bytes */
+	unsigned long long HashBytes(const void* bytes, size_t size, unsigned long long h = 14695981039346656037ULL) {
+		for (size_t i = 0; i < size; i++) {
+			h ^= static_cast<const unsigned char*>(bytes)[i];
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+
+	template <typename T>
+	unsigned long long HashValue(const T& value, unsigned long long h) { return HashBytes(&value, sizeof(T), h); }
+}
+
+unsigned long long Scene::hash(void) const {
+	std::stringstream stream;
+	stream << *this;
+	const std::string str = stream.str();
+	return HashBytes(str.c_str(), str.size());
+}
+
+unsigned long long Scene::SettingsHash(void) {
+	unsigned long long h = HashBytes(nullptr, 0);
+	h = HashValue(RouletteThreshold, h);
+	h = HashValue(ContributionCutOff, h);
+	h = HashValue(SphereLight::Adaptive, h);
+	h = HashValue(SphereLight::InitialSamples, h);
+	h = HashValue(SphereLight::SampleBudget, h);
+	h = HashValue(Triangle::SinglePrecision, h);
+	h = HashValue(CullPrimaryRays, h);
+	h = HashValue(FlattenTransforms, h);
+	return h;
+}
+
+MemoryStats Scene::memoryStats(void) const {
+	MemoryStats stats;
+	// The images are tallied first, so that the walk can move the textures' pixels to the scene data
+	stats.bytes[MemoryStats::IMAGES] = Image32::AllocatedBytes();
+	stats.bytes[MemoryStats::GL_BUFFERS] = MemoryStats::GLBufferBytes();
+	for (const auto& factory : ShapeList::ShapeFactories) stats.bytes[MemoryStats::SHAPES] += factory.second->memoryUsage();
+	stats.bytes[MemoryStats::SHAPES] += TessellationCache::MemoryUsage() + ClusterCache::MemoryUsage();
+	addMemoryUsage(stats);
+	return stats;
+}
+
 double Scene::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingBox1D range,
                         std::function<bool (double)> validityLambda) const {
 	RayTracingStats::IncrementRayNum();
 	return SceneGeometry::intersect(ray, iInfo, range, validityLambda);
 }
+
+void Scene::intersectBatch(RayBatch& batch) const {
+	for (size_t i = 0; i < batch.size(); i++) RayTracingStats::IncrementRayNum();
+	SceneGeometry::intersectBatch(batch);
+}
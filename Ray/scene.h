@@ -1,5 +1,7 @@
 #ifndef SCENE_INCLUDED
 #define SCENE_INCLUDED
+#include <future>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <Util/geometry.h>
@@ -9,6 +11,7 @@
 #include "shapeList.h"
 #include "keyFrames.h"
 #include "camera.h"
+#include "renderCostMap.h"
 
 namespace Ray {
 	class Material;
@@ -17,6 +20,10 @@ namespace Ray {
 	class KeyFrameFile;
 	class Shader;
 	class Vertex;
+	class RayBatch;
+	struct ShadingFeatures;
+	class ShadowDenoiser;
+	class TransformFlattener;
 
 	/** This function tries to read the next directive from a stream.*/
 	std::string ReadDirective(std::istream& stream);
@@ -102,7 +109,24 @@ namespace Ray {
 		/** The root of the scene-graph */
 		ShapeList _shapeList;
 
+		/** The flattener owning the world-space geometry (set if the static transformations have been flattened) */
+		std::shared_ptr<TransformFlattener> _flattener;
+
+		/** The root of the flattened scene-graph, which is ray-traced in place of the original (null if flattening changed nothing) */
+		ShapeList* _flattened = nullptr;
+
+		/** This method returns the root of the scene-graph that is ray-traced */
+		ShapeList& _tracedShapeList(void) { return _flattened ? *_flattened : _shapeList; }
+		const ShapeList& _tracedShapeList(void) const { return _flattened ? *_flattened : _shapeList; }
+
 	public:
+		/** When set, the static transformations are baked into world-space copies of the geometry after initialization, where that is exact.
+		*** The copies are only used for ray-tracing: the original scene-graph is still drawn and written out. */
+		static bool FlattenTransforms;
+
+		/** This method returns the root of the scene-graph that is ray-traced */
+		const ShapeList& shapeList(void) const { return _tracedShapeList(); }
+
 		/** Initializes the scene geometry, transforming property indices to pointers */
 		void init(void);
 
@@ -127,21 +151,69 @@ namespace Ray {
 		double intersect(Util::Ray3D ray, RayShapeIntersectionInfo& iInfo,
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityFunction = [](double) { return true; }) const override;
+		void intersectBatch(RayBatch& batch) const override;
 		bool isInside(Util::Point3D p) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		Shape* flatten(TransformFlattener& flattener) override;
+		void addMemoryUsage(MemoryStats& stats) const override;
+	};
+
+	/** This class describes a rectangular tile of an image, spanning the columns [x0,x1) and the rows [y0,y1) */
+	class ImageTile {
+	public:
+		/** The bounds of the tile */
+		int x0, y0, x1, y1;
+
+		/** The default constructor */
+		ImageTile(void) : x0(0), y0(0), x1(0), y1(0) {}
+
+		/** The constructor */
+		ImageTile(int x0, int y0, int x1, int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+
+		/** The width of the tile */
+		int width(void) const { return x1 - x0; }
+
+		/** The height of the tile */
+		int height(void) const { return y1 - y0; }
+
+		/** This static method partitions an image of the prescribed dimensions into tiles of (at most) the prescribed size, in scan-line order */
+		static std::vector<ImageTile> Partition(int width, int height, int tileSize);
 	};
 
 	/** This class stores all of the information read out from a .ray file.*/
 	class Scene : public SceneGeometry {
 		friend class Window;
 		friend class FileInstance;
+		friend class RenderServer;
 		friend std::ostream& operator <<(std::ostream&, const Scene&);
 		friend std::istream& operator >>(std::istream&, Scene&);
 
 		/** The global data */
 		GlobalSceneData _globalData;
 
+		/** This method ray-traces the tile into the image, intersecting the primary rays of each block of pixels with the scene as a batch */
+		void _rayTraceBatches(const Camera& camera, int width, int height, const ImageTile& tile, int rLimit, double cLimit,
+		                      unsigned int lightSamples, Image::Image32& img, ShadowDenoiser* denoiser);
+
+		/** This method ray-traces the tile into the image, intersecting the primary rays of each block of pixels with the part of the scene inside the block's frustum */
+		void _rayTraceCulled(const Camera& camera, int width, int height, const ImageTile& tile, int rLimit, double cLimit,
+		                     unsigned int lightSamples, Image::Image32& img, ShadowDenoiser* denoiser);
+
+		/** These methods implement getColor, additionally tracking the throughput: the largest fraction of the ray's color that can reach the pixel */
+		Util::Point3D _getColor(Util::Ray3D ray, int rDepth, Util::Point3D cLimit, Util::Point3D throughput, unsigned int lightSamples,
+		                        ShadingFeatures* features);
+		Util::Point3D _getColor(Util::Ray3D ray, const RayShapeIntersectionInfo& iInfo, int rDepth, Util::Point3D cLimit,
+		                        Util::Point3D throughput, unsigned int lightSamples, ShadingFeatures* features);
+
+		/** This function returns the factor by which to scale the color of a secondary ray, given the weight with which it contributes to its parent's color.
+		*** It returns zero if the ray should not be traced, either because its contribution is too small to show or because it was culled by Russian roulette. */
+		static double _BranchScale(Util::Point3D weight, Util::Point3D throughput);
+
+		/** This function seeds the calling thread's Russian roulette with the index of the pixel about to be traced,
+		*** so that the branches culled in a pixel do not depend on which thread, process, or run traces it */
+		static void _SeedRoulette(int i, int j);
+
 	public:
 		/** The base directory */
 		static std::string BaseDir;
@@ -149,6 +221,30 @@ namespace Ray {
 		/** The number of anti-aliasing samples to take */
 		static unsigned int aa_samples;
 
+		/** When set, the primary rays of a tile are intersected with the scene in batches (of at most BatchSize x BatchSize pixels) before being shaded,
+		*** so that shapes that benefit from tracing many rays at once, such as out-of-core meshes, can do so. Per-pixel costs are not recorded for batched rays. */
+		static bool BatchPrimaryRays;
+
+		/** The width and height of the blocks of pixels whose primary rays are batched together */
+		static const int BatchSize = 64;
+
+		/** When set (and primary rays are not batched), the scene is culled against the frustum of each block of pixels (of at most CullSize x CullSize pixels),
+		*** and the block's primary rays are only intersected with the shapes that survive. Per-pixel costs are not recorded for culled rays. */
+		static bool CullPrimaryRays;
+
+		/** The width and height of the blocks of pixels against whose frustums the scene is culled */
+		static const int CullSize = 16;
+
+		/** Secondary rays whose largest possible contribution to the pixel is below the cut-off are not traced (zero to trace them all).
+		*** Setting it to half the display's quantization step (0.5/255) skips only branches that cannot change the pixel. */
+		static double ContributionCutOff;
+
+		/** Secondary rays whose largest possible contribution is below the threshold are traced with probability proportional to their contribution,
+		*** and their color is scaled up by the inverse of the probability so that, on average, they contribute as much as if they had always been traced (zero to disable Russian roulette).
+		*** [WARNING] Since the color is clamped at every level of the recursion, and not just at the pixel, a scaled-up branch can be clipped by its parent's clamp,
+		*** so the estimate is biased towards darker colors wherever the parent's color saturates. */
+		static double RouletteThreshold;
+
 		/** This function reflects the vector v about the normal n. */
 		static Util::Point3D Reflect(Util::Point3D v, Util::Point3D n);
 
@@ -158,11 +254,53 @@ namespace Ray {
 
 		/** This is the function responsible for the recursive ray-tracing returning the color obtained
 		*** by shooting a ray into the scene and recursing until either the recursion depth has been reached
-		*** or the contribution from subsequent bounces is guaranteed to be less than the cut-off. */
-		Util::Point3D getColor(Util::Ray3D ray, int rDepth, Util::Point3D cLimit, unsigned int lightSamples);
-
-		/** This method ray-traces the scene and returns the computed image */
-		Image::Image32 rayTrace(int width, int height, int rLimit, double cLimit, unsigned int lightSamples);
+		*** or the contribution from subsequent bounces is guaranteed to be less than the cut-off.
+		*** If features are provided, those of the surface the ray hits are recorded in them. */
+		Util::Point3D getColor(Util::Ray3D ray, int rDepth, Util::Point3D cLimit, unsigned int lightSamples,
+		                       ShadingFeatures* features = nullptr);
+
+		/** This method returns the color obtained by shading the prescribed intersection of the ray with the scene, recursing as getColor does. */
+		Util::Point3D getColor(Util::Ray3D ray, const RayShapeIntersectionInfo& iInfo, int rDepth, Util::Point3D cLimit,
+		                       unsigned int lightSamples, ShadingFeatures* features = nullptr);
+
+		/** This method ray-traces the scene and returns the computed image.
+		*** If a cost map is provided, it is resized to the image and the cost of tracing each pixel is recorded in it.
+		*** If a denoiser is provided, it is resized to the image and the shading features of each pixel are recorded in it.
+		*** The sample budget of the sphere lights is restored before tracing. */
+		Image::Image32 rayTrace(int width, int height, int rLimit, double cLimit, unsigned int lightSamples,
+		                        RenderCostMap* costMap = nullptr, ShadowDenoiser* denoiser = nullptr);
+
+		/** This method ray-traces the scene in bands of (at most) the prescribed number of rows, handing each band to the writer once it is traced.
+		*** Each band is written out while the next one is traced, so only two bands are held in memory at a time.
+		*** The writer is finished once the last band has been written. */
+		void rayTrace(int width, int height, int rLimit, double cLimit, unsigned int lightSamples, Image::ImageWriter& writer,
+		              int bandHeight);
+
+		/** This method ray-traces the prescribed tile of a width x height image and returns the tile's pixels.
+		*** It assumes that the bounding boxes have already been updated. */
+		Image::Image32 rayTraceTile(int width, int height, const ImageTile& tile, int rLimit, double cLimit, unsigned int lightSamples);
+
+		/** This method ray-traces the prescribed tile of a width x height image, as seen from the prescribed camera, and returns the tile's pixels.
+		*** If a (width x height) cost map is provided, the cost of tracing each pixel of the tile is recorded in it.
+		*** If a (width x height) denoiser is provided, the shading features of each pixel of the tile are recorded in it.
+		*** It assumes that the bounding boxes have already been updated. */
+		Image::Image32 rayTraceTile(const Camera& camera, int width, int height, const ImageTile& tile, int rLimit, double cLimit,
+		                            unsigned int lightSamples, RenderCostMap* costMap = nullptr,
+		                            ShadowDenoiser* denoiser = nullptr);
+
+		/** This method returns the camera from which the scene is rendered */
+		const Camera& camera(void) const { return _globalData.camera; }
+
+		/** This method returns a hash of the scene's contents, used to check that two processes have read in the same scene */
+		unsigned long long hash(void) const;
+
+		/** This static method returns a hash of the global settings that change the rendered pixels
+		*** (Russian roulette and the contribution cut-off, adaptive light sampling, single-precision triangles, frustum culling, and flattening),
+		*** used to check that tiles rendered by different processes, or before and after a resume, can be stitched together */
+		static unsigned long long SettingsHash(void);
+
+		/** This method returns the number of bytes held by the scene, by the shape factories and caches, and by the images and OpenGL buffers allocated so far */
+		MemoryStats memoryStats(void) const;
 
 		/** This method should be called (once) after an OpenGL context has been created */
 		void initOpenGL(void) override;
@@ -174,6 +312,9 @@ namespace Ray {
 		double intersect(Util::Ray3D ray, RayShapeIntersectionInfo& iInfo,
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityLambda = [](double) { return true; }) const override;
+
+		/** This method intersects the batch of rays with the scene */
+		void intersectBatch(RayBatch& batch) const override;
 	};
 
 	/** This operator writes a Scene object out to a stream. */
@@ -241,6 +382,7 @@ namespace Ray {
 		friend std::ostream& operator <<(std::ostream&, const Material&);
 		friend std::istream& operator >>(std::istream&, Material&);
 		friend std::istream& operator >>(std::istream&, Scene&);
+		friend std::istream& operator >>(std::istream&, LocalSceneData&);
 
 		/** The index of the texture associated with the material */
 		int _texIndex;
@@ -300,9 +442,25 @@ namespace Ray {
 
 		/** The texture handle for OpenGL rendering */
 		GLuint _openGLHandle;
+
+		/** The image being decoded in the background (shared, so that the texture can be copied while it is being decoded) */
+		std::shared_ptr<std::future<Image::Image32>> _decoding;
+
+		/** Whether the image has been decoded */
+		bool _decoded = false;
 	public:
+		/** This method queues the image for decoding on the default thread pool, unless it is already being decoded */
+		void startDecoding(void);
+
+		/** This method waits for the image to be decoded, starting the decoding if it had not been started.
+		*** Images are only decoded once this is called, so textures that no material references are never decoded. */
+		void finishDecoding(void);
+
 		/** This method sets up the OpenGL texture */
 		void initOpenGL(void);
+
+		/** This method returns the number of bytes held by the decoded image */
+		size_t memoryUsage(void) const { return _image.memoryUsage(); }
 	};
 
 	/** This operator writes out a Texture object to a stream. */
@@ -1,10 +1,19 @@
 #include <cmath>
+#include <random>
+#include <algorithm>
 #include <Util/exceptions.h>
+#include <Util/profiler.h>
 #include "scene.h"
+#include "shadowDenoiser.h"
 
 using namespace Ray;
 using namespace Util;
 
+namespace {
+	/** The generator drawing the Russian roulette decisions of the calling thread (reseeded for every pixel) */
+	thread_local std::minstd_rand RouletteGenerator;
+}
+
 ///////////
 // Scene //
 ///////////
@@ -33,40 +42,82 @@ bool Scene::Refract(Point3D v, Point3D n, double ir, Point3D& refract) {
 	return true;
 }
 
-Point3D Scene::getColor(Ray3D ray, int rDepth, Point3D cLimit, unsigned int lightSamples) {
+double Scene::_BranchScale(Point3D weight, Point3D throughput) {
+	const double contribution = std::max<double>({throughput[0] * weight[0], throughput[1] * weight[1], throughput[2] * weight[2]});
+	if (contribution <= 0 || contribution < ContributionCutOff) return 0;
+	if (contribution >= RouletteThreshold) return 1;
+	const double survival = contribution / RouletteThreshold;
+	return std::uniform_real_distribution<double>(0., 1.)(RouletteGenerator) < survival ? 1. / survival : 0;
+}
+
+void Scene::_SeedRoulette(int i, int j) {
+	// The pixel's coordinates are scrambled (with the SplitMix64 finalizer) so that neighboring pixels get unrelated sequences.
+	// Within the pixel, the decisions are drawn in the (deterministic) order in which the recursion reaches the branches.
+	unsigned long long z = (static_cast<unsigned long long>(static_cast<unsigned int>(j)) << 32) | static_cast<unsigned int>(i);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+	RouletteGenerator.seed(static_cast<std::minstd_rand::result_type>(z % std::minstd_rand::modulus));
+}
+
+Point3D Scene::getColor(Ray3D ray, int rDepth, Point3D cLimit, unsigned int lightSamples, ShadingFeatures* features) {
+	return _getColor(ray, rDepth, cLimit, Point3D(1., 1., 1.), lightSamples, features);
+}
+
+Point3D Scene::getColor(Ray3D ray, const RayShapeIntersectionInfo& iInfo, int rDepth, Point3D cLimit,
+                        unsigned int lightSamples, ShadingFeatures* features) {
+	return _getColor(ray, iInfo, rDepth, cLimit, Point3D(1., 1., 1.), lightSamples, features);
+}
+
+Point3D Scene::_getColor(Ray3D ray, int rDepth, Point3D cLimit, Point3D throughput, unsigned int lightSamples,
+                         ShadingFeatures* features) {
 	////////////////////////////////////////////////
 	// Get the color associated with the ray here //
 	////////////////////////////////////////////////
-	Point3D I;
-	if (!rDepth || (cLimit[0] > 1 && cLimit[1] > 1 && cLimit[2] > 1)) return I;
+	if (!rDepth || (cLimit[0] > 1 && cLimit[1] > 1 && cLimit[2] > 1)) return Point3D();
 	RayShapeIntersectionInfo iInfo;
 	const double d = this->intersect(ray, iInfo);
-	if (isinf(d)) return I;
+	if (isinf(d)) return Point3D();
+	return _getColor(ray, iInfo, rDepth, cLimit, throughput, lightSamples, features);
+}
+
+Point3D Scene::_getColor(Ray3D ray, const RayShapeIntersectionInfo& iInfo, int rDepth, Point3D cLimit,
+                         Point3D throughput, unsigned int lightSamples, ShadingFeatures* features) {
+	Point3D I;
+	if (!rDepth || (cLimit[0] > 1 && cLimit[1] > 1 && cLimit[2] > 1)) return I;
 
 	// compute color
 	Point3D emissive_contrib = iInfo.material->emissive;
 	Point3D surface_contrib;
+	Point3D unshadowed, shadowed;
+	Point3D albedo = iInfo.material->diffuse;
 	const auto lights = _globalData.lights;
 	Point3D ambient_sum;
 	for (const auto light : lights) {
 		ambient_sum = ambient_sum + light->getAmbient(ray, iInfo);
 	}
-	for (const auto light : lights) {
-		Point3D ambient = iInfo.material->ambient * ambient_sum;
-		Point3D diffuse = light->getDiffuse(ray, iInfo);
-		Point3D specular = light->getSpecular(ray, iInfo);
-		Point3D shadow = light->transparency(iInfo, *this, cLimit, lightSamples);
-		if (iInfo.material->tex) {
-			const double u = iInfo.material->tex->_image.width() * iInfo.texture[0];
-			const double v = iInfo.material->tex->_image.height() * iInfo.texture[1];
-			const Image::Pixel32 pix = iInfo.material->tex->_image.bilinearSample(Point2D(u, v));
-			const Point3D tex(pix.r / 255., pix.g / 255., pix.b / 255.);
-			emissive_contrib *= tex;
-			ambient *= tex;
-			diffuse *= tex;
-			specular *= tex;
+	{
+		PROFILE_COUNT("lights");
+		for (const auto light : lights) {
+			Point3D ambient = iInfo.material->ambient * ambient_sum;
+			Point3D diffuse = light->getDiffuse(ray, iInfo);
+			Point3D specular = light->getSpecular(ray, iInfo);
+			Point3D shadow = light->transparency(iInfo, *this, cLimit, lightSamples);
+			if (iInfo.material->tex) {
+				const double u = iInfo.material->tex->_image.width() * iInfo.texture[0];
+				const double v = iInfo.material->tex->_image.height() * iInfo.texture[1];
+				const Image::Pixel32 pix = iInfo.material->tex->_image.bilinearSample(Point2D(u, v));
+				const Point3D tex(pix.r / 255., pix.g / 255., pix.b / 255.);
+				emissive_contrib *= tex;
+				ambient *= tex;
+				diffuse *= tex;
+				specular *= tex;
+				albedo = iInfo.material->diffuse * tex;
+			}
+			surface_contrib = surface_contrib + ambient + (diffuse + specular) * shadow;
+			unshadowed += diffuse + specular;
+			shadowed += (diffuse + specular) * shadow;
 		}
-		surface_contrib = surface_contrib + ambient + (diffuse + specular) * shadow;
 	}
 
 	Point3D reflect_contrib;
@@ -75,7 +126,10 @@ Point3D Scene::getColor(Ray3D ray, int rDepth, Point3D cLimit, unsigned int ligh
 		reflect.direction = Reflect(ray.direction, iInfo.normal);
 		reflect.position = iInfo.position + reflect.direction * Epsilon;
 		const Point3D specularity = iInfo.material->specular;
-		reflect_contrib = getColor(reflect, rDepth - 1, cLimit / specularity, lightSamples) * specularity;
+		const double scale = _BranchScale(specularity, throughput);
+		if (scale)
+			reflect_contrib = _getColor(reflect, rDepth - 1, cLimit / specularity, throughput * specularity, lightSamples,
+			                            nullptr) * specularity * scale;
 	}
 
 	Point3D refract_contrib;
@@ -83,10 +137,23 @@ Point3D Scene::getColor(Ray3D ray, int rDepth, Point3D cLimit, unsigned int ligh
 	if (Refract(ray.direction, iInfo.normal, iInfo.material->ir, refract.direction)) {
 		refract.position = iInfo.position + refract.direction * Epsilon;
 		const Point3D transparency = iInfo.material->transparent;
-		refract_contrib = getColor(refract, rDepth - 1, cLimit / transparency, lightSamples) * transparency;
+		const double scale = _BranchScale(transparency, throughput);
+		if (scale)
+			refract_contrib = _getColor(refract, rDepth - 1, cLimit / transparency, throughput * transparency, lightSamples,
+			                            nullptr) * transparency * scale;
 	}
 
 	I = emissive_contrib + surface_contrib + reflect_contrib + refract_contrib;
+	if (features) {
+		features->hit = true;
+		features->normal = iInfo.normal;
+		features->depth = (iInfo.position - ray.position).length();
+		features->albedo = albedo;
+		features->unshadowed = unshadowed;
+		features->shadowed = shadowed;
+		features->rest = I - shadowed;
+	}
+	// The color is clamped at every level, so Russian roulette is only unbiased where the sum above does not saturate
 	I[0] = std::clamp(I[0], 0., 1.);
 	I[1] = std::clamp(I[1], 0., 1.);
 	I[2] = std::clamp(I[2], 0., 1.);
@@ -156,6 +223,7 @@ void Texture::initOpenGL(void) {
 	glGenTextures(1, &_openGLHandle);
 	glBindTexture(GL_TEXTURE_2D, _openGLHandle);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, flattened_img.data());
+	MemoryStats::AddGLBufferBytes(flattened_img.size());
 	glBindTexture(GL_TEXTURE_2D, 0);
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
@@ -0,0 +1,191 @@
+#include <cmath>
+#include <algorithm>
+#include <Util/exceptions.h>
+#include <Util/threadPool.h>
+#include "shadowDenoiser.h"
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+namespace {
+	/** The weights of the B3-spline filter applied (with holes) along each axis */
+	const double FilterWeights[] = {1. / 16, 1. / 4, 3. / 8, 1. / 4, 1. / 16};
+	const int FilterRadius = 2;
+
+	/** The radius of the window over which the initial variance of the visibility is estimated */
+	const int VarianceRadius = 3;
+
+	/** This function converts a color to a pixel, clamping it to the range [0,1] */
+	Pixel32 ToPixel(Point3D c, unsigned char alpha) {
+		Pixel32 p;
+		p.r = static_cast<unsigned char>(std::clamp(c[0], 0., 1.) * 255);
+		p.g = static_cast<unsigned char>(std::clamp(c[1], 0., 1.) * 255);
+		p.b = static_cast<unsigned char>(std::clamp(c[2], 0., 1.) * 255);
+		p.a = alpha;
+		return p;
+	}
+}
+
+/////////////////////
+// ShadingFeatures //
+/////////////////////
+Point3D ShadingFeatures::visibility(void) const {
+	Point3D v;
+	for (int c = 0; c < 3; c++) v[c] = unshadowed[c] > 0 ? shadowed[c] / unshadowed[c] : 1.;
+	return v;
+}
+
+////////////////////
+// ShadowDenoiser //
+////////////////////
+const char* ShadowDenoiser::BufferNames[] = {"normal", "depth", "albedo", "visibility"};
+
+ShadowDenoiser::ShadowDenoiser(void)
+	: _width(0), _height(0), iterations(5), sigmaNormal(128), sigmaDepth(0.02), sigmaAlbedo(0.1),
+	  sigmaVisibility(4) {}
+
+void ShadowDenoiser::resize(int width, int height) {
+	_width = width, _height = height;
+	_features.assign(static_cast<size_t>(width) * height, ShadingFeatures());
+}
+
+Image32 ShadowDenoiser::buffer(int b) const {
+	Image32 img;
+	img.setSize(_width, _height);
+	double maxDepth = 0;
+	if (b == DEPTH)
+		for (const ShadingFeatures& features : _features)
+			if (features.hit) maxDepth = std::max<double>(maxDepth, features.depth);
+
+	for (int j = 0; j < _height; j++)
+		for (int i = 0; i < _width; i++) {
+			const ShadingFeatures& features = (*this)(i, j);
+			Point3D c;
+			if (features.hit)
+				switch (b) {
+				case NORMAL:
+					c = (features.normal + Point3D(1., 1., 1.)) / 2;
+					break;
+				case DEPTH:
+					c = Point3D(1., 1., 1.) * (maxDepth > 0 ? features.depth / maxDepth : 0.);
+					break;
+				case ALBEDO:
+					c = features.albedo;
+					break;
+				case VISIBILITY: {
+					const Point3D v = features.visibility();
+					c = Point3D(1., 1., 1.) * ((v[0] + v[1] + v[2]) / 3);
+					break;
+				}
+				default:
+					THROW("unrecognized buffer: %d", b);
+				}
+			img(i, j) = ToPixel(c, 255);
+		}
+	return img;
+}
+
+double ShadowDenoiser::_geometryWeight(const ShadingFeatures& fp, const ShadingFeatures& fq, int step) const {
+	// The depth tolerance grows with the distance to the tap, as depths change across a surface that is not facing the camera
+	const double wNormal = pow(std::max<double>(0., fp.normal.dot(fq.normal)), sigmaNormal);
+	const double wDepth = exp(-fabs(fp.depth - fq.depth) / (sigmaDepth * fp.depth * step + Epsilon));
+	const double wAlbedo = exp(-(fp.albedo - fq.albedo).squareNorm() / (sigmaAlbedo * sigmaAlbedo));
+	return wNormal * wDepth * wAlbedo;
+}
+
+Image32 ShadowDenoiser::denoise(const Image32& img) const {
+	if (img.width() != _width || img.height() != _height)
+		THROW("image and buffer dimensions differ: %d x %d != %d x %d", img.width(), img.height(), _width, _height);
+
+	auto index = [&](int x, int y) { return static_cast<size_t>(y) * _width + x; };
+	auto luminance = [](Point3D v) { return (v[0] + v[1] + v[2]) / 3; };
+
+	std::vector<Point3D> visibility(_features.size()), filtered(_features.size());
+	std::vector<double> variance(_features.size()), filteredVariance(_features.size());
+	for (size_t i = 0; i < _features.size(); i++)
+		if (_features[i].hit) visibility[i] = _features[i].visibility();
+
+	// Estimate the variance of the visibility from its spread over the neighboring pixels on the same surface
+	ThreadPool::Default().parallelFor(0, _height, [&](size_t row) {
+		const int j = static_cast<int>(row);
+		for (int i = 0; i < _width; i++) {
+			const ShadingFeatures& fp = _features[index(i, j)];
+			if (!fp.hit) continue;
+			double sum = 0, squareSum = 0, weightSum = 0;
+			for (int y = std::max<int>(j - VarianceRadius, 0); y <= std::min<int>(j + VarianceRadius, _height - 1); y++)
+				for (int x = std::max<int>(i - VarianceRadius, 0); x <= std::min<int>(i + VarianceRadius, _width - 1); x++) {
+					const ShadingFeatures& fq = _features[index(x, y)];
+					if (!fq.hit) continue;
+					const double w = _geometryWeight(fp, fq, 1), l = luminance(visibility[index(x, y)]);
+					sum += w * l, squareSum += w * l * l, weightSum += w;
+				}
+			const double mean = sum / weightSum;
+			variance[index(i, j)] = std::max<double>(0., squareSum / weightSum - mean * mean);
+		}
+	});
+
+	// Each pass filters with the holes between the taps doubled, so that five passes cover a 125 x 125 footprint at the cost of 5 x 5 taps each.
+	// The variance is filtered alongside (with squared weights), so that the visibility weights tighten as the noise is removed.
+	for (unsigned int it = 0; it < iterations; it++) {
+		const int step = 1 << it;
+		ThreadPool::Default().parallelFor(0, _height, [&](size_t row) {
+			const int j = static_cast<int>(row);
+			for (int i = 0; i < _width; i++) {
+				const size_t p = index(i, j);
+				const ShadingFeatures& fp = _features[p];
+				if (!fp.hit) continue;
+				const double lp = luminance(visibility[p]);
+				const double deviation = sqrt(variance[p]);
+				Point3D sum;
+				double weightSum = 0, varianceSum = 0;
+				for (int dy = -FilterRadius; dy <= FilterRadius; dy++) {
+					const int y = j + dy * step;
+					if (y < 0 || y >= _height) continue;
+					for (int dx = -FilterRadius; dx <= FilterRadius; dx++) {
+						const int x = i + dx * step;
+						if (x < 0 || x >= _width) continue;
+						const size_t q = index(x, y);
+						const ShadingFeatures& fq = _features[q];
+						if (!fq.hit) continue;
+						const double wVisibility = exp(-fabs(lp - luminance(visibility[q])) / (sigmaVisibility * deviation + Epsilon));
+						const double w = FilterWeights[dx + FilterRadius] * FilterWeights[dy + FilterRadius] *
+							_geometryWeight(fp, fq, step) * wVisibility;
+						sum += visibility[q] * w;
+						varianceSum += w * w * variance[q];
+						weightSum += w;
+					}
+				}
+				filtered[p] = sum / weightSum;
+				filteredVariance[p] = varianceSum / (weightSum * weightSum);
+			}
+		});
+		std::swap(visibility, filtered);
+		std::swap(variance, filteredVariance);
+	}
+
+	Image32 out;
+	out.setSize(_width, _height);
+	ThreadPool::Default().parallelFor(0, _height, [&](size_t row) {
+		const int j = static_cast<int>(row);
+		for (int i = 0; i < _width; i++) {
+			const ShadingFeatures& features = (*this)(i, j);
+			if (features.hit)
+				out(i, j) = ToPixel(features.rest + features.unshadowed * visibility[index(i, j)],
+				                    img(i, j).a);
+			else out(i, j) = img(i, j);
+		}
+	});
+	return out;
+}
+
+void ShadowDenoiser::write(const std::string& fileName) const {
+	size_t dot = fileName.find_last_of('.');
+	if (dot == std::string::npos)
+		THROW("image file name has no extension: %s", fileName.c_str());
+	std::string header = fileName.substr(0, dot), ext = fileName.substr(dot + 1);
+
+	for (int b = 0; b < BUFFER_NUM; b++)
+		buffer(b).write(header + "." + BufferNames[b] + "." + ext);
+}
@@ -0,0 +1,103 @@
+#ifndef SHADOW_DENOISER_INCLUDED
+#define SHADOW_DENOISER_INCLUDED
+
+#include <string>
+#include <vector>
+#include <Util/geometry.h>
+#include <Image/image.h>
+
+namespace Ray {
+	/** This class stores the features of the surface seen through a pixel, recorded when shading the primary hit.
+	*** The shaded color splits into the light reaching the surface past the occluders, and everything else (emission, ambient light, reflections and refractions). */
+	struct ShadingFeatures {
+		/** Whether the primary ray hit the scene (the remaining features are only meaningful if it did) */
+		bool hit;
+
+		/** The surface normal at the hit */
+		Util::Point3D normal;
+
+		/** The distance from the camera to the hit */
+		double depth;
+
+		/** The diffuse color of the surface (modulated by its texture) */
+		Util::Point3D albedo;
+
+		/** The diffuse and specular light the surface would receive if nothing were in the way */
+		Util::Point3D unshadowed;
+
+		/** The diffuse and specular light the surface receives, with each light's contribution scaled by its (sampled) transparency */
+		Util::Point3D shadowed;
+
+		/** The remainder of the (unclamped) color */
+		Util::Point3D rest;
+
+		ShadingFeatures(void) : hit(false), depth(0) {}
+
+		/** This method returns the fraction of the unshadowed light that reaches the surface, per channel (one where no light is received) */
+		Util::Point3D visibility(void) const;
+	};
+
+	/** This class stores the shading features of every pixel of a rendered image and uses them to remove the noise from the soft shadows.
+	*** The visibility of the lights is smoothed with an edge-avoiding a-trous wavelet filter whose weights are guided by the normals, depths and albedos,
+	*** and by the visibility itself relative to its local variance (so that shadow edges that are not noisy stay sharp).
+	*** The pixels are then re-composed from their unshadowed light, smoothed visibility and remaining color.
+	*** Only the shadows seen directly are filtered: those seen in reflections and refractions are part of the remainder. */
+	class ShadowDenoiser {
+		/** The dimensions of the image */
+		int _width, _height;
+
+		/** The per-pixel features, in row-major order */
+		std::vector<ShadingFeatures> _features;
+
+		/** This method returns the weight, independent of the visibility, that a tap at the prescribed step gives to the second pixel when filtering the first */
+		double _geometryWeight(const ShadingFeatures& fp, const ShadingFeatures& fq, int step) const;
+
+	public:
+		/** The auxiliary buffers */
+		enum {
+			NORMAL,
+			DEPTH,
+			ALBEDO,
+			VISIBILITY,
+			BUFFER_NUM
+		};
+
+		/** The names of the buffers, used to name the files they are written to */
+		static const char* BufferNames[BUFFER_NUM];
+
+		/** The number of passes of the a-trous filter (the footprint doubles with each one) */
+		unsigned int iterations;
+
+		/** The sensitivities of the weights to differences in normals, relative depths, and albedos */
+		double sigmaNormal, sigmaDepth, sigmaAlbedo;
+
+		/** The sensitivity of the weights to differences in visibility, in units of the visibility's local standard deviation */
+		double sigmaVisibility;
+
+		/** The default constructor creates an empty set of buffers */
+		ShadowDenoiser(void);
+
+		/** This method resizes the buffers, clearing all the features */
+		void resize(int width, int height);
+
+		/** These methods return the dimensions of the buffers */
+		int width(void) const { return _width; }
+		int height(void) const { return _height; }
+
+		/** These methods return the features of the prescribed pixel */
+		ShadingFeatures& operator()(int x, int y) { return _features[static_cast<size_t>(y) * _width + x]; }
+		const ShadingFeatures& operator()(int x, int y) const { return _features[static_cast<size_t>(y) * _width + x]; }
+
+		/** This method returns a visualization of the prescribed buffer.
+		*** Normals are mapped from [-1,1] to [0,255], depths are normalized by the largest depth, and visibilities are averaged across channels. */
+		Image::Image32 buffer(int b) const;
+
+		/** This method returns the image re-composed with the smoothed visibility. Pixels whose primary ray missed the scene are copied from the input image. */
+		Image::Image32 denoise(const Image::Image32& img) const;
+
+		/** This method writes out the auxiliary buffers, deriving the file names from the name of the rendered image.
+		*** For an image "<header>.<ext>" the buffer is written to "<header>.<buffer>.<ext>". */
+		void write(const std::string& fileName) const;
+	};
+}
+#endif // SHADOW_DENOISER_INCLUDED
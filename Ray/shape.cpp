@@ -1,4 +1,7 @@
 #include "shape.h"
+#include "spanList.h"
+#include "rayBatch.h"
+#include "transformFlattener.h"
 
 using namespace Ray;
 using namespace Util;
@@ -7,9 +10,18 @@ using namespace Util;
 // ShapeBoundingBox //
 //////////////////////
 BoundingBox1D ShapeBoundingBox::intersect( const Ray3D &ray ) const
+{
+	double tEntry , tExit;
+	if( intersect( SlabRay( ray ) , tEntry , tExit ) ) return BoundingBox1D( tEntry , tExit );
+	BoundingBox1D miss;
+	miss[0] = Infinity , miss[1] = -Infinity;
+	return miss;
+}
+
+bool ShapeBoundingBox::intersect( const SlabRay &ray , double &tEntry , double &tExit ) const
 {
 	RayTracingStats::IncrementRayBoundingBoxIntersectionNum();
-	return Util::BoundingBox3D::intersect( ray );
+	return ray.intersect( *this , tEntry , tExit );
 }
 
 ///////////
@@ -23,17 +35,111 @@ void Shape::WriteInset( std::ostream &stream ){ for( unsigned int i=0 ; i<WriteI
 
 ShapeBoundingBox Shape::boundingBox( void ) const { return _bBox; }
 
+void Shape::intersectBatch( RayBatch &batch ) const
+{
+	for( size_t i=0 ; i<batch.size() ; i++ )
+	{
+		RayShapeIntersectionInfo iInfo;
+		double t = intersect( batch.rays[i] , iInfo , BoundingBox1D( Point1D( Epsilon ) , Point1D( batch.t[i] ) ) );
+		if( t<batch.t[i] ) batch.t[i] = t , batch.iInfo[i] = iInfo;
+	}
+}
+
+Shape *Shape::flatten( TransformFlattener &flattener ){ return flattener.wrap( this ); }
+
+void Shape::collectSpans( const Ray3D &ray , BoundingBox1D range , SpanList &spans ) const
+{
+	// The most boundaries collected along a single ray, guarding against shapes that report the same hit repeatedly
+	static const int MaxBoundaries = 256;
+
+	spans.clear();
+	if( !SpanList::Clip( _bBox , ray , range ) ) return;
+
+	const double tMin = range[0][0] , tMax = range[1][0];
+	double t = tMin;
+	bool inside = false;
+	for( int b=0 ; b<MaxBoundaries ; b++ )
+	{
+		RayShapeIntersectionInfo iInfo;
+		double _t = intersect( ray , iInfo , BoundingBox1D( Point1D( t ) , Point1D( tMax ) ) );
+		if( !( _t<=tMax ) ) break;
+
+		SpanBoundary boundary;
+		boundary.t = _t , boundary.onSurface = true , boundary.iInfo = iInfo;
+		if( ray.direction.dot( iInfo.normal )<0 )
+		{
+			if( !inside ) spans.spans.emplace_back() , spans.spans.back().entry = boundary , inside = true;
+		}
+		else
+		{
+			// An exit without an entry means the ray started inside
+			if( !inside )
+			{
+				spans.spans.emplace_back();
+				spans.spans.back().entry.t = tMin , spans.spans.back().entry.onSurface = false;
+			}
+			spans.spans.back().exit = boundary , inside = false;
+		}
+		t = _t + Epsilon * std::max< double >( 1. , fabs( _t ) );
+	}
+
+	// Close a span left open at the end of the range, or account for a range lying entirely inside the shape
+	if( !inside && spans.empty() && isInside( ray( ( tMin + tMax ) / 2 ) ) )
+	{
+		spans.spans.emplace_back();
+		spans.spans.back().entry.t = tMin , spans.spans.back().entry.onSurface = false;
+		inside = true;
+	}
+	if( inside ) spans.spans.back().exit.t = tMax , spans.spans.back().exit.onSurface = false;
+}
+
 //////////////////////////
 // RayIntersectionStats //
 //////////////////////////
-size_t RayTracingStats::_RayNum = 0;
-size_t RayTracingStats::_RayPrimitiveIntersectionNum = 0;
-size_t RayTracingStats::_RayBoundingBoxIntersectionNum = 0;
-
-void RayTracingStats::Reset( void ){ _RayNum = _RayPrimitiveIntersectionNum = _RayBoundingBoxIntersectionNum = 0; }
-void RayTracingStats::IncrementRayNum( void ){ _RayNum++; }
-void RayTracingStats::IncrementRayPrimitiveIntersectionNum( void ){ _RayPrimitiveIntersectionNum++; }
-void RayTracingStats::IncrementRayBoundingBoxIntersectionNum( void ){ _RayBoundingBoxIntersectionNum++; }
-size_t RayTracingStats::RayNum( void ){ return _RayNum; }
-size_t RayTracingStats::RayPrimitiveIntersectionNum( void ){ return _RayPrimitiveIntersectionNum; }
-size_t RayTracingStats::RayBoundingBoxIntersectionNum( void ){ return _RayBoundingBoxIntersectionNum; }
+std::atomic< size_t > RayTracingStats::_RayNum( 0 );
+std::atomic< size_t > RayTracingStats::_RayPrimitiveIntersectionNum( 0 );
+std::atomic< size_t > RayTracingStats::_RayBoundingBoxIntersectionNum( 0 );
+thread_local RayTracingStats::Counts RayTracingStats::_ThreadCounts = { 0 , 0 , 0 };
+thread_local RayTracingStats::Counts RayTracingStats::_FlushedCounts = { 0 , 0 , 0 };
+
+// The counters are only read once rendering is done, so no ordering is required
+void RayTracingStats::Reset( void )
+{
+	_RayNum = _RayPrimitiveIntersectionNum = _RayBoundingBoxIntersectionNum = 0;
+	_FlushedCounts = _ThreadCounts;
+}
+void RayTracingStats::Flush( void )
+{
+	_RayNum.fetch_add( _ThreadCounts.rayNum - _FlushedCounts.rayNum , std::memory_order_relaxed );
+	_RayPrimitiveIntersectionNum.fetch_add( _ThreadCounts.primitiveIntersectionNum - _FlushedCounts.primitiveIntersectionNum , std::memory_order_relaxed );
+	_RayBoundingBoxIntersectionNum.fetch_add( _ThreadCounts.boundingBoxIntersectionNum - _FlushedCounts.boundingBoxIntersectionNum , std::memory_order_relaxed );
+	_FlushedCounts = _ThreadCounts;
+}
+void RayTracingStats::IncrementRayNum( void ){ _ThreadCounts.rayNum++; }
+void RayTracingStats::IncrementRayPrimitiveIntersectionNum( void ){ _ThreadCounts.primitiveIntersectionNum++; }
+void RayTracingStats::IncrementRayBoundingBoxIntersectionNum( size_t num ){ _ThreadCounts.boundingBoxIntersectionNum += num; }
+size_t RayTracingStats::RayNum( void ){ Flush() ; return _RayNum; }
+size_t RayTracingStats::RayPrimitiveIntersectionNum( void ){ Flush() ; return _RayPrimitiveIntersectionNum; }
+size_t RayTracingStats::RayBoundingBoxIntersectionNum( void ){ Flush() ; return _RayBoundingBoxIntersectionNum; }
+RayTracingStats::Counts RayTracingStats::ThreadCounts( void ){ return _ThreadCounts; }
+
+/////////////////
+// MemoryStats //
+/////////////////
+const char* MemoryStats::CategoryNames[] = { "scene data" , "shapes" , "acceleration" , "images" , "OpenGL buffers" };
+std::atomic< size_t > MemoryStats::_GLBufferBytes( 0 );
+
+MemoryStats::MemoryStats( void ){ for( int c=0 ; c<CATEGORY_NUM ; c++ ) bytes[c] = 0; }
+
+size_t MemoryStats::total( void ) const
+{
+	size_t total = 0;
+	for( int c=0 ; c<CATEGORY_NUM ; c++ ) total += bytes[c];
+	return total;
+}
+
+bool MemoryStats::visit( const void *owner ){ return _visited.insert( owner ).second; }
+
+void MemoryStats::AddGLBufferBytes( size_t num ){ _GLBufferBytes.fetch_add( num , std::memory_order_relaxed ); }
+void MemoryStats::RemoveGLBufferBytes( size_t num ){ _GLBufferBytes.fetch_sub( num , std::memory_order_relaxed ); }
+size_t MemoryStats::GLBufferBytes( void ){ return _GLBufferBytes; }
@@ -4,6 +4,8 @@
 #include <stdexcept>
 #include <string>
 #include <functional>
+#include <atomic>
+#include <unordered_set>
 #include <Util/geometry.h>
 #include <Util/factory.h>
 #include <GL/glew.h>
@@ -15,6 +17,7 @@
 #endif // __APPLE__
 #include <Util/exceptions.h>
 #include "GLSLProgram.h"
+#include "slab.h"
 
 #define NEW_SHADER_CODE
 
@@ -51,19 +54,81 @@ inline void AssertOpenGLState( const char *functionName )
 
 
 namespace Ray {
-	/** This class stores information about the number of rays cast and the number of ray-primitive intersections performed. */
+	/** This class stores information about the number of rays cast and the number of ray-primitive intersections performed.
+	*** Each thread increments its own (never reset) tallies, which also let the cost of rendering a single pixel be measured,
+	*** and adds what it has counted since its last flush to the shared atomic counters when it flushes (once per tile),
+	*** so that the rendering threads do not contend for the counters' cache line. */
 	struct RayTracingStats {
-		static size_t _RayNum;
-		static size_t _RayPrimitiveIntersectionNum;
-		static size_t _RayBoundingBoxIntersectionNum;
+		static std::atomic<size_t> _RayNum;
+		static std::atomic<size_t> _RayPrimitiveIntersectionNum;
+		static std::atomic<size_t> _RayBoundingBoxIntersectionNum;
 	public:
+		/** The tallies for the calling thread */
+		struct Counts {
+			size_t rayNum, primitiveIntersectionNum, boundingBoxIntersectionNum;
+		};
+
+	protected:
+		static thread_local Counts _ThreadCounts, _FlushedCounts;
+
+	public:
+		/** This method zeroes the shared counters, discarding the calling thread's unflushed tallies */
 		static void Reset(void);
+
+		/** This method adds the calling thread's tallies since its last flush to the shared counters */
+		static void Flush(void);
+
 		static void IncrementRayNum(void);
 		static void IncrementRayPrimitiveIntersectionNum(void);
-		static void IncrementRayBoundingBoxIntersectionNum(void);
+		static void IncrementRayBoundingBoxIntersectionNum(size_t num = 1);
+		/** These methods flush the calling thread's tallies and return the shared counters */
 		static size_t RayNum(void);
 		static size_t RayPrimitiveIntersectionNum(void);
 		static size_t RayBoundingBoxIntersectionNum(void);
+		static Counts ThreadCounts(void);
+	};
+
+	/** This class tallies the number of bytes held by a scene, split into categories.
+	*** The scene data, shapes and acceleration structures are tallied by walking the scene-graph (see Shape::addMemoryUsage),
+	*** while the bytes held by images and OpenGL buffers are tracked as they are allocated.
+	*** The pixels of textures are tallied as scene data, and are moved out of the images when they are reached. */
+	struct MemoryStats {
+		/** The categories */
+		enum {
+			SCENE_DATA,
+			SHAPES,
+			ACCELERATION,
+			IMAGES,
+			GL_BUFFERS,
+			CATEGORY_NUM
+		};
+
+		/** The names of the categories */
+		static const char* CategoryNames[CATEGORY_NUM];
+
+		/** The number of bytes in each category */
+		size_t bytes[CATEGORY_NUM];
+
+		/** The default constructor starts with empty tallies */
+		MemoryStats(void);
+
+		/** This method returns the number of bytes summed over the categories */
+		size_t total(void) const;
+
+		/** This method returns true the first time it is called with the prescribed owner.
+		*** Data that can be reached along several paths through the scene-graph (e.g. through file instances or flattened copies) is only tallied on the first visit. */
+		bool visit(const void* owner);
+
+		/** These static methods record the number of bytes uploaded to (and released from) OpenGL buffers and textures, and return the total */
+		static void AddGLBufferBytes(size_t num);
+		static void RemoveGLBufferBytes(size_t num);
+		static size_t GLBufferBytes(void);
+
+	protected:
+		/** The owners visited so far */
+		std::unordered_set<const void*> _visited;
+
+		static std::atomic<size_t> _GLBufferBytes;
 	};
 
 	/** This class serves as a wrapper for Util::BoundingBox3D, calling RayTracingStats::IncrementRayBoundingBoxIntersectionNum before performing the intersection. */
@@ -83,6 +148,10 @@ namespace Ray {
 		}
 
 		Util::BoundingBox1D intersect(const Util::Ray3D& ray) const;
+
+		/** This method performs the (branchless) slab test against a ray with precomputed inverse direction, returning true if the box is hit in front of the ray's position.
+		*** On return, tEntry and tExit hold the parameters at which the ray enters and exits the box. */
+		bool intersect(const SlabRay& ray, double& tEntry, double& tExit) const;
 	};
 
 	/** This is the abstract class that all ray-traceable objects must implement. */
@@ -136,10 +205,24 @@ namespace Ray {
 		                         Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                         std::function<bool (double)> validityLambda = [](double t) { return true; }) const = 0;
 
+		/** This method intersects a batch of rays with the shape, updating the intersection of each ray that hits the shape closer than its current one.
+		*** By default, each ray is intersected with the shape in turn. */
+		virtual void intersectBatch(class RayBatch& batch) const;
+
 		/** This method determines if a point is inside a shape.
 		*** It is assumed that if the shape is not water-tight, the method returns false. */
 		virtual bool isInside(Util::Point3D p) const = 0;
 
+		/** This method collects the spans along the ray, within the prescribed range, over which the ray is inside the shape.
+		*** By default the range is clipped to the bounding box and the spans are found by repeatedly intersecting the ray with the shape,
+		*** treating hits where the normal faces the ray as entries and the others as exits. */
+		virtual void collectSpans(const Util::Ray3D& ray, Util::BoundingBox1D range, class SpanList& spans) const;
+
+		/** This method returns the shape with the flattener's current transformation baked into its geometry (used for ray-tracing only).
+		*** Shapes that can be transformed exactly return world-space copies created by the flattener, or themselves if no transformation is being applied.
+		*** By default the shape is wrapped in a single static affine shape applying the composed transformation. */
+		virtual Shape* flatten(class TransformFlattener& flattener);
+
 		/** This method calls the necessary OpenGL commands to render the primitive. */
 		virtual void drawOpenGL(GLSLProgram* glslProgram) const =0;
 
@@ -148,6 +231,11 @@ namespace Ray {
 
 		/** This method returns the count of basic shapes contained within the Shape. */
 		virtual size_t primitiveNum(void) const = 0;
+
+		/** This method adds the bytes held by the shape to the tallies, and recurses into the shapes it references.
+		*** The shape objects themselves are allocated from the factories' arenas, which are tallied separately, so only the memory they own is added.
+		*** By default the shape owns nothing. */
+		virtual void addMemoryUsage(MemoryStats& stats) const {}
 	};
 
 	/** This operator writes the shape out to a stream. */
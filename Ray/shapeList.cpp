@@ -2,6 +2,7 @@
 #include "triangle.h"
 #include "shapeList.h"
 #include "scene.h"
+#include "transformFlattener.h"
 
 using namespace std;
 using namespace Ray;
@@ -16,14 +17,24 @@ void AffineShape::initOpenGL(void) { _shape->initOpenGL(); }
 
 size_t AffineShape::primitiveNum(void) const { return _shape->primitiveNum(); }
 
+void AffineShape::addMemoryUsage(MemoryStats& stats) const { _shape->addMemoryUsage(stats); }
+
 
 ///////////////////////
 // StaticAffineShape //
 ///////////////////////
-StaticAffineShape::StaticAffineShape(void) : AffineShape(), _localTransform(Matrix4D::Identity()) {}
+StaticAffineShape::StaticAffineShape(void) : AffineShape(), _localTransform(Matrix4D::Identity()), _updatesShape(true) {}
 
 void StaticAffineShape::set(Matrix4D m) { _localTransform = m; }
 
+void StaticAffineShape::set(Matrix4D m, Shape* shape, bool updatesShape) {
+	_localTransform = m;
+	_inverseTransform = m.inverse();
+	_normalTransform = m.inverse().transpose();
+	_shape = shape;
+	_updatesShape = updatesShape;
+}
+
 void StaticAffineShape::_write(std::ostream& stream) const {
 	WriteInset(stream);
 	stream << "#" << Directive() << "  " << _localTransform << std::endl;
@@ -35,7 +46,6 @@ void StaticAffineShape::_write(std::ostream& stream) const {
 void StaticAffineShape::_read(std::istream& stream) {
 	if (!(stream >> _localTransform))
 		THROW("Failed to parse %s", Directive().c_str());
-	if (_shape) delete _shape;
 	_shape = ReadShape(stream, ShapeList::ShapeFactories);
 }
 
@@ -47,6 +57,18 @@ void StaticAffineShape::init(const LocalSceneData& data) {
 
 void StaticAffineShape::initOpenGL(void) { _shape->initOpenGL(); }
 
+void StaticAffineShape::updateBoundingBox(void) {
+	if (_updatesShape) _shape->updateBoundingBox();
+	_bBox = getMatrix() * _shape->boundingBox();
+}
+
+Shape* StaticAffineShape::flatten(TransformFlattener& flattener) {
+	flattener.push(_localTransform);
+	Shape* shape = _shape->flatten(flattener);
+	flattener.pop();
+	return shape;
+}
+
 Matrix4D StaticAffineShape::getMatrix(void) const { return _localTransform; }
 
 Matrix4D StaticAffineShape::getInverseMatrix(void) const { return _inverseTransform; }
@@ -69,7 +91,6 @@ void DynamicAffineShape::_write(std::ostream& stream) const {
 void DynamicAffineShape::_read(std::istream& stream) {
 	if (!(stream >> _paramName))
 		THROW("Failed to parse %s", Directive().c_str());
-	if (_shape) delete _shape;
 	_shape = ReadShape(stream, ShapeList::ShapeFactories);
 }
 
@@ -136,12 +157,25 @@ void Difference::drawOpenGL(GLSLProgram* glslProgram) const {
 
 size_t Difference::primitiveNum(void) const { return _shape0->primitiveNum() + _shape1->primitiveNum(); }
 
+void Difference::addMemoryUsage(MemoryStats& stats) const { _shape0->addMemoryUsage(stats), _shape1->addMemoryUsage(stats); }
+
 
 /////////////////////////
 // ShapeBoundingBoxHit //
 /////////////////////////
+thread_local std::vector<std::unique_ptr<std::vector<ShapeBoundingBoxHit>>> ShapeBoundingBoxHit::_Pool;
+thread_local size_t ShapeBoundingBoxHit::_PoolInUse = 0;
+
 bool ShapeBoundingBoxHit::Compare(const ShapeBoundingBoxHit& v1, const ShapeBoundingBoxHit& v2) { return v1.t < v2.t; }
 
+ShapeBoundingBoxHit::Buffer::Buffer(void) {
+	if (_PoolInUse == _Pool.size()) _Pool.emplace_back(new std::vector<ShapeBoundingBoxHit>());
+	_hits = _Pool[_PoolInUse++].get();
+	_hits->clear();
+}
+
+ShapeBoundingBoxHit::Buffer::~Buffer(void) { _PoolInUse--; }
+
 ///////////////
 // ShapeList //
 ///////////////
@@ -154,7 +188,10 @@ void ShapeList::_read(std::istream& stream) {
 		try { keyword = ReadDirective(stream); }
 		catch (Exception e) { THROW("failed to read directive in %s\n%s", name().c_str(), e.what()); }
 		// Test if we are closing the list
-		if (keyword == endDirective) return;
+		if (keyword == endDirective) {
+			shapes.shrink_to_fit();
+			return;
+		}
 		// Otherwise read the next shape
 		if (ShapeFactories.find(keyword) != ShapeFactories.end()) {
 			Shape* shape = ShapeFactories[keyword]->create();
@@ -188,6 +225,28 @@ size_t ShapeList::primitiveNum(void) const {
 	return pNum;
 }
 
+void ShapeList::addMemoryUsage(MemoryStats& stats) const {
+	// Lists shared between the original and flattened scene-graphs are only tallied once
+	if (!stats.visit(this)) return;
+	stats.bytes[MemoryStats::SHAPES] += shapes.capacity() * sizeof(Shape*);
+	stats.bytes[MemoryStats::ACCELERATION] += _bBoxPackets.capacity() * sizeof(BoundingBoxPacket);
+	for (int i = 0; i < shapes.size(); i++) shapes[i]->addMemoryUsage(stats);
+}
+
+Shape* ShapeList::flatten(TransformFlattener& flattener) {
+	// The list is only copied if flattening changes one of its shapes
+	std::vector<Shape*> flattened(shapes.size());
+	bool changed = false;
+	for (int i = 0; i < shapes.size(); i++) {
+		flattened[i] = shapes[i]->flatten(flattener);
+		if (flattened[i] != shapes[i]) changed = true;
+	}
+	if (!changed) return this;
+	ShapeList* shapeList = flattener.create<ShapeList>();
+	shapeList->shapes = flattened;
+	return shapeList;
+}
+
 
 //////////////////
 // TriangleList //
@@ -228,6 +287,19 @@ void TriangleList::addTrianglesOpenGL(std::vector<TriangleIndex>& triangles) {
 
 size_t TriangleList::primitiveNum(void) const { return _shapeList.primitiveNum(); }
 
+void TriangleList::addMemoryUsage(MemoryStats& stats) const { _shapeList.addMemoryUsage(stats); }
+
+Shape* TriangleList::flatten(TransformFlattener& flattener) {
+	if (!flattener.transformed()) return this;
+	// The copy is only ray-traced, so only the material and the triangles are needed
+	TriangleList* triangleList = flattener.create<TriangleList>();
+	triangleList->_materialIndex = _materialIndex;
+	triangleList->_material = _material;
+	for (int i = 0; i < _shapeList.shapes.size(); i++)
+		triangleList->_shapeList.shapes.push_back(_shapeList.shapes[i]->flatten(flattener));
+	return triangleList;
+}
+
 ///////////
 // Union //
 ///////////
@@ -256,6 +328,8 @@ void Union::initOpenGL(void) {
 
 size_t Union::primitiveNum(void) const { return _shapeList.primitiveNum(); }
 
+void Union::addMemoryUsage(MemoryStats& stats) const { _shapeList.addMemoryUsage(stats); }
+
 
 //////////////////
 // Intersection //
@@ -284,3 +358,5 @@ void Intersection::initOpenGL(void) {
 }
 
 size_t Intersection::primitiveNum(void) const { return _shapeList.primitiveNum(); }
+
+void Intersection::addMemoryUsage(MemoryStats& stats) const { _shapeList.addMemoryUsage(stats); }
@@ -1,5 +1,6 @@
 #ifndef GROUP_INCLUDED
 #define GROUP_INCLUDED
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <Util/geometry.h>
@@ -33,9 +34,11 @@ namespace Ray {
 		double intersect(Util::Ray3D ray, class RayShapeIntersectionInfo& iInfo,
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityFunction = [](double t) { return true; }) const override;
+		void intersectBatch(class RayBatch& batch) const override;
 		bool isInside(Util::Point3D p) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
 	};
 
 
@@ -49,6 +52,9 @@ namespace Ray {
 
 		/** The static normal transformation associated to the shape */
 		Util::Matrix3D _normalTransform;
+
+		/** Whether updating the bounding box also updates that of the shape (unset if the shape is shared, and updated by its owner) */
+		bool _updatesShape;
 	public:
 		/** This static method returns the directive describing the shape. */
 		static std::string Directive(void) { return "static_affine"; }
@@ -59,6 +65,10 @@ namespace Ray {
 		/** This method initializes the transform with the prescribed matrix.*/
 		void set(Util::Matrix4D m);
 
+		/** This method sets the transformation and the shape it applies to, for a shape that is already initialized (so init need not be called).
+		*** If the shape is shared with another scene-graph, which updates its bounding box, it is not updated again through this one. */
+		void set(Util::Matrix4D m, Shape* shape, bool updatesShape = true);
+
 		///////////////////
 		// Shape methods //
 		///////////////////
@@ -69,6 +79,8 @@ namespace Ray {
 		std::string name(void) const override { return "static affine"; }
 		void init(const class LocalSceneData& data) override;
 		void initOpenGL(void) override;
+		void updateBoundingBox(void) override;
+		Shape* flatten(class TransformFlattener& flattener) override;
 
 		/////////////////////////
 		// AffineShape methods //
@@ -139,12 +151,20 @@ namespace Ray {
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityFunction = [](double t) { return true; }) const override;
 		bool isInside(Util::Point3D p) const override;
+		void collectSpans(const Util::Ray3D& ray, Util::BoundingBox1D range, class SpanList& spans) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
 	};
 
 	/** This class can be used for sorting shapes based on the intersections of their bounding volumes with a given ray.*/
 	class ShapeBoundingBoxHit {
+		/** The hit lists allocated by each thread, reused from ray to ray */
+		static thread_local std::vector<std::unique_ptr<std::vector<ShapeBoundingBoxHit>>> _Pool;
+
+		/** The number of the calling thread's hit lists that are currently in use */
+		static thread_local size_t _PoolInUse;
+
 	public:
 		/** The time along the ray to the point of intersection */
 		double t;
@@ -156,6 +176,21 @@ namespace Ray {
 		*** For example after the bounding volumes have been intersected and the distance and shapes have been written into
 		*** an array of RayShapes, the array can be sorted by calling std::sort. */
 		static bool Compare(const ShapeBoundingBoxHit& v1, const ShapeBoundingBoxHit& v2);
+
+		/** This class provides a cleared hit list from the calling thread's pool, returning it to the pool when it goes out of scope.
+		*** As with SpanList::Buffer, buffers must be released in the reverse order in which they were acquired. */
+		class Buffer {
+			std::vector<ShapeBoundingBoxHit>* _hits;
+
+		public:
+			Buffer(void);
+			~Buffer(void);
+			Buffer(const Buffer&) = delete;
+			Buffer& operator=(const Buffer&) = delete;
+
+			std::vector<ShapeBoundingBoxHit>& operator*(void) { return *_hits; }
+			std::vector<ShapeBoundingBoxHit>* operator->(void) { return _hits; }
+		};
 	};
 
 	/** This class represents a node in the scene graph containing one or more shapes */
@@ -165,6 +200,9 @@ namespace Ray {
 
 		/** This static method returns the directive header describing the shape. */
 		static std::string _DirectiveHeader(void) { return "shape_list"; }
+
+		/** The bounding boxes of the shapes, packed four to a packet for the slab test (set by updateBoundingBox) */
+		std::vector<BoundingBoxPacket> _bBoxPackets;
 	public:
 		/** The set of shape factoendDirectiveries */
 		static std::unordered_map<std::string, Util::BaseFactory<Shape>*> ShapeFactories;
@@ -189,10 +227,13 @@ namespace Ray {
 		double intersect(Util::Ray3D ray, class RayShapeIntersectionInfo& iInfo,
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityFunction = [](double t) { return true; }) const override;
+		void intersectBatch(class RayBatch& batch) const override;
 		bool isInside(Util::Point3D p) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		void addTrianglesOpenGL(std::vector<class TriangleIndex>& triangles) override;
 		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
+		Shape* flatten(class TransformFlattener& flattener) override;
 	};
 
 	/** This class represents a node which stores a triangle list. It's children can only be Triangles or TrivialShapeLists.*/
@@ -252,12 +293,19 @@ namespace Ray {
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		void addTrianglesOpenGL(std::vector<TriangleIndex>& triangles) override;
 		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
+		Shape* flatten(class TransformFlattener& flattener) override;
 	};
 
 	/** This class represents a node which stores the union of a set of shapes*/
 	class Union : public Shape {
 		/** The list of shapes */
 		ShapeList _shapeList;
+
+		/** This method collects the spans of the union. If a validity lambda is given, only the spans up to the first valid boundary are guaranteed,
+		*** and the children are visited in the order their bounding boxes are entered, stopping once the next box lies beyond that boundary. */
+		void _collectSpans(const Util::Ray3D& ray, Util::BoundingBox1D range, class SpanList& spans,
+		                   const std::function<bool (double)>* validityLambda) const;
 	public:
 		/** This static method returns the directive header describing the shape. */
 		static std::string Directive(void) { return "shape_union"; }
@@ -274,11 +322,13 @@ namespace Ray {
 		void initOpenGL(void) override;
 		void updateBoundingBox(void) override;
 		bool isInside(Util::Point3D p) const override;
+		void collectSpans(const Util::Ray3D& ray, Util::BoundingBox1D range, class SpanList& spans) const override;
 		double intersect(Util::Ray3D ray, class RayShapeIntersectionInfo& iInfo,
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityFunction = [](double t) { return true; }) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
 	};
 
 
@@ -303,11 +353,13 @@ namespace Ray {
 		void initOpenGL(void) override;
 		void updateBoundingBox(void) override;
 		bool isInside(Util::Point3D p) const override;
+		void collectSpans(const Util::Ray3D& ray, Util::BoundingBox1D range, class SpanList& spans) const override;
 		double intersect(Util::Ray3D ray, class RayShapeIntersectionInfo& iInfo,
 		                 Util::BoundingBox1D range = Util::BoundingBox1D(Util::Epsilon, Util::Infinity),
 		                 std::function<bool (double)> validityFunction = [](double t) { return true; }) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		void addMemoryUsage(MemoryStats& stats) const override;
 	};
 }
 #endif // GROUP_INCLUDED
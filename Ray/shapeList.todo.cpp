@@ -1,6 +1,9 @@
 #include <Util/exceptions.h>
+#include <Util/threadPool.h>
 #include "shapeList.h"
 #include "triangle.h"
+#include "spanList.h"
+#include "rayBatch.h"
 
 using namespace Ray;
 using namespace Util;
@@ -13,24 +16,39 @@ void Difference::updateBoundingBox(void) {
 	// Set the _bBox object here //
 	///////////////////////////////
 	_shape0->updateBoundingBox();
+	_shape1->updateBoundingBox();
 	_bBox = _shape0->boundingBox();
 }
 
+void Difference::collectSpans(const Ray3D& ray, BoundingBox1D range, SpanList& spans) const {
+	spans.clear();
+	SpanList::Buffer spans0, spans1;
+	_shape0->collectSpans(ray, range, *spans0);
+
+	// The subtracted shape only matters where the ray is inside the first
+	if (!spans0->clip(range)) return;
+	_shape1->collectSpans(ray, range, *spans1);
+	SpanList::Difference(*spans0, *spans1, spans);
+}
+
 double Difference::intersect(Ray3D ray, class RayShapeIntersectionInfo& iInfo, BoundingBox1D range,
                              std::function<bool (double)> validityLambda) const {
 	//////////////////////////////////////////////////////////////////
 	// Compute the intersection of the difference with the ray here //
 	//////////////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return Infinity;
+	SpanList::Buffer spans;
+	collectSpans(ray, range, *spans);
+	const SpanBoundary* boundary = spans->first(range[0][0], validityLambda);
+	if (!boundary) return Infinity;
+	iInfo = boundary->iInfo;
+	return boundary->t;
 }
 
 bool Difference::isInside(Point3D p) const {
 	//////////////////////////////////////////////////////////
 	// Determine if the point is inside the difference here //
 	//////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	return _shape0->isInside(p) && !_shape1->isInside(p);
 }
 
 ///////////////
@@ -41,37 +59,73 @@ double ShapeList::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, Bounding
 	//////////////////////////////////////////////////////////////////
 	// Compute the intersection of the shape list with the ray here //
 	//////////////////////////////////////////////////////////////////
-	std::vector<ShapeBoundingBoxHit> hits;
-	for (const auto shape : shapes) {
-		ShapeBoundingBoxHit hit{};
-		const BoundingBox1D r = shape->boundingBox().intersect(ray);
-		if (r.isEmpty() || r[0][0] > range[1][0]) continue;
-		hit.t = r[0][0] > 0 ? r[0][0] : r[1][0];
-		hit.shape = shape;
-		hits.push_back(hit);
+	ShapeBoundingBoxHit::Buffer hitBuffer;
+	std::vector<ShapeBoundingBoxHit>& hits = *hitBuffer;
+	const SlabRay slabRay(ray);
+	RayTracingStats::IncrementRayBoundingBoxIntersectionNum(shapes.size());
+	for (size_t p = 0; p < _bBoxPackets.size(); p++) {
+		float tEntry[BoundingBoxPacket::Size], tExit[BoundingBoxPacket::Size];
+		const int mask = _bBoxPackets[p].intersect(slabRay, tEntry, tExit);
+		for (int lane = 0; lane < BoundingBoxPacket::Size; lane++) {
+			if (!(mask & (1 << lane)) || tEntry[lane] > range[1][0]) continue;
+			ShapeBoundingBoxHit hit{};
+			hit.t = std::max<double>(tEntry[lane], range[0][0]);
+			hit.shape = shapes[p * BoundingBoxPacket::Size + lane];
+			hits.push_back(hit);
+		}
 	}
+	// The boxes are visited in the order in which the ray enters them, narrowing the range to the closest intersection found,
+	// until the next box starts beyond it (so that, as with intersectBatch, the closest intersection is returned)
 	std::sort(hits.begin(), hits.end(), ShapeBoundingBoxHit::Compare);
+	double t = Infinity;
 	for (const auto hit : hits) {
+		if (hit.t > range[1][0]) break;
 		RayShapeIntersectionInfo thisInfo;
 		const double d = hit.shape->intersect(ray, thisInfo, range, validityLambda);
 		if (isinf(d) || !range.isInside(d)) continue;
 		iInfo = thisInfo;
-		return d;
+		t = range[1][0] = d;
+	}
+	return t;
+}
+
+void ShapeList::intersectBatch(RayBatch& batch) const {
+	// Each child is handed the rays that reach its bounding box in front of their current intersections
+	std::vector<SlabRay> slabRays;
+	slabRays.reserve(batch.size());
+	for (const auto& ray : batch.rays) slabRays.emplace_back(ray);
+
+	RayBatch childBatch;
+	std::vector<size_t> indices;
+	for (const auto shape : shapes) {
+		const ShapeBoundingBox bBox = shape->boundingBox();
+		childBatch.clear(), indices.clear();
+		for (size_t i = 0; i < batch.size(); i++) {
+			double tEntry, tExit;
+			if (!bBox.intersect(slabRays[i], tEntry, tExit) || tEntry >= batch.t[i]) continue;
+			childBatch.add(batch.rays[i]);
+			childBatch.t.back() = batch.t[i];
+			indices.push_back(i);
+		}
+		if (!childBatch.size()) continue;
+		shape->intersectBatch(childBatch);
+		for (size_t j = 0; j < indices.size(); j++)
+			if (childBatch.t[j] < batch.t[indices[j]])
+				batch.t[indices[j]] = childBatch.t[j], batch.iInfo[indices[j]] = childBatch.iInfo[j];
 	}
-	return Infinity;
 }
 
 bool ShapeList::isInside(Point3D p) const {
 	//////////////////////////////////////////////////////////
 	// Determine if the point is inside the shape list here //
 	//////////////////////////////////////////////////////////
-	THROW("method undefined");
+	for (const auto shape : shapes) if (shape->isInside(p)) return true;
 	return false;
 }
 
 void ShapeList::init(const LocalSceneData& data) {
-	// Initialize the children
-	for (int i = 0; i < shapes.size(); i++) shapes[i]->init(data);
+	// Initialize the children (in parallel, as they are independent)
+	ThreadPool::Default().parallelFor(0, shapes.size(), [&](size_t i) { shapes[i]->init(data); });
 
 	///////////////////////////////////
 	// Do any additional set-up here //
@@ -82,15 +136,25 @@ void ShapeList::updateBoundingBox(void) {
 	///////////////////////////////
 	// Set the _bBox object here //
 	///////////////////////////////
-	auto pList = new Point3D[shapes.size() * 2];
-	for (int i = 0; i < shapes.size(); i++) {
-		shapes[i]->updateBoundingBox();
-		_bBox = shapes[i]->boundingBox();
-		pList[2 * i] = _bBox[0];
-		pList[2 * i + 1] = _bBox[1];
+	ThreadPool::Default().parallelFor(0, shapes.size(), [&](size_t i) { shapes[i]->updateBoundingBox(); });
+
+	// The box spans the corners of the children's boxes
+	// (accumulated directly, rather than with BoundingBox3D::operator+=, which skips flat boxes as empty)
+	_bBox = BoundingBox3D();
+	for (size_t i = 0; i < shapes.size(); i++) {
+		const BoundingBox3D bBox = shapes[i]->boundingBox();
+		if (!i) _bBox[0] = _bBox[1] = bBox[0];
+		for (int c = 0; c < 2; c++)
+			for (int j = 0; j < 3; j++) {
+				_bBox[0][j] = std::min<double>(_bBox[0][j], bBox[c][j]);
+				_bBox[1][j] = std::max<double>(_bBox[1][j], bBox[c][j]);
+			}
 	}
-	_bBox = BoundingBox3D(pList, static_cast<int>(shapes.size()) * 2);
-	delete[] pList;
+
+	// Pack the children's boxes for the slab test (unused lanes of the last packet are never hit)
+	_bBoxPackets.assign((shapes.size() + BoundingBoxPacket::Size - 1) / BoundingBoxPacket::Size, BoundingBoxPacket());
+	for (size_t i = 0; i < shapes.size(); i++)
+		_bBoxPackets[i / BoundingBoxPacket::Size].set(static_cast<int>(i % BoundingBoxPacket::Size), shapes[i]->boundingBox());
 }
 
 void ShapeList::initOpenGL(void) {
@@ -129,23 +193,57 @@ double AffineShape::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, Boundi
 	// transform ray G2L
 	Ray3D local_ray;
 	local_ray.position = globalToLocal * ray.position;
-	local_ray.direction = (globalToLocalLinear * ray.direction).unit();
+	local_ray.direction = globalToLocalLinear * ray.direction;
+	// the local direction is normalized, so global parameters scale by the length of the transformed direction
+	const double scale = local_ray.direction.length();
+	local_ray.direction /= scale;
+	const BoundingBox1D local_range(Point1D(range[0][0] * scale), Point1D(range[1][0] * scale));
 	// intersect in L space
-	const double local_d = _shape->intersect(local_ray, iInfo, range, validityLambda);
+	const double local_d = _shape->intersect(local_ray, iInfo, local_range,
+	                                         [&](double t) { return validityLambda(t / scale); });
 	if (isinf(local_d)) return Infinity;
 	// transform hit info L2G
 	iInfo.position = localToGlobal * iInfo.position;
 	iInfo.normal = (localToGlobalNormal * iInfo.normal).unit();
-	const double d = (iInfo.position - ray.position).length();
-	return d;
+	return local_d / scale;
+}
+
+void AffineShape::intersectBatch(RayBatch& batch) const {
+	const Matrix4D globalToLocal = getInverseMatrix();
+	const Matrix3D globalToLocalLinear(globalToLocal);
+	const Matrix4D localToGlobal = getMatrix();
+	const Matrix3D localToGlobalNormal = getNormalMatrix();
+	// transform the rays G2L, scaling the parameters of their current intersections to the normalized local directions
+	RayBatch localBatch;
+	std::vector<double> scales(batch.size());
+	for (size_t i = 0; i < batch.size(); i++) {
+		Ray3D local_ray;
+		local_ray.position = globalToLocal * batch.rays[i].position;
+		local_ray.direction = globalToLocalLinear * batch.rays[i].direction;
+		scales[i] = local_ray.direction.length();
+		local_ray.direction /= scales[i];
+		localBatch.add(local_ray);
+		localBatch.t.back() = batch.t[i] * scales[i];
+	}
+	// intersect in L space, remembering the local parameters so that only the rays the shape actually hit are updated
+	// (the round trip through the scale can make an unchanged parameter compare as closer)
+	const std::vector<double> localT = localBatch.t;
+	_shape->intersectBatch(localBatch);
+	// transform hit info L2G
+	for (size_t i = 0; i < batch.size(); i++) {
+		if (!(localBatch.t[i] < localT[i])) continue;
+		batch.t[i] = std::min(batch.t[i], localBatch.t[i] / scales[i]);
+		batch.iInfo[i] = localBatch.iInfo[i];
+		batch.iInfo[i].position = localToGlobal * batch.iInfo[i].position;
+		batch.iInfo[i].normal = (localToGlobalNormal * batch.iInfo[i].normal).unit();
+	}
 }
 
 bool AffineShape::isInside(Point3D p) const {
 	///////////////////////////////////////////////////////////////////////
 	// Determine if the point is inside the affinely deformed shape here //
 	///////////////////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return _shape->isInside(p);
+	return _shape->isInside(getInverseMatrix() * p);
 }
 
 void AffineShape::updateBoundingBox(void) {
@@ -265,12 +363,14 @@ void TriangleList::initOpenGL(void) {
 	glGenBuffers(1, &_vertexBufferID);
 	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferID);
 	glBufferData(GL_ARRAY_BUFFER, 8 * _vNum * sizeof(GLfloat), vertexData, GL_STATIC_DRAW);
+	MemoryStats::AddGLBufferBytes(8 * _vNum * sizeof(GLfloat));
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	delete[] vertexData;
 
 	glGenBuffers(1, &_elementBufferID);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferID);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangles.size() * sizeof(GLuint) * 3, &triangles[0][0], GL_STATIC_DRAW);
+	MemoryStats::AddGLBufferBytes(triangles.size() * sizeof(GLuint) * 3);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	glGenVertexArrays(1, &_vertexArrayID);
@@ -299,13 +399,54 @@ void TriangleList::initOpenGL(void) {
 ///////////
 // Union //
 ///////////
+void Union::_collectSpans(const Ray3D& ray, BoundingBox1D range, SpanList& spans,
+                          const std::function<bool (double)>* validityLambda) const {
+	spans.clear();
+	if (!SpanList::Clip(_bBox, ray, range)) return;
+
+	// Order the children by where the ray enters their bounding boxes
+	ShapeBoundingBoxHit::Buffer hitBuffer;
+	std::vector<ShapeBoundingBoxHit>& hits = *hitBuffer;
+	const SlabRay slabRay(ray);
+	RayTracingStats::IncrementRayBoundingBoxIntersectionNum(_shapeList.shapes.size());
+	for (const auto shape : _shapeList.shapes) {
+		double tEntry, tExit;
+		if (!shape->boundingBox().intersect(slabRay, tEntry, tExit) || tEntry > range[1][0] || tExit < range[0][0]) continue;
+		ShapeBoundingBoxHit hit{};
+		hit.t = tEntry, hit.shape = shape;
+		hits.push_back(hit);
+	}
+	std::sort(hits.begin(), hits.end(), ShapeBoundingBoxHit::Compare);
+
+	SpanList::Buffer childSpans, merged;
+	for (const auto hit : hits) {
+		// A child entered beyond the first valid boundary cannot change the union in front of it
+		if (validityLambda) {
+			const SpanBoundary* boundary = spans.first(range[0][0], *validityLambda);
+			if (boundary && boundary->t < hit.t) break;
+		}
+		hit.shape->collectSpans(ray, range, *childSpans);
+		if (childSpans->empty()) continue;
+		SpanList::Union(spans, *childSpans, *merged);
+		std::swap(spans.spans, merged->spans);
+	}
+}
+
+void Union::collectSpans(const Ray3D& ray, BoundingBox1D range, SpanList& spans) const {
+	_collectSpans(ray, range, spans, nullptr);
+}
+
 double Union::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingBox1D range,
                         std::function<bool (double)> validityLambda) const {
 	/////////////////////////////////////////////////////////////
 	// Compute the intersection of the union with the ray here //
 	/////////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return Infinity;
+	SpanList::Buffer spans;
+	_collectSpans(ray, range, *spans, &validityLambda);
+	const SpanBoundary* boundary = spans->first(range[0][0], validityLambda);
+	if (!boundary) return Infinity;
+	iInfo = boundary->iInfo;
+	return boundary->t;
 }
 
 void Union::init(const LocalSceneData& data) {
@@ -314,7 +455,6 @@ void Union::init(const LocalSceneData& data) {
 	///////////////////////////////////
 	// Do any additional set-up here //
 	///////////////////////////////////
-	WARN_ONCE("method undefined");
 }
 
 void Union::updateBoundingBox(void) {
@@ -330,19 +470,38 @@ bool Union::isInside(Point3D p) const {
 	/////////////////////////////////////////////////////
 	// Determine if the point is inside the union here //
 	/////////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	return _shapeList.isInside(p);
 }
 
 //////////////////
 // Intersection //
 //////////////////
+void Intersection::collectSpans(const Ray3D& ray, BoundingBox1D range, SpanList& spans) const {
+	spans.clear();
+	if (!SpanList::Clip(_bBox, ray, range)) return;
+
+	SpanList::Buffer childSpans, merged;
+	_shapeList.shapes[0]->collectSpans(ray, range, spans);
+	for (size_t i = 1; i < _shapeList.shapes.size(); i++) {
+		// Once the spans are empty no further child can add to them, and otherwise only their extent needs to be searched
+		if (!spans.clip(range)) return;
+		_shapeList.shapes[i]->collectSpans(ray, range, *childSpans);
+		SpanList::Intersection(spans, *childSpans, *merged);
+		std::swap(spans.spans, merged->spans);
+	}
+}
+
 double Intersection::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingBox1D range,
                                std::function<bool (double)> validityLambda) const {
 	/////////////////////////////////////////////////////////////////////////////////////
 	// Compute the intersection of the difference with the intersection of shapes here //
 	/////////////////////////////////////////////////////////////////////////////////////
-	THROW("method undefined");
+	SpanList::Buffer spans;
+	collectSpans(ray, range, *spans);
+	const SpanBoundary* boundary = spans->first(range[0][0], validityLambda);
+	if (!boundary) return Infinity;
+	iInfo = boundary->iInfo;
+	return boundary->t;
 }
 
 void Intersection::init(const LocalSceneData& data) {
@@ -351,7 +510,6 @@ void Intersection::init(const LocalSceneData& data) {
 	///////////////////////////////////
 	// Do any additional set-up here //
 	///////////////////////////////////
-	WARN_ONCE("method undefined");
 }
 
 void Intersection::updateBoundingBox(void) {
@@ -367,6 +525,6 @@ bool Intersection::isInside(Point3D p) const {
 	///////////////////////////////////////////////////////////////////////
 	// Determine if the point is inside the instersection of shapes here //
 	///////////////////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	for (const auto shape : _shapeList.shapes) if (!shape->isInside(p)) return false;
+	return true;
 }
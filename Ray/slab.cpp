@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "slab.h"
+
+using namespace Ray;
+using namespace Util;
+
+namespace {
+	/** The factor by which the exit parameters of the single-precision test are scaled so that rounding does not turn a grazing hit into a miss.
+	*** This is 1 + 2 * gamma(3), with gamma(n) = n * u / (1 - n * u) bounding the relative error of n floating-point operations with unit round-off u.
+	*** (See Ize, "Robust BVH Ray Traversal".) */
+	const float ExitScale = 1.f + 2.f * (3.f * std::numeric_limits<float>::epsilon() / 2.f) /
+		(1.f - 3.f * std::numeric_limits<float>::epsilon() / 2.f);
+
+	/** These functions return the largest float no larger, and the smallest float no smaller, than the value */
+	float RoundDown(double value) {
+		float f = static_cast<float>(value);
+		return f > value ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+	}
+
+	float RoundUp(double value) {
+		float f = static_cast<float>(value);
+		return f < value ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+	}
+}
+
+/////////////
+// SlabRay //
+/////////////
+SlabRay::SlabRay(const Ray3D& ray) : ray(ray) {
+	for (int d = 0; d < 3; d++) {
+		inverseDirection[d] = 1. / ray.direction[d];
+		sign[d] = inverseDirection[d] < 0 ? 1 : 0;
+		// The rounding error of the position, doubled to cover the rounding of the widened parameters
+		// (capped, so that the infinite parameters of parallel axes and cleared lanes do not become NaNs)
+		const double error = fabs(ray.position[d] - static_cast<float>(ray.position[d]));
+		positionSlack[d] = error ? std::min(RoundUp(2. * error * fabs(inverseDirection[d])), std::numeric_limits<float>::max()) : 0.f;
+	}
+#ifdef SLAB_USE_SSE
+	positionXY = _mm_set_pd(ray.position[1], ray.position[0]);
+	positionZZ = _mm_set1_pd(ray.position[2]);
+	inverseDirectionXY = _mm_set_pd(inverseDirection[1], inverseDirection[0]);
+	inverseDirectionZZ = _mm_set1_pd(inverseDirection[2]);
+	for (int d = 0; d < 3; d++) {
+		position4[d] = _mm_set1_ps(static_cast<float>(ray.position[d]));
+		inverseDirection4[d] = _mm_set1_ps(static_cast<float>(inverseDirection[d]));
+		positionSlack4[d] = _mm_set1_ps(positionSlack[d]);
+	}
+#endif // SLAB_USE_SSE
+}
+
+bool SlabRay::intersect(const BoundingBox3D& bBox, double& tEntry, double& tExit) const {
+#ifdef SLAB_USE_SSE
+	// The sign bits select the near and far planes of each slab, so each axis contributes one entry and one exit parameter
+	const __m128d nearXY = _mm_set_pd(bBox[sign[1]][1], bBox[sign[0]][0]);
+	const __m128d farXY = _mm_set_pd(bBox[1 - sign[1]][1], bBox[1 - sign[0]][0]);
+	const __m128d nearFarZ = _mm_set_pd(bBox[1 - sign[2]][2], bBox[sign[2]][2]);
+	const __m128d tNearXY = _mm_mul_pd(_mm_sub_pd(nearXY, positionXY), inverseDirectionXY);
+	const __m128d tFarXY = _mm_mul_pd(_mm_sub_pd(farXY, positionXY), inverseDirectionXY);
+	const __m128d tNearFarZ = _mm_mul_pd(_mm_sub_pd(nearFarZ, positionZZ), inverseDirectionZZ);
+
+	// The running value is passed as the second argument, which is returned when the first is a NaN
+	// (as happens when the ray lies in the plane of a slab it is parallel to)
+	__m128d entry = _mm_max_sd(_mm_unpackhi_pd(tNearXY, tNearXY), tNearXY);
+	entry = _mm_max_sd(tNearFarZ, entry);
+	__m128d exit = _mm_min_sd(_mm_unpackhi_pd(tFarXY, tFarXY), tFarXY);
+	exit = _mm_min_sd(_mm_unpackhi_pd(tNearFarZ, tNearFarZ), exit);
+	tEntry = _mm_cvtsd_f64(entry);
+	tExit = _mm_cvtsd_f64(exit);
+#else // !SLAB_USE_SSE
+	tEntry = -Infinity, tExit = Infinity;
+	for (int d = 0; d < 3; d++) {
+		const double tNear = (bBox[sign[d]][d] - ray.position[d]) * inverseDirection[d];
+		const double tFar = (bBox[1 - sign[d]][d] - ray.position[d]) * inverseDirection[d];
+		tEntry = tNear > tEntry ? tNear : tEntry;
+		tExit = tFar < tExit ? tFar : tExit;
+	}
+#endif // SLAB_USE_SSE
+	return (tExit >= tEntry) & (tExit > 0);
+}
+
+///////////////////////
+// BoundingBoxPacket //
+///////////////////////
+BoundingBoxPacket::BoundingBoxPacket(void) {
+	for (int lane = 0; lane < Size; lane++) clear(lane);
+}
+
+void BoundingBoxPacket::set(int lane, const BoundingBox3D& bBox) {
+	for (int d = 0; d < 3; d++) _min[d][lane] = RoundDown(bBox[0][d]), _max[d][lane] = RoundUp(bBox[1][d]);
+}
+
+void BoundingBoxPacket::clear(int lane) {
+	// With an inverted, infinite box the entry parameter is always +infinity and the exit parameter -infinity
+	for (int d = 0; d < 3; d++)
+		_min[d][lane] = std::numeric_limits<float>::infinity(), _max[d][lane] = -std::numeric_limits<float>::infinity();
+}
+
+int BoundingBoxPacket::intersect(const SlabRay& ray, float tEntry[Size], float tExit[Size]) const {
+#ifdef SLAB_USE_SSE
+	__m128 entry = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+	__m128 exit = _mm_set1_ps(std::numeric_limits<float>::infinity());
+	const __m128 exitScale = _mm_set1_ps(ExitScale);
+	for (int d = 0; d < 3; d++) {
+		// The ray's direction has the same sign in all lanes, so the sign bit selects which corner holds the near planes
+		const __m128 tNear = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(ray.sign[d] ? _max[d] : _min[d]), ray.position4[d]),
+		                                ray.inverseDirection4[d]);
+		const __m128 tFar = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(ray.sign[d] ? _min[d] : _max[d]), ray.position4[d]),
+		                               ray.inverseDirection4[d]);
+		entry = _mm_max_ps(_mm_sub_ps(tNear, ray.positionSlack4[d]), entry);
+		exit = _mm_min_ps(_mm_mul_ps(_mm_add_ps(tFar, ray.positionSlack4[d]), exitScale), exit);
+	}
+	_mm_storeu_ps(tEntry, entry);
+	_mm_storeu_ps(tExit, exit);
+	const __m128 hit = _mm_and_ps(_mm_cmpge_ps(exit, entry), _mm_cmpgt_ps(exit, _mm_setzero_ps()));
+	return _mm_movemask_ps(hit);
+#else // !SLAB_USE_SSE
+	int mask = 0;
+	for (int lane = 0; lane < Size; lane++) {
+		float entry = -std::numeric_limits<float>::infinity(), exit = std::numeric_limits<float>::infinity();
+		for (int d = 0; d < 3; d++) {
+			const float position = static_cast<float>(ray.ray.position[d]);
+			const float inverseDirection = static_cast<float>(ray.inverseDirection[d]);
+			const float tNear = ((ray.sign[d] ? _max[d][lane] : _min[d][lane]) - position) * inverseDirection - ray.positionSlack[d];
+			const float tFar = (((ray.sign[d] ? _min[d][lane] : _max[d][lane]) - position) * inverseDirection + ray.positionSlack[d]) * ExitScale;
+			entry = tNear > entry ? tNear : entry;
+			exit = tFar < exit ? tFar : exit;
+		}
+		tEntry[lane] = entry, tExit[lane] = exit;
+		mask |= (exit >= entry && exit > 0) ? (1 << lane) : 0;
+	}
+	return mask;
+#endif // SLAB_USE_SSE
+}
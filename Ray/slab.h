@@ -0,0 +1,71 @@
+#ifndef SLAB_INCLUDED
+#define SLAB_INCLUDED
+
+#include <Util/geometry.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLAB_USE_SSE
+#include <emmintrin.h>
+#endif // __SSE2__ || _M_X64 || _M_IX86_FP
+
+namespace Ray {
+	/** This class represents a ray prepared for slab tests against axis-aligned boxes.
+	*** In addition to the ray, it stores the reciprocals of the direction's coordinates and, for each axis, whether the direction is negative,
+	*** so that the near and far planes of a box's slab can be selected without comparisons. */
+	struct SlabRay {
+		/** The ray */
+		Util::Ray3D ray;
+
+		/** The reciprocals of the coordinates of the ray's direction (infinite along axes the ray is parallel to) */
+		Util::Point3D inverseDirection;
+
+		/** For each axis, one if the direction's coordinate is negative and zero otherwise */
+		int sign[3];
+
+		/** For each axis, a bound on the change in the parameter of a plane crossing caused by rounding the position's coordinate to single precision,
+		*** used to widen the single-precision slabs (this is an absolute error, growing with the magnitude of the position) */
+		float positionSlack[3];
+
+#ifdef SLAB_USE_SSE
+		/** The position and inverse direction, packed as (x,y) and (z,z) pairs for the double-precision single-box test */
+		__m128d positionXY, positionZZ, inverseDirectionXY, inverseDirectionZZ;
+
+		/** The position and inverse direction coordinates, and the slack, broadcast across four single-precision lanes for the four-box test */
+		__m128 position4[3], inverseDirection4[3], positionSlack4[3];
+#endif // SLAB_USE_SSE
+
+		/** The constructor precomputes the inverse direction and sign bits of the ray */
+		SlabRay(const Util::Ray3D& ray);
+
+		/** This method intersects the ray with the box, returning true if the box is hit in front of the ray's position.
+		*** On return, tEntry and tExit hold the parameters at which the ray enters and exits the box. (The entry is negative if the position is inside.) */
+		bool intersect(const Util::BoundingBox3D& bBox, double& tEntry, double& tExit) const;
+	};
+
+	/** This class stores four axis-aligned boxes in structure-of-arrays layout, so that a ray can be tested against all of them at once.
+	*** The boxes are stored in single precision, with their bounds rounded outwards, and lanes without a box never report a hit. */
+	class BoundingBoxPacket {
+		/** The minimum and maximum corners of the boxes, indexed by axis and then by lane */
+		float _min[3][4], _max[3][4];
+
+	public:
+		/** The number of boxes in a packet */
+		static const int Size = 4;
+
+		/** The default constructor creates a packet with no boxes */
+		BoundingBoxPacket(void);
+
+		/** This method sets the box in the prescribed lane */
+		void set(int lane, const Util::BoundingBox3D& bBox);
+
+		/** This method clears the box in the prescribed lane, so that it is never hit */
+		void clear(int lane);
+
+		/** This method intersects the ray with the boxes, returning a bit-mask of the lanes whose box is hit in front of the ray's position.
+		*** On return, tEntry[i] and tExit[i] hold the parameters at which the ray enters and exits the box in the i-th lane.
+		*** The slabs are widened by the error in the rounded position, and the exit parameters are scaled up slightly to absorb the rounding of the arithmetic,
+		*** so the test may report near misses as hits. */
+		int intersect(const SlabRay& ray, float tEntry[Size], float tExit[Size]) const;
+	};
+}
+#endif // SLAB_INCLUDED
@@ -0,0 +1,104 @@
+#include <cmath>
+#include <algorithm>
+#include "spanList.h"
+
+using namespace Ray;
+using namespace Util;
+
+namespace {
+	bool UnionOp(bool inside1, bool inside2) { return inside1 || inside2; }
+	bool IntersectionOp(bool inside1, bool inside2) { return inside1 && inside2; }
+	bool DifferenceOp(bool inside1, bool inside2) { return inside1 && !inside2; }
+
+	/** This function returns the i-th boundary of the span list, with even indices the entries and odd indices the exits */
+	const SpanBoundary& Boundary(const std::vector<Span>& spans, size_t i) {
+		return (i & 1) ? spans[i >> 1].exit : spans[i >> 1].entry;
+	}
+}
+
+//////////////
+// SpanList //
+//////////////
+thread_local std::vector<std::unique_ptr<SpanList>> SpanList::_Pool;
+thread_local size_t SpanList::_PoolInUse = 0;
+
+bool SpanList::Clip(const ShapeBoundingBox& bBox, const Ray3D& ray, BoundingBox1D& range) {
+	double tEntry, tExit;
+	if (!bBox.intersect(SlabRay(ray), tEntry, tExit)) return false;
+	range[0][0] = std::max<double>(range[0][0], tEntry);
+	range[1][0] = std::min<double>(range[1][0], tExit);
+	return range[0][0] <= range[1][0];
+}
+
+bool SpanList::clip(BoundingBox1D& range) const {
+	if (spans.empty()) return false;
+	const double tStart = spans.front().entry.t, tEnd = spans.back().exit.t;
+	range[0][0] = std::max<double>(range[0][0], tStart - Epsilon * std::max<double>(1., fabs(tStart)));
+	range[1][0] = std::min<double>(range[1][0], tEnd + Epsilon * std::max<double>(1., fabs(tEnd)));
+	return true;
+}
+
+const SpanBoundary* SpanList::first(double tMin, std::function<bool (double)> validityLambda) const {
+	for (const Span& span : spans) {
+		if (span.entry.onSurface && span.entry.t >= tMin && validityLambda(span.entry.t)) return &span.entry;
+		if (span.exit.onSurface && span.exit.t >= tMin && validityLambda(span.exit.t)) return &span.exit;
+	}
+	return nullptr;
+}
+
+void SpanList::_Combine(const SpanList& spans1, const SpanList& spans2, SpanList& out, bool (*op)(bool, bool),
+                        bool flipSecond) {
+	out.clear();
+	const size_t n1 = 2 * spans1.spans.size(), n2 = 2 * spans2.spans.size();
+	size_t i1 = 0, i2 = 0;
+	bool inside1 = false, inside2 = false, inside = false;
+
+	// Sweep through the boundaries of both lists in order, emitting a boundary whenever the ray enters or leaves the result
+	while (i1 < n1 || i2 < n2) {
+		const SpanBoundary* boundary;
+		bool fromSecond;
+		if (i2 == n2 || (i1 < n1 && Boundary(spans1.spans, i1).t <= Boundary(spans2.spans, i2).t)) {
+			boundary = &Boundary(spans1.spans, i1);
+			inside1 = !(i1++ & 1);
+			fromSecond = false;
+		}
+		else {
+			boundary = &Boundary(spans2.spans, i2);
+			inside2 = !(i2++ & 1);
+			fromSecond = true;
+		}
+
+		const bool wasInside = inside;
+		inside = op(inside1, inside2);
+		if (inside == wasInside) continue;
+		if (inside) out.spans.emplace_back(), out.spans.back().entry = *boundary;
+		else out.spans.back().exit = *boundary;
+		if (fromSecond && flipSecond) {
+			SpanBoundary& b = inside ? out.spans.back().entry : out.spans.back().exit;
+			b.iInfo.normal = -b.iInfo.normal;
+		}
+	}
+}
+
+void SpanList::Union(const SpanList& spans1, const SpanList& spans2, SpanList& out) {
+	_Combine(spans1, spans2, out, UnionOp, false);
+}
+
+void SpanList::Intersection(const SpanList& spans1, const SpanList& spans2, SpanList& out) {
+	_Combine(spans1, spans2, out, IntersectionOp, false);
+}
+
+void SpanList::Difference(const SpanList& spans1, const SpanList& spans2, SpanList& out) {
+	_Combine(spans1, spans2, out, DifferenceOp, true);
+}
+
+//////////////////////
+// SpanList::Buffer //
+//////////////////////
+SpanList::Buffer::Buffer(void) {
+	if (_PoolInUse == _Pool.size()) _Pool.emplace_back(new SpanList());
+	_spans = _Pool[_PoolInUse++].get();
+	_spans->clear();
+}
+
+SpanList::Buffer::~Buffer(void) { _PoolInUse--; }
@@ -0,0 +1,86 @@
+#ifndef SPAN_LIST_INCLUDED
+#define SPAN_LIST_INCLUDED
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <Util/geometry.h>
+#include "scene.h"
+
+namespace Ray {
+	/** This class represents an end-point of a span, where the ray enters or leaves a solid */
+	struct SpanBoundary {
+		/** The parameter along the ray */
+		double t;
+
+		/** Whether the boundary lies on the surface of the solid, as opposed to where the span was clipped to the range of the ray */
+		bool onSurface;
+
+		/** The intersection information, set if the boundary lies on the surface */
+		RayShapeIntersectionInfo iInfo;
+	};
+
+	/** This class represents an interval along the ray over which the ray is inside a solid */
+	struct Span {
+		/** The boundaries at which the ray enters and exits */
+		SpanBoundary entry, exit;
+	};
+
+	/** This class stores the sorted, disjoint spans along a ray over which the ray is inside a solid.
+	*** Span lists are combined with the set operations to evaluate constructive solid geometry. */
+	class SpanList {
+		/** The span lists allocated by each thread, reused from ray to ray */
+		static thread_local std::vector<std::unique_ptr<SpanList>> _Pool;
+
+		/** The number of the calling thread's span lists that are currently in use */
+		static thread_local size_t _PoolInUse;
+
+		/** This function combines two span lists into the output, with the ray inside the result wherever the operator returns true.
+		*** If flipSecond is set, the normals of the boundaries taken from the second list are reversed. */
+		static void _Combine(const SpanList& spans1, const SpanList& spans2, SpanList& out, bool (*op)(bool, bool),
+		                     bool flipSecond);
+
+	public:
+		/** The spans, sorted along the ray */
+		std::vector<Span> spans;
+
+		/** This method removes all spans (keeping the allocated memory) */
+		void clear(void) { spans.clear(); }
+
+		/** This method returns true if there are no spans */
+		bool empty(void) const { return spans.empty(); }
+
+		/** This function clips the range to the parameters over which the ray is inside the bounding box, returning false if nothing is left */
+		static bool Clip(const ShapeBoundingBox& bBox, const Util::Ray3D& ray, Util::BoundingBox1D& range);
+
+		/** This method clips the range to the extent of the spans, returning false if there are no spans.
+		*** The extent is padded slightly, so that boundaries introduced by clipping another solid to it do not coincide with the spans' own. */
+		bool clip(Util::BoundingBox1D& range) const;
+
+		/** This method returns the first boundary on the surface that is no closer than tMin and for which the validity lambda is true.
+		*** If there is no such boundary, nullptr is returned. */
+		const SpanBoundary* first(double tMin, std::function<bool (double)> validityLambda) const;
+
+		/** These functions set the output to the union, intersection, and difference of the two span lists.
+		*** The output must not be one of the inputs. */
+		static void Union(const SpanList& spans1, const SpanList& spans2, SpanList& out);
+		static void Intersection(const SpanList& spans1, const SpanList& spans2, SpanList& out);
+		static void Difference(const SpanList& spans1, const SpanList& spans2, SpanList& out);
+
+		/** This class provides a cleared span list from the calling thread's pool, returning it to the pool when it goes out of scope.
+		*** Buffers must be released in the reverse order in which they were acquired, as happens with scoped objects. */
+		class Buffer {
+			SpanList* _spans;
+
+		public:
+			Buffer(void);
+			~Buffer(void);
+			Buffer(const Buffer&) = delete;
+			Buffer& operator=(const Buffer&) = delete;
+
+			SpanList& operator*(void) { return *_spans; }
+			SpanList* operator->(void) { return _spans; }
+		};
+	};
+}
+#endif // SPAN_LIST_INCLUDED
@@ -2,6 +2,7 @@
 #include <Util/exceptions.h>
 #include "sphere.h"
 #include "scene.h"
+#include "transformFlattener.h"
 
 using namespace Ray;
 using namespace Util;
@@ -9,7 +10,7 @@ using namespace Util;
 ////////////
 // Sphere //
 ////////////
-Sphere::Sphere( void ) : radius(0) , _material(NULL) , _elementBufferID(0) , _vertexBufferID(0) {}
+Sphere::Sphere( void ) : radius(0) , _material(NULL) {}
 
 void Sphere::_read( std::istream &stream )
 {
@@ -23,3 +24,18 @@ void Sphere::_write( std::ostream &stream ) const
 }
 
 size_t Sphere::primitiveNum( void ) const { return 1; }
+
+Shape *Sphere::flatten( TransformFlattener &flattener )
+{
+	// Only similarities map spheres to spheres
+	double scale;
+	if( !flattener.transformed() ) return this;
+	if( !flattener.isSimilarity( scale ) ) return flattener.wrap( this );
+	Sphere *sphere = flattener.create< Sphere >();
+	sphere->_materialIndex = _materialIndex;
+	sphere->_material = _material;
+	sphere->center = flattener.matrix() * center;
+	sphere->radius = radius * scale;
+	sphere->_initPolynomial();
+	return sphere;
+}
@@ -4,32 +4,30 @@
 #include <Util/polynomial.h>
 #include "shape.h"
 #include "triangle.h"
+#include "tessellation.h"
 
 namespace Ray {
 	/** This class describes a sphere, and is represented by its center and radius. */
 	class Sphere : public Shape {
-		/** The OpenGL vertex buffer identifier */
-		GLuint _vertexBufferID = 0;
-
-		/** The OpenGL element buffer identifier */
-		GLuint _elementBufferID = 0;
-
 		/** The index of the material associated with the box */
 		int _materialIndex;
 
 		/** The material associated with the sphere */
 		const class Material* _material;
 
-		/** The polynomial used to calculate intersection with a ray */
-		Util::Polynomial3D<2> _P;
+		/** The polynomial used to calculate intersection with a ray (arranged for restriction to rays in closed form) */
+		Util::RaySubstitution3D<2> _P;
+
+		/** This method computes the intersection polynomial from the radius */
+		void _initPolynomial(void);
 
 	public:
 		/** The center of the sphere */
 		Util::Point3D center;
 		/** The radius of the sphere */
 		double radius;
-		/** The mesh of the sphere */
-		std::vector<Triangle> mesh;
+		/** The mesh of the sphere, about its center, shared by all spheres with the same dimensions */
+		std::shared_ptr<const TessellatedMesh> mesh;
 
 		/** This static method returns the directive describing the shape. */
 		static std::string Directive(void) { return "shape_sphere"; }
@@ -54,6 +52,7 @@ namespace Ray {
 		bool isInside(Util::Point3D p) const override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		Shape* flatten(class TransformFlattener& flattener) override;
 	};
 }
 #endif // SPHERE_INCLUDED
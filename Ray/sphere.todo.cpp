@@ -19,6 +19,10 @@ void Sphere::init(const LocalSceneData& data) {
 		THROW("material index out of bounds: %d <= %d", _materialIndex, static_cast<int>(data.materials.size()));
 	else _material = &data.materials[_materialIndex];
 
+	_initPolynomial();
+}
+
+void Sphere::_initPolynomial(void) {
 	// Calculate intersection polynomial
 	Polynomial3D<2> P;
 	P.coefficient(2u, 0u, 0u) = P.coefficient(0u, 2u, 0u) = P.coefficient(0u, 0u, 2u) = 1;
@@ -39,59 +43,48 @@ void Sphere::initOpenGL(void) {
 	// Do OpenGL set-up here //
 	///////////////////////////
 	// adapted from http://www.songho.ca/opengl/gl_sphere.html
-	const int stack_count = OpenGLTessellationComplexity;
-	const int sector_count = 2 * stack_count;
-	const double stack_step = Pi / stack_count;
-	const double sector_step = 2 * Pi / sector_count;
-	const double inverse_radius = 1. / radius;
-	// generate vertices
-	std::vector<Vertex*> vertices;
-	for (int i = 0; i <= stack_count; i++) {
-		const double stack_angle = Pi / 2 - i * stack_step;
-		const double xy = radius * cos(stack_angle);
-		const double z = sin(stack_angle);
+	const double radius = this->radius;
+	mesh = TessellationCache::Get(Directive(), {radius}, OpenGLTessellationComplexity, [radius](TessellatedMesh& m) {
+		const int stack_count = OpenGLTessellationComplexity;
+		const int sector_count = 2 * stack_count;
+		const double stack_step = Pi / stack_count;
+		const double sector_step = 2 * Pi / sector_count;
+		// generate vertices
+		for (int i = 0; i <= stack_count; i++) {
+			const double stack_angle = Pi / 2 - i * stack_step;
+			const double xy = cos(stack_angle);
+			const double z = sin(stack_angle);
 
-		// generate a vertical band of vertices around the sphere
-		for (int j = 0; j <= sector_count; j++) {
-			const double sector_angle = j * sector_step;
-			// find vertex position by implicit formula
-			const double x = xy * cos(sector_angle);
-			const double y = xy * sin(sector_angle);
-			// normalize vertex normals
-			const double n_x = x * inverse_radius;
-			const double n_y = y * inverse_radius;
-			const double n_z = z * inverse_radius;
-			// map texture coordinate between [0, 1]
-			const double u = static_cast<double>(j) / sector_count;
-			const double v = static_cast<double>(i) / sector_count;
-			// add vertex
-			const Point3D position(x, y, z);
-			const Point3D normal(n_x, n_y, n_z);
-			const Point2D texCoordinate(u, v);
-			auto vertex = new Vertex();
-			vertex->position = position;
-			vertex->normal = normal;
-			vertex->texCoordinate = texCoordinate;
-			vertices.push_back(vertex);
+			// generate a vertical band of vertices around the sphere
+			for (int j = 0; j <= sector_count; j++) {
+				const double sector_angle = j * sector_step;
+				// the unit normal, scaled by the radius, gives the position
+				const Point3D normal(xy * cos(sector_angle), xy * sin(sector_angle), z);
+				// map texture coordinate between [0, 1]
+				const double u = static_cast<double>(j) / sector_count;
+				const double v = static_cast<double>(i) / stack_count;
+				m.addVertex(normal * radius, normal, Point2D(u, v));
+			}
 		}
-	}
-	// generate CCW index list of triangles for each quad we formed with stacks and sectors
-	// k1--k1+1
-	// |  / |
-	// | /  |
-	// k2--k2+1
-	// we visit indices k1 -> k2 -> k1+1
-	// then indices k1+1 -> k2 -> k2+1
-	for (int i = 0; i < stack_count; i++) {
-		int k1 = i * (sector_count + 1);
-		int k2 = k1 + sector_count + 1;
-		for (int j = 0; j < sector_count; j++, k1++, k2++) {
-			// visit k1 -> k2 -> k1+1
-			if (i) mesh.emplace_back(vertices[k1], vertices[k2], vertices[k1 + 1]);
-			// visit k1+1 -> k2 -> k2+1
-			if (i != (stack_count - 1)) mesh.emplace_back(vertices[k1 + 1], vertices[k2], vertices[k2 + 1]);
+		// generate CCW index list of triangles for each quad we formed with stacks and sectors
+		// k1--k1+1
+		// |  / |
+		// | /  |
+		// k2--k2+1
+		// we visit indices k1 -> k2 -> k1+1
+		// then indices k1+1 -> k2 -> k2+1
+		for (int i = 0; i < stack_count; i++) {
+			int k1 = i * (sector_count + 1);
+			int k2 = k1 + sector_count + 1;
+			for (int j = 0; j < sector_count; j++, k1++, k2++) {
+				// visit k1 -> k2 -> k1+1
+				if (i) m.triangles.emplace_back(k1, k2, k1 + 1);
+				// visit k1+1 -> k2 -> k2+1
+				if (i != (stack_count - 1)) m.triangles.emplace_back(k1 + 1, k2, k2 + 1);
+			}
 		}
-	}
+	});
+	mesh->initOpenGL();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -103,18 +96,17 @@ double Sphere::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingBox
 	/////////////////////////////////////////////////////////
 	// Compute the intersection of the sphere with the ray //
 	/////////////////////////////////////////////////////////
-	const Polynomial1D<2> p = _P(ray);
+	// the polynomial describes the sphere about the origin, so the ray is expressed relative to the center
+	const Polynomial1D<2> p = _P(Ray3D(ray.position - center, ray.direction));
 	double roots[2];
 	const unsigned int root_num = p.roots(roots);
 	if (!root_num) return Infinity;
-	// get smallest positive root
-	double root;
-	if (root_num == 2) {
-		if (roots[0] > 0 && roots[1] > 0) root = std::min(roots[0], roots[1]);
-		else root = roots[(roots[0] > 0 ? 0 : 1)];
-	}
-	else root = roots[0];
-	if (!range.isInside(root)) return Infinity;
+	// get the smallest root within the range
+	if (root_num == 2 && roots[1] < roots[0]) std::swap(roots[0], roots[1]);
+	double root = Infinity;
+	for (unsigned int i = 0; i < root_num && isinf(root); i++)
+		if (range.isInside(roots[i])) root = roots[i];
+	if (isinf(root)) return Infinity;
 	iInfo.position = ray(root);
 	iInfo.normal = (iInfo.position - center).unit();
 	iInfo.material = _material;
@@ -126,8 +118,7 @@ bool Sphere::isInside(Point3D p) const {
 	//////////////////////////////////////////////////////
 	// Determine if the point is inside the sphere here //
 	//////////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	return (p - center).squareNorm() < radius * radius;
 }
 
 void Sphere::drawOpenGL(GLSLProgram* glslProgram) const {
@@ -136,10 +127,8 @@ void Sphere::drawOpenGL(GLSLProgram* glslProgram) const {
 	//////////////////////////////
 	_material->drawOpenGL(glslProgram);
 	glPushMatrix();
-	glTranslatef(center[0], center[1], center[2]);
-	GLUquadric* q = gluNewQuadric();
-	gluSphere(q, radius, 2 * OpenGLTessellationComplexity, OpenGLTessellationComplexity);
-	gluDeleteQuadric(q);
+	glTranslated(center[0], center[1], center[2]);
+	mesh->drawOpenGL();
 	glPopMatrix();
 
 	// Sanity check to make sure that OpenGL state is good
@@ -12,6 +12,14 @@ using namespace Util;
 /////////////////
 // SphereLight //
 /////////////////
+bool SphereLight::Adaptive = false;
+unsigned int SphereLight::InitialSamples = 8;
+size_t SphereLight::SampleBudget = 0;
+thread_local double SphereLight::_RemainingSamples = 0;
+
+void SphereLight::StartTileSampleBudget( void ){ _RemainingSamples = 0; }
+
+void SphereLight::AddSampleBudget( size_t pixelNum , size_t imagePixelNum ){ if( imagePixelNum ) _RemainingSamples += (double)SampleBudget * pixelNum / imagePixelNum; }
 
 void SphereLight::_read( std::istream &stream )
 {
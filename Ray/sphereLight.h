@@ -1,5 +1,6 @@
 #ifndef SPHERE_LIGHT_INCLUDED
 #define SPHERE_LIGHT_INCLUDED
+#include <random>
 #include "pointLight.h"
 
 namespace Ray
@@ -10,11 +11,35 @@ namespace Ray
 	*/
 	class SphereLight : public PointLight
 	{
+		/** The number of samples, beyond the initial batches, that the calling thread can still take in the tile it is tracing */
+		static thread_local double _RemainingSamples;
+
+		/** This method casts a shadow ray towards a random point on the light and returns the transparency along it */
+		Util::Point3D _sample( const class RayShapeIntersectionInfo &iInfo , const class Shape &shape , Util::Point3D cLimit , std::default_random_engine &gen ) const;
 	protected:
 		/** The radius of the area-light */
 		double _radius;
 
 	public:
+		/** When set, the transparency is estimated adaptively: an initial batch of samples is taken and, only if the samples disagree
+		* (i.e. the point is in the penumbra), the remaining samples are taken. */
+		static bool Adaptive;
+
+		/** The number of samples in the initial batch of an adaptive estimate */
+		static unsigned int InitialSamples;
+
+		/** The number of samples, beyond the initial batches, that adaptive estimates can take over the course of a frame (zero for no limit).
+		* The budget is shared out evenly over the image: each row of a tile adds its share of the frame's pixels to the tracing thread's allowance,
+		* which carries over from row to row within the tile. Once the allowance is spent, points in the penumbra are only sampled with the initial batch.
+		* Since the shares only depend on the image size, the total is the same however the frame is split into tiles, threads, or processes. */
+		static size_t SampleBudget;
+
+		/** This static method clears the calling thread's allowance, and should be called at the start of every tile */
+		static void StartTileSampleBudget( void );
+
+		/** This static method adds the share of the budget for the prescribed number of pixels of an image with the prescribed number of pixels to the calling thread's allowance */
+		static void AddSampleBudget( size_t pixelNum , size_t imagePixelNum );
+
 		/** This static method returns the directive describing the Light. */
 		static std::string Directive( void ){ return "light_sphere"; }
 
@@ -1,5 +1,6 @@
 #include <cmath>
 #include <random>
+#include <algorithm>
 #include <Util/exceptions.h>
 #include "scene.h"
 #include "sphereLight.h"
@@ -10,29 +11,54 @@ using namespace Util;
 /////////////////
 // SphereLight //
 /////////////////
+Point3D SphereLight::_sample(const RayShapeIntersectionInfo& iInfo, const Shape& shape, Point3D cLimit,
+                             std::default_random_engine& gen) const {
+	// Normally distributed numbers will end up uniformly distributed once the vector is normalized
+	// See http://corysimon.github.io/articles/uniformdistn-on-sphere/
+	std::normal_distribution dist(0.0, 1.0);
+	Point3D sample_location = _location + Point3D(dist(gen), dist(gen), dist(gen)).unit() * _radius;
+	const Point3D dirTowardsLight = (sample_location - iInfo.position).unit();
+	Ray3D ray(iInfo.position + dirTowardsLight * Epsilon, dirTowardsLight);
+	RayShapeIntersectionInfo occlusionInfo;
+	const BoundingBox1D range(Point1D(Epsilon), Point1D((sample_location - iInfo.position).length()));
+	Point3D shadow_sample(1., 1., 1.);
+	while (!isinf(shape.intersect(ray, occlusionInfo, range)) &&
+		(shadow_sample[0] > cLimit[0] && shadow_sample[1] > cLimit[1] && shadow_sample[2] > cLimit[2])) {
+		shadow_sample *= occlusionInfo.material->transparent;
+		ray = Ray3D(occlusionInfo.position + dirTowardsLight * Epsilon, dirTowardsLight);
+	}
+	return shadow_sample;
+}
+
 Point3D SphereLight::transparency(const RayShapeIntersectionInfo& iInfo, const Shape& shape, Point3D cLimit,
                                   unsigned int samples) const {
 	//////////////////////////////////////////////////////////
 	// Compute the transparency along the path to the light //
 	//////////////////////////////////////////////////////////
-	// Normally distributed numbers will end up uniformly distributed once the vector is normalized
-	// See http://corysimon.github.io/articles/uniformdistn-on-sphere/
 	std::default_random_engine gen(std::random_device{}());
-	std::normal_distribution dist(0.0, 1.0);
-	Point3D shadow_sum;
-	for (unsigned int i = 0; i < samples; i++) {
-		Point3D sample_location = _location + Point3D(dist(gen), dist(gen), dist(gen)).unit() * _radius;
-		const Point3D dirTowardsLight = (sample_location - iInfo.position).unit();
-		Ray3D ray(iInfo.position + dirTowardsLight * Epsilon, dirTowardsLight);
-		RayShapeIntersectionInfo occlusionInfo;
-		const BoundingBox1D range(Point1D(Epsilon), Point1D((sample_location - iInfo.position).length()));
-		Point3D shadow_sample(1., 1., 1.);
-		while (!isinf(shape.intersect(ray, occlusionInfo, range)) &&
-			(shadow_sample[0] > cLimit[0] && shadow_sample[1] > cLimit[1] && shadow_sample[2] > cLimit[2])) {
-			shadow_sample *= occlusionInfo.material->transparent;
-			ray = Ray3D(occlusionInfo.position + dirTowardsLight * Epsilon, dirTowardsLight);
-		}
-		shadow_sum = shadow_sum + shadow_sample;
+	if (!Adaptive || InitialSamples < 2 || samples <= InitialSamples) {
+		Point3D shadow_sum;
+		for (unsigned int i = 0; i < samples; i++) shadow_sum += _sample(iInfo, shape, cLimit, gen);
+		return shadow_sum / samples;
+	}
+
+	// Take the initial batch, and stop if the samples agree (i.e. the point is either fully lit or fully occluded)
+	Point3D first = _sample(iInfo, shape, cLimit, gen), shadow_sum = first;
+	bool agree = true;
+	for (unsigned int i = 1; i < InitialSamples; i++) {
+		const Point3D shadow_sample = _sample(iInfo, shape, cLimit, gen);
+		agree &= (shadow_sample - first).squareNorm() <= Epsilon * Epsilon;
+		shadow_sum += shadow_sample;
+	}
+	if (agree) return shadow_sum / InitialSamples;
+
+	// Otherwise, take the remaining samples, as far as the tile's allowance allows
+	const unsigned int wanted = samples - InitialSamples;
+	unsigned int extra = wanted;
+	if (SampleBudget) {
+		extra = static_cast<unsigned int>(std::clamp<double>(std::floor(_RemainingSamples), 0, wanted));
+		_RemainingSamples -= extra;
 	}
-	return shadow_sum / samples;
+	for (unsigned int i = 0; i < extra; i++) shadow_sum += _sample(iInfo, shape, cLimit, gen);
+	return shadow_sum / (InitialSamples + extra);
 }
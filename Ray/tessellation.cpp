@@ -0,0 +1,129 @@
+#include <tuple>
+#include "tessellation.h"
+
+using namespace Ray;
+using namespace Util;
+
+/////////////////////
+// TessellatedMesh //
+/////////////////////
+TessellatedMesh::~TessellatedMesh(void) {
+	if (_vertexBufferID) {
+		glDeleteBuffers(1, &_vertexBufferID);
+		MemoryStats::RemoveGLBufferBytes(positions.size() * 8 * sizeof(GLfloat));
+	}
+	if (_elementBufferID) {
+		glDeleteBuffers(1, &_elementBufferID);
+		MemoryStats::RemoveGLBufferBytes(triangles.size() * sizeof(GLuint) * 3);
+	}
+}
+
+unsigned int TessellatedMesh::addVertex(Point3D position, Point3D normal, Point2D texCoordinate) {
+	positions.push_back(position);
+	normals.push_back(normal);
+	texCoordinates.push_back(texCoordinate);
+	return static_cast<unsigned int>(positions.size() - 1);
+}
+
+size_t TessellatedMesh::memoryUsage(void) const {
+	return positions.size() * sizeof(Point3D) + normals.size() * sizeof(Point3D) + texCoordinates.size() * sizeof(Point2D) +
+		triangles.size() * sizeof(TriangleIndex);
+}
+
+void TessellatedMesh::initOpenGL(void) const {
+	if (_vertexBufferID)
+		return;
+
+	// Interleave the positions, normals, and texture coordinates
+	std::vector<GLfloat> vertexData(positions.size() * 8);
+	for (size_t i = 0; i < positions.size(); i++) {
+		GLfloat* v = &vertexData[8 * i];
+		for (int j = 0; j < 3; j++) v[j] = static_cast<GLfloat>(positions[i][j]);
+		for (int j = 0; j < 3; j++) v[3 + j] = static_cast<GLfloat>(normals[i][j]);
+		for (int j = 0; j < 2; j++) v[6 + j] = static_cast<GLfloat>(texCoordinates[i][j]);
+	}
+
+	glGenBuffers(1, &_vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(GLfloat), vertexData.data(), GL_STATIC_DRAW);
+	MemoryStats::AddGLBufferBytes(vertexData.size() * sizeof(GLfloat));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &_elementBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangles.size() * sizeof(GLuint) * 3, triangles.data(), GL_STATIC_DRAW);
+	MemoryStats::AddGLBufferBytes(triangles.size() * sizeof(GLuint) * 3);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// Sanity check to make sure that OpenGL state is good
+	ASSERT_OPEN_GL_STATE();
+}
+
+void TessellatedMesh::drawOpenGL(void) const {
+	const GLsizei stride = 8 * sizeof(GLfloat);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBufferID);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(3, GL_FLOAT, stride, reinterpret_cast<const void*>(0));
+	glNormalPointer(GL_FLOAT, stride, reinterpret_cast<const void*>(3 * sizeof(GLfloat)));
+	glTexCoordPointer(2, GL_FLOAT, stride, reinterpret_cast<const void*>(6 * sizeof(GLfloat)));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _elementBufferID);
+	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(3 * triangles.size()), GL_UNSIGNED_INT, nullptr);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	// Sanity check to make sure that OpenGL state is good
+	ASSERT_OPEN_GL_STATE();
+}
+
+///////////////////////
+// TessellationCache //
+///////////////////////
+std::map<TessellationCache::_Key, std::shared_ptr<const TessellatedMesh>> TessellationCache::_Meshes;
+std::mutex TessellationCache::_Mutex;
+
+bool TessellationCache::_Key::operator<(const _Key& key) const {
+	return std::tie(shape, complexity, parameters) < std::tie(key.shape, key.complexity, key.parameters);
+}
+
+std::shared_ptr<const TessellatedMesh> TessellationCache::Get(const std::string& shape,
+                                                               const std::vector<double>& parameters,
+                                                               unsigned int complexity,
+                                                               std::function<void (TessellatedMesh&)> tessellate) {
+	_Key key;
+	key.shape = shape, key.parameters = parameters, key.complexity = complexity;
+
+	std::lock_guard<std::mutex> lock(_Mutex);
+	auto iter = _Meshes.find(key);
+	if (iter != _Meshes.end())
+		return iter->second;
+
+	std::shared_ptr<TessellatedMesh> mesh = std::make_shared<TessellatedMesh>();
+	tessellate(*mesh);
+	_Meshes[key] = mesh;
+	return mesh;
+}
+
+size_t TessellationCache::Size(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	return _Meshes.size();
+}
+
+size_t TessellationCache::MemoryUsage(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	size_t size = 0;
+	for (const auto& mesh : _Meshes)
+		size += mesh.second->memoryUsage();
+	return size;
+}
+
+void TessellationCache::Clear(void) {
+	std::lock_guard<std::mutex> lock(_Mutex);
+	_Meshes.clear();
+}
@@ -0,0 +1,95 @@
+#ifndef TESSELLATION_INCLUDED
+#define TESSELLATION_INCLUDED
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
+#include <Util/geometry.h>
+#include "shape.h"
+#include "triangle.h"
+
+namespace Ray {
+	/** This class represents a triangle mesh approximating a procedural shape, expressed in the shape's local coordinate frame (i.e. about its center).
+	*** Once built, a mesh is immutable and may be shared by all the shapes with the same parameters, together with its OpenGL buffers. */
+	class TessellatedMesh {
+		/** The OpenGL vertex buffer identifier */
+		mutable GLuint _vertexBufferID = 0;
+
+		/** The OpenGL element buffer identifier */
+		mutable GLuint _elementBufferID = 0;
+
+	public:
+		TessellatedMesh(void) = default;
+
+		/** The destructor releases the OpenGL buffers, if they were created */
+		~TessellatedMesh(void);
+
+		TessellatedMesh(const TessellatedMesh&) = delete;
+		TessellatedMesh& operator =(const TessellatedMesh&) = delete;
+
+		/** The vertex positions */
+		std::vector<Util::Point3D> positions;
+
+		/** The vertex normals */
+		std::vector<Util::Point3D> normals;
+
+		/** The vertex texture coordinates */
+		std::vector<Util::Point2D> texCoordinates;
+
+		/** The triangles, indexing the vertices */
+		std::vector<TriangleIndex> triangles;
+
+		/** This method adds a vertex to the mesh and returns its index */
+		unsigned int addVertex(Util::Point3D position, Util::Point3D normal, Util::Point2D texCoordinate = Util::Point2D());
+
+		/** This method returns the number of bytes used to store the mesh */
+		size_t memoryUsage(void) const;
+
+		/** This method creates the OpenGL vertex and element buffers, if they have not been created yet.
+		*** It should only be called once an OpenGL context has been created. */
+		void initOpenGL(void) const;
+
+		/** This method draws the mesh from the OpenGL buffers */
+		void drawOpenGL(void) const;
+	};
+
+	/** This class is a process-wide cache of the meshes tessellating procedural shapes.
+	*** Meshes are keyed on the shape's name, the parameters determining its geometry (other than its position), and the tessellation complexity. */
+	class TessellationCache {
+		/** The key identifying a mesh */
+		struct _Key {
+			std::string shape;
+			std::vector<double> parameters;
+			unsigned int complexity;
+
+			bool operator<(const _Key& key) const;
+		};
+
+		/** The cached meshes */
+		static std::map<_Key, std::shared_ptr<const TessellatedMesh>> _Meshes;
+
+		/** The mutex guarding the cache */
+		static std::mutex _Mutex;
+
+	public:
+		/** This function returns the mesh for the shape with the prescribed parameters and complexity.
+		*** If the mesh is not in the cache, it is built by the tessellation function and added to the cache. */
+		static std::shared_ptr<const TessellatedMesh> Get(const std::string& shape, const std::vector<double>& parameters,
+		                                                  unsigned int complexity,
+		                                                  std::function<void (TessellatedMesh&)> tessellate);
+
+		/** This function returns the number of cached meshes */
+		static size_t Size(void);
+
+		/** This function returns the number of bytes used by the cached meshes */
+		static size_t MemoryUsage(void);
+
+		/** This function removes all meshes from the cache (meshes still in use by shapes remain valid).
+		*** The OpenGL buffers of a mesh are released once the last shape using it is gone. */
+		static void Clear(void);
+	};
+}
+#endif // TESSELLATION_INCLUDED
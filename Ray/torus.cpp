@@ -10,7 +10,7 @@ using namespace Util;
 // Torus //
 ///////////
 
-Torus::Torus( void ) : iRadius(0) , oRadius(0) , _material(NULL) , _elementBufferID(0) , _vertexBufferID(0) {}
+Torus::Torus( void ) : iRadius(0) , oRadius(0) , _material(NULL) {}
 
 void Torus::_read( std::istream &stream )
 {
@@ -4,16 +4,11 @@
 #include <Util/polynomial.h>
 #include "shape.h"
 #include "triangle.h"
+#include "tessellation.h"
 
 namespace Ray {
 	/** This class describes a torus, and is represented by its center and two radii */
 	class Torus : public Shape {
-		/** The OpenGL vertex buffer identifier */
-		GLuint _vertexBufferID = 0;
-
-		/** The OpenGL element buffer identifier */
-		GLuint _elementBufferID = 0;
-
 		/** The index of the material associated with the box */
 		int _materialIndex;
 
@@ -33,8 +28,8 @@ namespace Ray {
 		/** The outer radius of the torus */
 		double oRadius;
 
-		/** The mesh of the cone */
-		std::vector<Triangle> mesh;
+		/** The mesh of the torus, about its center, shared by all tori with the same dimensions */
+		std::shared_ptr<const TessellatedMesh> mesh;
 
 		/** The default constructor */
 		Torus(void);
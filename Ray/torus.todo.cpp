@@ -43,43 +43,44 @@ void Torus::initOpenGL(void) {
 	// |  / |
 	// | /  |
 	// v2--v4
-	const int complexity = OpenGLTessellationComplexity;
-	for (int i = 0; i < 2 * complexity; i++) {
-		for (int j = 0; j < 2 * complexity; j++) {
-			const double sin_theta = sin(Pi / complexity * i);
-			const double cos_theta = cos(Pi / complexity * i);
-			const double sin_theta_step = sin(Pi / complexity * (i + 1));
-			const double cos_theta_step = cos(Pi / complexity * (i + 1));
-			const double sin_phi = sin(Pi / complexity * j);
-			const double cos_phi = cos(Pi / complexity * j);
-			const double sin_phi_step = sin(Pi / complexity * (j + 1));
-			const double cos_phi_step = cos(Pi / complexity * (j + 1));
-			const double d = (oRadius + iRadius * sin_phi);
-			const double d_step = (oRadius + iRadius * sin_phi_step);
-			const auto v1 = new Vertex();
-			const auto v2 = new Vertex();
-			const auto v3 = new Vertex();
-			const auto v4 = new Vertex();
-			v1->position = center + Point3D(d * cos_theta, iRadius * cos_phi, d * sin_theta);
-			v2->position = center + Point3D(d * cos_theta_step, iRadius * cos_phi, d * sin_theta_step);
-			v3->position = center + Point3D(d_step * cos_theta, iRadius * cos_phi_step, d_step * sin_theta);
-			v4->position = center + Point3D(d_step * cos_theta_step, iRadius * cos_phi_step, d_step * sin_theta_step);
-			v1->normal = Point3D(sin_phi * cos_theta, cos_phi, sin_phi * sin_theta);
-			v2->normal = Point3D(sin_phi * cos_theta_step, cos_phi, sin_phi * sin_theta_step);
-			v3->normal = Point3D(cos_theta * sin_phi_step, cos_phi_step, sin_theta * sin_phi_step);
-			v4->normal = Point3D(cos_theta_step * sin_phi_step, cos_phi_step, sin_theta_step * sin_phi_step);
-			v1->texCoordinate = Point2D(static_cast<double>(i) / (2 * complexity),
-			                            static_cast<double>(j) / (2 * complexity));
-			v2->texCoordinate = Point2D(static_cast<double>(i + 1) / (2 * complexity),
-			                            static_cast<double>(j) / (2 * complexity));
-			v3->texCoordinate = Point2D(static_cast<double>(i) / (2 * complexity),
-			                            static_cast<double>(j + 1) / (2 * complexity));
-			v4->texCoordinate = Point2D(static_cast<double>(i + 1) / (2 * complexity),
-			                            static_cast<double>(j + 1) / (2 * complexity));
-			mesh.emplace_back(v1, v2, v3);
-			mesh.emplace_back(v2, v4, v3);
+	const double iRadius = this->iRadius, oRadius = this->oRadius;
+	mesh = TessellationCache::Get(Directive(), {iRadius, oRadius}, OpenGLTessellationComplexity,
+	                              [iRadius, oRadius](TessellatedMesh& m) {
+		const int complexity = OpenGLTessellationComplexity;
+		for (int i = 0; i < 2 * complexity; i++) {
+			for (int j = 0; j < 2 * complexity; j++) {
+				const double sin_theta = sin(Pi / complexity * i);
+				const double cos_theta = cos(Pi / complexity * i);
+				const double sin_theta_step = sin(Pi / complexity * (i + 1));
+				const double cos_theta_step = cos(Pi / complexity * (i + 1));
+				const double sin_phi = sin(Pi / complexity * j);
+				const double cos_phi = cos(Pi / complexity * j);
+				const double sin_phi_step = sin(Pi / complexity * (j + 1));
+				const double cos_phi_step = cos(Pi / complexity * (j + 1));
+				const double d = (oRadius + iRadius * sin_phi);
+				const double d_step = (oRadius + iRadius * sin_phi_step);
+				const unsigned int v1 = m.addVertex(Point3D(d * cos_theta, iRadius * cos_phi, d * sin_theta),
+				                                    Point3D(sin_phi * cos_theta, cos_phi, sin_phi * sin_theta),
+				                                    Point2D(static_cast<double>(i) / (2 * complexity),
+				                                            static_cast<double>(j) / (2 * complexity)));
+				const unsigned int v2 = m.addVertex(Point3D(d * cos_theta_step, iRadius * cos_phi, d * sin_theta_step),
+				                                    Point3D(sin_phi * cos_theta_step, cos_phi, sin_phi * sin_theta_step),
+				                                    Point2D(static_cast<double>(i + 1) / (2 * complexity),
+				                                            static_cast<double>(j) / (2 * complexity)));
+				const unsigned int v3 = m.addVertex(Point3D(d_step * cos_theta, iRadius * cos_phi_step, d_step * sin_theta),
+				                                    Point3D(cos_theta * sin_phi_step, cos_phi_step, sin_theta * sin_phi_step),
+				                                    Point2D(static_cast<double>(i) / (2 * complexity),
+				                                            static_cast<double>(j + 1) / (2 * complexity)));
+				const unsigned int v4 = m.addVertex(Point3D(d_step * cos_theta_step, iRadius * cos_phi_step, d_step * sin_theta_step),
+				                                    Point3D(cos_theta_step * sin_phi_step, cos_phi_step, sin_theta_step * sin_phi_step),
+				                                    Point2D(static_cast<double>(i + 1) / (2 * complexity),
+				                                            static_cast<double>(j + 1) / (2 * complexity)));
+				m.triangles.emplace_back(v1, v2, v3);
+				m.triangles.emplace_back(v2, v4, v3);
+			}
 		}
-	}
+	});
+	mesh->initOpenGL();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
@@ -99,8 +100,10 @@ bool Torus::isInside(Point3D p) const {
 	////////////////////////////////////////////////////////
 	// Determine if the point is inside the cylinder here //
 	////////////////////////////////////////////////////////
-	THROW("method undefined");
-	return false;
+	// The point is inside if it is within iRadius of the ring of radius oRadius about the y-axis
+	const Point3D q = p - center;
+	const double ringDistance = sqrt(q[0] * q[0] + q[2] * q[2]) - oRadius;
+	return ringDistance * ringDistance + q[1] * q[1] < iRadius * iRadius;
 }
 
 void Torus::drawOpenGL(GLSLProgram* glslProgram) const {
@@ -108,7 +111,10 @@ void Torus::drawOpenGL(GLSLProgram* glslProgram) const {
 	// Do OpenGL rendering here //
 	//////////////////////////////
 	_material->drawOpenGL(glslProgram);
-	for (const auto& triangle : mesh) triangle.drawOpenGL(glslProgram);
+	glPushMatrix();
+	glTranslated(center[0], center[1], center[2]);
+	mesh->drawOpenGL();
+	glPopMatrix();
 	// Sanity check to make sure that OpenGL state is good
 	ASSERT_OPEN_GL_STATE();
 }
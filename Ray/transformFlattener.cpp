@@ -0,0 +1,70 @@
+#include <cmath>
+#include <Util/exceptions.h>
+#include "transformFlattener.h"
+
+using namespace Ray;
+using namespace Util;
+
+////////////////////////
+// TransformFlattener //
+////////////////////////
+const double TransformFlattener::SimilarityTolerance = 1e-6;
+
+TransformFlattener::TransformFlattener(void) : _frameNum(0), _fileDepth(0) {}
+
+void TransformFlattener::push(const Matrix4D& m) {
+	_Frame frame;
+	frame.matrix = transformed() ? _frames.back().matrix * m : m;
+	frame.normalMatrix = Matrix3D(frame.matrix.inverse().transpose());
+	frame.id = _frameNum++;
+	_frames.push_back(frame);
+}
+
+void TransformFlattener::pop(void) {
+	if (_frames.empty())
+		THROW("no transformation to pop");
+	_frames.pop_back();
+}
+
+Matrix4D TransformFlattener::matrix(void) const { return transformed() ? _frames.back().matrix : Matrix4D::Identity(); }
+
+bool TransformFlattener::isSimilarity(double& scale) const {
+	// The linear part is a similarity if its columns are orthogonal and of equal length
+	const Matrix3D linear(matrix());
+	const Matrix3D gram = linear.transpose() * linear;
+	const double squareScale = (gram(0, 0) + gram(1, 1) + gram(2, 2)) / 3;
+	if (squareScale <= 0) return false;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++)
+			if (fabs(gram(i, j) - (i == j ? squareScale : 0.)) > SimilarityTolerance * squareScale) return false;
+	scale = sqrt(squareScale);
+	return true;
+}
+
+const Vertex* TransformFlattener::vertex(const Vertex* v) {
+	if (!transformed()) return v;
+	const _Frame& frame = _frames.back();
+	const Vertex*& copy = _transformedVertices[std::make_pair(v, frame.id)];
+	if (!copy) {
+		Vertex vertex = *v;
+		vertex.position = frame.matrix * v->position;
+		vertex.normal = frame.normalMatrix * v->normal;
+		_vertices.push_back(vertex);
+		copy = &_vertices.back();
+	}
+	return copy;
+}
+
+Shape* TransformFlattener::wrap(Shape* shape) {
+	if (!transformed()) return shape;
+	StaticAffineShape* affineShape = create<StaticAffineShape>();
+	affineShape->set(_frames.back().matrix, shape, !_fileDepth);
+	return affineShape;
+}
+
+void TransformFlattener::addMemoryUsage(MemoryStats& stats) const {
+	stats.bytes[MemoryStats::SHAPES] += _factory.memoryUsage();
+	// Each node of the map holds the entry and (typically) three pointers and a color
+	stats.bytes[MemoryStats::SCENE_DATA] += _vertices.size() * sizeof(Vertex) +
+		_transformedVertices.size() * (sizeof(decltype(_transformedVertices)::value_type) + 4 * sizeof(void*));
+}
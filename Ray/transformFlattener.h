@@ -0,0 +1,90 @@
+#ifndef TRANSFORM_FLATTENER_INCLUDED
+#define TRANSFORM_FLATTENER_INCLUDED
+
+#include <deque>
+#include <map>
+#include <vector>
+#include <Util/geometry.h>
+#include <Util/factory.h>
+#include "shape.h"
+#include "scene.h"
+
+namespace Ray {
+	/** This class bakes the static transformations of a scene-graph into world-space copies of the geometry beneath them.
+	*** It is passed down the scene-graph through Shape::flatten, keeping track of the composition of the static transformations passed through,
+	*** and it owns the shapes and vertices it creates. */
+	class TransformFlattener {
+		/** This class stores a static transformation that is being applied */
+		struct _Frame {
+			/** The composed transformation, and the transformation it applies to normals */
+			Util::Matrix4D matrix;
+			Util::Matrix3D normalMatrix;
+
+			/** The identifier of the frame, distinguishing the visits to the same static transformation (e.g. through different file instances) */
+			unsigned int id;
+		};
+
+		/** The static transformations that are being applied, with the innermost last */
+		std::vector<_Frame> _frames;
+
+		/** The number of frames that have been pushed */
+		unsigned int _frameNum;
+
+		/** The number of file instances being flattened */
+		unsigned int _fileDepth;
+
+		/** The factory allocating the shapes */
+		Util::DerivedFactory<Shape, ShapeList> _factory;
+
+		/** The transformed vertices (in a deque, so that their addresses are not changed by adding more) */
+		std::deque<Vertex> _vertices;
+
+		/** The transformed copies of the vertices, indexed by the original vertex and the frame in which it was transformed */
+		std::map<std::pair<const Vertex*, unsigned int>, const Vertex*> _transformedVertices;
+
+	public:
+		/** The largest relative deviation from a similarity for which a transformed sphere is still represented as a sphere.
+		*** It allows for rotations whose coefficients have been written out to six digits. */
+		static const double SimilarityTolerance;
+
+		/** The default constructor starts with no transformation applied */
+		TransformFlattener(void);
+
+		/** This method composes the prescribed transformation with the current one */
+		void push(const Util::Matrix4D& m);
+
+		/** This method restores the transformation prior to the last push */
+		void pop(void);
+
+		/** These methods mark the start and end of the flattening of a file instance.
+		*** Shapes of a file that are wrapped rather than copied are shared with the file's own scene-graph, which updates their bounding boxes. */
+		void enterFile(void) { _fileDepth++; }
+		void leaveFile(void) { _fileDepth--; }
+
+		/** This method returns true if a transformation is being applied */
+		bool transformed(void) const { return !_frames.empty(); }
+
+		/** This method returns the transformation being applied */
+		Util::Matrix4D matrix(void) const;
+
+		/** This method returns true if the transformation being applied is a similarity (a rotation, reflection, and uniform scale, followed by a translation),
+		*** in which case it sets the scale */
+		bool isSimilarity(double& scale) const;
+
+		/** This method returns the transformed copy of the vertex (creating it the first time the vertex is transformed in the current frame).
+		*** The normal is not re-normalized, so that interpolating transformed normals gives the transform of the interpolated normal. */
+		const Vertex* vertex(const Vertex* v);
+
+		/** This method returns a shape applying the current transformation to the prescribed shape, used when the shape cannot be transformed exactly.
+		*** If no transformation is being applied, the shape itself is returned. */
+		Shape* wrap(Shape* shape);
+
+		/** This method adds the bytes held by the flattener's shapes and vertices to the tallies (the shapes are walked through the flattened scene-graph) */
+		void addMemoryUsage(MemoryStats& stats) const;
+
+		/** This method creates a shape of the prescribed type, owned by the flattener */
+		template <typename ShapeType>
+		ShapeType* create(void) { return static_cast<ShapeType*>(_factory.template create<ShapeType>()); }
+	};
+}
+#endif // TRANSFORM_FLATTENER_INCLUDED
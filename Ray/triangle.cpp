@@ -1,6 +1,7 @@
 #include <cmath>
 #include <Util/exceptions.h>
 #include "triangle.h"
+#include "transformFlattener.h"
 
 using namespace Ray;
 using namespace Util;
@@ -8,6 +9,8 @@ using namespace Util;
 //////////////
 // Triangle //
 //////////////
+bool Triangle::SinglePrecision = false;
+
 Triangle::Triangle(void) { _v[0] = _v[1] = _v[2] = nullptr; }
 
 Triangle::Triangle(Vertex* v0, Vertex* v1, Vertex* v2) { _v[0] = v0, _v[1] = v1, _v[2] = v2; }
@@ -31,3 +34,14 @@ void Triangle::addTrianglesOpenGL(std::vector<TriangleIndex>& triangles) {
 }
 
 size_t Triangle::primitiveNum(void) const { return 1; }
+
+Shape* Triangle::flatten(TransformFlattener& flattener) {
+	if (!flattener.transformed()) return this;
+	Triangle* triangle = flattener.create<Triangle>();
+	for (int i = 0; i < 3; i++) {
+		triangle->_vIndices[i] = _vIndices[i];
+		triangle->_v[i] = flattener.vertex(_v[i]);
+	}
+	triangle->_initGeometry();
+	return triangle;
+}
@@ -44,10 +44,34 @@ namespace Ray {
 		double _d11; // v1 dot v1
 		double _denom; // _d00 * _d11 - _d01 * _d01
 
-		/** Polynomial used for planar intersection test */
-		Util::Polynomial3D<1> _P;
+		/** Polynomial used for planar intersection test (arranged for restriction to rays in closed form) */
+		Util::RaySubstitution3D<1> _P;
+
+		/** The single-precision copies of the first vertex and of the edges from it to the other two, used by the single-precision intersection */
+		Util::Point3F _p0, _e1, _e2;
+
+		/** The largest magnitude of the vertex coordinates, bounding the round-off error of the single-precision intersection */
+		float _magnitude;
+
+		/** This method computes the plane and the intersection data from the vertices */
+		void _initGeometry(void);
+
+		/** This static method returns the cross-product of two 3D points (avoiding the determinant evaluation of Point::CrossProduct) */
+		template <typename Real>
+		static Util::Point<3, Real> _Cross(const Util::Point<3, Real>& a, const Util::Point<3, Real>& b);
 
 	public:
+		/** This static method computes the intersection of the ray with the triangle with vertex p0 and edges e1 and e2 from it,
+		*** using the Moller-Trumbore test in the prescribed precision.
+		*** It returns the parameter of the intersection (or infinity) and sets the barycentric coordinates of the second and third vertices.
+		*** Intersections closer than tMin or farther than tMax are rejected. */
+		template <typename Real>
+		static double Intersect(const Util::Ray<3, Real>& ray, const Util::Point<3, Real>& p0, const Util::Point<3, Real>& e1,
+		                        const Util::Point<3, Real>& e2, double tMin, double tMax, double& beta, double& gamma);
+
+		/** When set, triangles are intersected in single precision, with the minimum distance to an intersection scaled to the round-off error */
+		static bool SinglePrecision;
+
 		/** This static method returns the directive describing the shape. */
 		static std::string Directive(void) { return "shape_triangle"; }
 
@@ -76,6 +100,9 @@ namespace Ray {
 		void addTrianglesOpenGL(std::vector<TriangleIndex>& triangles) override;
 		void drawOpenGL(GLSLProgram* glslProgram) const override;
 		size_t primitiveNum(void) const override;
+		Shape* flatten(class TransformFlattener& flattener) override;
 	};
 }
+
+#include "triangle.inl"
 #endif // TRIANGLE_INCLUDED
@@ -0,0 +1,33 @@
+#include <limits>
+
+namespace Ray {
+	//////////////
+	// Triangle //
+	//////////////
+	template <typename Real>
+	Util::Point<3, Real> Triangle::_Cross(const Util::Point<3, Real>& a, const Util::Point<3, Real>& b) {
+		return Util::Point<3, Real>(a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]);
+	}
+
+	template <typename Real>
+	double Triangle::Intersect(const Util::Ray<3, Real>& ray, const Util::Point<3, Real>& p0, const Util::Point<3, Real>& e1,
+	                           const Util::Point<3, Real>& e2, double tMin, double tMax, double& beta, double& gamma) {
+		const Util::Point<3, Real> p = _Cross(ray.direction, e2);
+		const Real det = static_cast<Real>(e1.dot(p));
+		if (det == 0) return Util::Infinity;
+		const Real inverseDet = 1 / det;
+		const Util::Point<3, Real> s = ray.position - p0;
+		// The barycentric coordinates are tested against a tolerance of a few units of round-off,
+		// so that rays through a shared edge cannot slip between the two triangles
+		const Real tolerance = 32 * std::numeric_limits<Real>::epsilon();
+		const Real u = static_cast<Real>(s.dot(p)) * inverseDet;
+		if (u < -tolerance || u > 1 + tolerance) return Util::Infinity;
+		const Util::Point<3, Real> q = _Cross(s, e1);
+		const Real v = static_cast<Real>(ray.direction.dot(q)) * inverseDet;
+		if (v < -tolerance || u + v > 1 + tolerance) return Util::Infinity;
+		const Real t = static_cast<Real>(e2.dot(q)) * inverseDet;
+		if (t < tMin || t > tMax) return Util::Infinity;
+		beta = u, gamma = v;
+		return t;
+	}
+}
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <Util/exceptions.h>
 #include "triangle.h"
 
@@ -18,7 +20,10 @@ void Triangle::init(const LocalSceneData& data) {
 			THROW("vertex index out of bounds: %d <= %d", _vIndices[i], static_cast<int>(data.vertices.size()));
 		else _v[i] = &data.vertices[_vIndices[i]];
 	}
+	_initGeometry();
+}
 
+void Triangle::_initGeometry(void) {
 	const Point3D p1 = _v[0]->position;
 	const Point3D p2 = _v[1]->position;
 	const Point3D p3 = _v[2]->position;
@@ -42,6 +47,14 @@ void Triangle::init(const LocalSceneData& data) {
 	_d01 = v0.dot(v1);
 	_d11 = v1.dot(v1);
 	_denom = _d00 * _d11 - _d01 * _d01;
+
+	// Store what the single-precision intersection needs
+	_p0 = Point3F(p1);
+	_e1 = Point3F(v0);
+	_e2 = Point3F(v1);
+	_magnitude = 0;
+	for (int i = 0; i < 3; i++)
+		for (int j = 0; j < 3; j++) _magnitude = std::max<float>(_magnitude, static_cast<float>(fabs(_v[i]->position[j])));
 }
 
 void Triangle::updateBoundingBox(void) {
@@ -70,6 +83,28 @@ double Triangle::intersect(Ray3D ray, RayShapeIntersectionInfo& iInfo, BoundingB
 	/////////////////////////////////////////////////////////////
 	// Compute the intersection of the shape with the ray here //
 	/////////////////////////////////////////////////////////////
+	if (SinglePrecision) {
+		// The error in the computed parameter is a small multiple of the float round-off times the magnitude of the coordinates involved,
+		// so intersections closer than that are rejected to keep secondary rays from hitting the surface they leave from
+		float rayMagnitude = 0;
+		for (int i = 0; i < 3; i++) rayMagnitude = std::max<float>(rayMagnitude, static_cast<float>(fabs(ray.position[i])));
+		const double tMin = std::max<double>(range[0][0], 16. * std::numeric_limits<float>::epsilon() * (rayMagnitude + _magnitude));
+		double beta, gamma;
+		const double t = Intersect(Ray3F(ray), _p0, _e1, _e2, tMin, range[1][0], beta, gamma);
+		if (isinf(t) || !validityLambda(t)) return Infinity;
+		// The tolerance admits slightly negative barycentric coordinates, which are clamped (and the rest renormalized)
+		// so that the hit is not extrapolated past the triangle
+		double alpha = std::max(1. - beta - gamma, 0.);
+		beta = std::max(beta, 0.), gamma = std::max(gamma, 0.);
+		const double sum = alpha + beta + gamma;
+		alpha /= sum, beta /= sum, gamma /= sum;
+		// The hit is reconstructed from the barycentric coordinates, so that the round-off in the parameter does not move it off the surface
+		iInfo.position = alpha * _v[0]->position + beta * _v[1]->position + gamma * _v[2]->position;
+		iInfo.normal = (alpha * _v[0]->normal + beta * _v[1]->normal + gamma * _v[2]->normal).unit();
+		iInfo.texture = (alpha * _v[0]->texCoordinate + beta * _v[1]->texCoordinate + gamma * _v[2]->texCoordinate);
+		return t;
+	}
+
 	const Polynomial1D<1> p2 = _P(ray);
 	double roots[1];
 	const unsigned int root_num = p2.roots(roots);
@@ -44,6 +44,30 @@ int Window::_width;
 
 int Window::_height;
 
+ProgressiveRenderer* Window::_preview = nullptr;
+
+Camera Window::_previewCamera;
+
+int Window::_previewWidth;
+
+int Window::_previewHeight;
+
+GLuint Window::_previewTextureHandle = 0;
+
+int Window::previewRecursionLimit = 5;
+
+double Window::previewCutOff = 0.0001;
+
+unsigned int Window::previewLightSamples = 16;
+
+/** This function returns true if the two cameras see the same view */
+static bool SameView(const Camera& c1, const Camera& c2) {
+	for (int d = 0; d < 3; d++)
+		if (c1.position[d] != c2.position[d] || c1.forward[d] != c2.forward[d] || c1.up[d] != c2.up[d])
+			return false;
+	return c1.heightAngle == c2.heightAngle;
+}
+
 int Window::PrintError(int showNoError) {
 	int x, y;
 	int e = 1;
@@ -169,8 +193,8 @@ Image32 Window::TakeSnapshot(void) {
 }
 
 void Window::IdleFunction(void) {
-	// Update the parameter values
-	scene->setCurrentTime(timer.elapsed(), interpolationType);
+	// Update the parameter values (the scene is frozen while the preview threads are reading it)
+	if (!_preview) scene->setCurrentTime(timer.elapsed(), interpolationType);
 	// Just draw the scene again
 	if (isVisible) glutPostRedisplay();
 }
@@ -230,6 +254,9 @@ void Window::KeyboardFunction(unsigned char c, int x, int y) {
 		std::cerr << "Dir: ( " << scene->_globalData.camera.forward << " )" << std::endl;
 		std::cerr << "Up: ( " << scene->_globalData.camera.up << " )" << std::endl;
 		break;
+	case 'r':
+		_TogglePreview();
+		break;
 	}
 }
 
@@ -311,10 +338,15 @@ void Window::MainMenu(int entry) {
 			cin >> cutOff;
 			cout << "Light samples: ";
 			cin >> lightSamples;
+			// The preview threads cannot be reading the scene while the bounding boxes are updated
+			if (_preview) _TogglePreview();
 			Image32 img = scene->rayTrace(_width, _height, recursionDepth, cutOff, lightSamples);
 			img.write(fileName);
 			break;
 		}
+	case RAY_TRACE_PREVIEW:
+		_TogglePreview();
+		break;
 	case WRITE_SCENE:
 		{
 			string fileName;
@@ -370,7 +402,8 @@ void Window::DisplayFunction(void) {
 	// Draw the RayScene
 	GLint drawMode[2];
 	glGetIntegerv(GL_POLYGON_MODE, drawMode);
-	if (drawMode[0] == GL_FILL) scene->drawOpenGL();
+	if (_preview) _DrawPreview();
+	else if (drawMode[0] == GL_FILL) scene->drawOpenGL();
 	else {
 		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -405,6 +438,11 @@ void Window::DisplayFunction(void) {
 	sprintf(temp, "%.1f fs", frameRate);
 	WriteLeftString(1, 2, temp);
 
+	if (_preview) {
+		sprintf(temp, "Ray-traced preview: %d / %d", _preview->level() + 1, ProgressiveRenderer::LevelNum);
+		WriteLeftString(1, 22, temp);
+	}
+
 	// Write out the mouse position
 	sprintf(temp, "( %3d , %3d )", mouse.endX, mouse.endY);
 	WriteRightString(1, 2, temp);
@@ -454,6 +492,84 @@ void Window::DisplayFunction(void) {
 	}
 }
 
+void Window::_TogglePreview(void) {
+	if (_preview) {
+		delete _preview;
+		_preview = nullptr;
+	}
+	else {
+		// The bounding boxes may be stale if the scene was animated
+		scene->updateBoundingBox();
+		_preview = new ProgressiveRenderer(*scene, previewRecursionLimit, previewCutOff, previewLightSamples);
+		_previewWidth = _previewHeight = 0;
+	}
+	glutPostRedisplay();
+}
+
+void Window::_DrawPreview(void) {
+	// Restart the preview as soon as the view changes
+	if (_width != _previewWidth || _height != _previewHeight || !SameView(scene->_globalData.camera, _previewCamera)) {
+		_previewCamera = scene->_globalData.camera;
+		_previewWidth = _width, _previewHeight = _height;
+		_preview->restart(_previewCamera, _width, _height);
+	}
+
+	if (!_previewTextureHandle) {
+		glGenTextures(1, &_previewTextureHandle);
+		glBindTexture(GL_TEXTURE_2D, _previewTextureHandle);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// Upload the most refined image (Pixel32 is laid out as RGBA bytes)
+	Image32 img;
+	if (_preview->update(img)) {
+		glBindTexture(GL_TEXTURE_2D, _previewTextureHandle);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img.width(), img.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, &img(0, 0));
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	if (_preview->level() < 0) return;
+
+	// Draw the texture over the whole viewport
+	glUseProgram(0);
+	GLint dt = glIsEnabled(GL_DEPTH_TEST);
+	GLint lm = glIsEnabled(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, 1, 0, 1, 0, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, _previewTextureHandle);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	// The first row of the image is the top of the view
+	glBegin(GL_QUADS);
+	glTexCoord2d(0, 1), glVertex2d(0, 0);
+	glTexCoord2d(1, 1), glVertex2d(1, 0);
+	glTexCoord2d(1, 0), glVertex2d(1, 1);
+	glTexCoord2d(0, 0), glVertex2d(0, 1);
+	glEnd();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	if (dt) glEnable(GL_DEPTH_TEST);
+	if (lm) glEnable(GL_LIGHTING);
+	ASSERT_OPEN_GL_STATE();
+}
+
 void Window::ReshapeFunction(int width, int height) {
 	_width = width, _height = height;
 	GLint viewPort[4];
@@ -530,6 +646,7 @@ void Window::View(Scene& s, int width, int height) {
 	glutAddSubMenu(" Interpolation type ", interpolationTypeMenu);
 	glutAddSubMenu(" Rotation parametrization type ", parametrizationTypeMenu);
 	glutAddMenuEntry(" Ray-trace ", RAY_TRACE);
+	glutAddMenuEntry(" Ray-traced preview ", RAY_TRACE_PREVIEW);
 	glutAddMenuEntry(" Write scene ", WRITE_SCENE);
 	glutAddMenuEntry(" Quit ", QUIT);
 
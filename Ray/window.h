@@ -4,6 +4,7 @@
 #include <Util/timer.h>
 #include <Ray/mouse.h>
 #include <Ray/scene.h>
+#include <Ray/progressiveRenderer.h>
 
 namespace Ray {
 	/** This class represents the OpenGL window within which the 3D models are drawn. */
@@ -12,12 +13,29 @@ namespace Ray {
 		enum {
 			QUIT,
 			RAY_TRACE,
-			WRITE_SCENE
+			WRITE_SCENE,
+			RAY_TRACE_PREVIEW
 		};
 
 		/** The dimensions of the window */
 		static int _width, _height;
 
+		/** The renderer for the ray-traced preview (null if the preview is off) */
+		static ProgressiveRenderer* _preview;
+
+		/** The camera and dimensions the preview was last (re)started with */
+		static Camera _previewCamera;
+		static int _previewWidth, _previewHeight;
+
+		/** The texture handle for the ray-traced preview */
+		static GLuint _previewTextureHandle;
+
+		/** This function toggles the ray-traced preview */
+		static void _TogglePreview(void);
+
+		/** This function draws the most refined ray-traced preview image, restarting the preview if the view has changed */
+		static void _DrawPreview(void);
+
 	public:
 		/** The ascii value of the escape character */
 		const static char KEY_ESCAPE;
@@ -74,6 +92,11 @@ namespace Ray {
 		/** The type of parametrization to be used for animation */
 		static int parametrizationType;
 
+		/** The recursion limit, cut-off, and number of light samples used by the ray-traced preview */
+		static int previewRecursionLimit;
+		static double previewCutOff;
+		static unsigned int previewLightSamples;
+
 		/** This function prints out the state of the OpenGL error. */
 		static int PrintError(int showNoError = 0);
 
@@ -0,0 +1,91 @@
+#ifndef ARENA_INCLUDED
+#define ARENA_INCLUDED
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <new>
+
+namespace Util
+{
+	/** This class represents a bump allocator.
+	  * Memory is handed out sequentially from large blocks, so objects allocated one after the other are contiguous in memory.
+	  * Individual allocations cannot be freed; all the memory is released at once when the arena is cleared or destroyed.
+	  * The arena does not run destructors -- that is the responsibility of the code that constructed the objects. */
+	class Arena
+	{
+		/** The blocks of memory allocated so far */
+		std::vector< char * > _blocks;
+
+		/** The next free byte in the current block and the end of the current block */
+		char *_current , *_end;
+
+		/** The size of the next block to be allocated */
+		size_t _blockSize;
+
+		/** The total number of bytes handed out */
+		size_t _size;
+
+		/** The total size of the blocks allocated so far */
+		size_t _capacity;
+
+	public:
+		/** The size of the first block */
+		static const size_t InitialBlockSize = 1<<16;
+
+		/** The size beyond which blocks stop growing */
+		static const size_t MaxBlockSize = 1<<26;
+
+		Arena( void ) : _current(NULL) , _end(NULL) , _blockSize(InitialBlockSize) , _size(0) , _capacity(0) {}
+
+		Arena( const Arena & ) = delete;
+		Arena &operator = ( const Arena & ) = delete;
+
+		/** The destructor releases all the blocks */
+		~Arena( void ){ clear(); }
+
+		/** This method returns a pointer to size bytes of memory with the prescribed alignment */
+		void *allocate( size_t size , size_t alignment=alignof( std::max_align_t ) )
+		{
+			uintptr_t address = ( reinterpret_cast< uintptr_t >( _current ) + alignment - 1 ) & ~( uintptr_t )( alignment-1 );
+			if( !_current || address + size > reinterpret_cast< uintptr_t >( _end ) )
+			{
+				// Start a new block, large enough for the request
+				size_t blockSize = _blockSize;
+				while( blockSize < size + alignment ) blockSize <<= 1;
+				char *block = (char *)malloc( blockSize );
+				if( !block ) throw std::bad_alloc();
+				_blocks.push_back( block );
+				_capacity += blockSize;
+				_current = block , _end = block + blockSize;
+				if( _blockSize<MaxBlockSize ) _blockSize <<= 1;
+				address = ( reinterpret_cast< uintptr_t >( _current ) + alignment - 1 ) & ~( uintptr_t )( alignment-1 );
+			}
+			_current = reinterpret_cast< char * >( address + size );
+			_size += size;
+			return reinterpret_cast< void * >( address );
+		}
+
+		/** This method default-constructs an object of type T in the arena */
+		template< typename T >
+		T *create( void ){ return new ( allocate( sizeof(T) , alignof(T) ) ) T(); }
+
+		/** This method releases all of the memory */
+		void clear( void )
+		{
+			for( size_t i=0 ; i<_blocks.size() ; i++ ) free( _blocks[i] );
+			_blocks.clear();
+			_current = _end = NULL;
+			_blockSize = InitialBlockSize;
+			_size = _capacity = 0;
+		}
+
+		/** This method returns the number of bytes handed out */
+		size_t size( void ) const { return _size; }
+
+		/** This method returns the number of bytes reserved from the system */
+		size_t capacity( void ) const { return _capacity; }
+	};
+}
+#endif // ARENA_INCLUDED
@@ -62,8 +62,12 @@ namespace Util
 		size += strlen(functionName)+1;
 
 		// Line 3
+		// [NOTE] The argument list is consumed by a call to vsnprintf, so we measure using a copy
+		va_list _args;
+		va_copy( _args , args );
 		size += strlen(header)+1;
-		size += vsnprintf( NULL , 0 , format , args );
+		size += vsnprintf( NULL , 0 , format , _args );
+		va_end( _args );
 
 		char *_buffer , *buffer = new char[ size+1 ];
 		_size = size , _buffer = buffer;
@@ -96,6 +100,7 @@ namespace Util
 		_size -= strlen(header)+1;
 
 		vsnprintf( _buffer , _size+1 , format , args );
+		va_end( args );
 
 		return buffer;
 	}
@@ -136,7 +141,10 @@ namespace Util
 		va_list args;
 		va_start( args , format );
 
-		size_t _size , size = vsnprintf( NULL , 0 , format , args );
+		va_list _args;
+		va_copy( _args , args );
+		size_t _size , size = vsnprintf( NULL , 0 , format , _args );
+		va_end( _args );
 		size += strlen(header)+1;
 		size += strlen(functionName)+2;
 
@@ -152,6 +160,7 @@ namespace Util
 		_size -= strlen(functionName)+2;
 
 		vsnprintf( _buffer , _size+1 , format , args );
+		va_end( args );
 
 		return buffer;
 	}
@@ -2,11 +2,14 @@
 #define FACTORY_INCLUDED
 
 #include <type_traits>
+#include <vector>
+#include "arena.h"
 
 namespace Util
 {
 	/** This templated class represents a factory for generating objects of type BaseType.
-	  * It tracks the objects created and deletes them in the destructor. */
+	  * The objects are allocated from an arena, so that objects created in succession are contiguous in memory.
+	  * It tracks the objects created and destroys them in the destructor, releasing the memory in bulk. */
 	template< typename BaseType >
 	class BaseFactory
 	{
@@ -16,9 +19,14 @@ namespace Util
 		/** The virtual method creating an object of type BaseType on the heap */
 		virtual BaseType *_create( void ) = 0;
 
+	protected:
+		/** The arena from which the objects are allocated */
+		Arena _arena;
+
 	public:
-		/** The destructor is responsible for deallocating all the BaseType created */
-		virtual ~BaseFactory( void ){ for( int i=0 ; i<_baseTypes.size() ; i++ ) delete _baseTypes[i]; }
+		/** The destructor is responsible for destroying all the BaseType created
+		  * [WARNING] Since the memory belongs to the arena, objects returned by the factory should never be deleted directly */
+		virtual ~BaseFactory( void ){ for( size_t i=_baseTypes.size() ; i>0 ; i-- ) _baseTypes[i-1]->~BaseType(); }
 
 		/** The (publicly accessible) method for creating a new object */
 		BaseType *create( void )
@@ -33,10 +41,13 @@ namespace Util
 		BaseType *create( void )
 		{
 			static_assert( std::is_base_of< BaseType , DerivedType >::value , "[ERROR] BaseType must be base of DerivedType" );
-			BaseType *baseType = new DerivedType();
+			BaseType *baseType = _arena.template create< DerivedType >();
 			_baseTypes.push_back( baseType );
 			return baseType;
 		}
+
+		/** This method returns the number of bytes held by the factory: the arena's blocks and the list of created objects */
+		size_t memoryUsage( void ) const { return _arena.capacity() + _baseTypes.capacity() * sizeof( BaseType * ); }
 	};
 
 	/** This derived template class is a factory for creating derived objects of type DerivedType */
@@ -48,7 +59,7 @@ namespace Util
 		/////////////////////////////////////
 		// BaseFactory< BaseType > methods //
 		/////////////////////////////////////
-		BaseType *_create( void ){ return new DerivedType(); }
+		BaseType *_create( void ){ return this->_arena.template create< DerivedType >(); }
 	};
 }
 #endif // FACTORY_INCLUDED
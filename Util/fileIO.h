@@ -0,0 +1,47 @@
+#ifndef FILE_IO_INCLUDED
+#define FILE_IO_INCLUDED
+
+#include <stdio.h>
+#ifdef _WIN32
+#include <io.h>
+#else // !_WIN32
+#include <sys/types.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace Util
+{
+	/** This function seeks to the prescribed position in the file, with an offset that may exceed the range of a long.
+	*** (As with fseek, it returns zero on success.) */
+	inline int Seek( FILE *fp , long long offset )
+	{
+#ifdef _WIN32
+		return _fseeki64( fp , offset , SEEK_SET );
+#else // !_WIN32
+		return fseeko( fp , (off_t)offset , SEEK_SET );
+#endif // _WIN32
+	}
+
+	/** This function returns the position in the file, with an offset that may exceed the range of a long */
+	inline long long Tell( FILE *fp )
+	{
+#ifdef _WIN32
+		return _ftelli64( fp );
+#else // !_WIN32
+		return (long long)ftello( fp );
+#endif // _WIN32
+	}
+
+	/** This function flushes the file's buffers and waits for the operating system to commit its contents to the disk.
+	*** (As with fflush, it returns zero on success.) */
+	inline int Sync( FILE *fp )
+	{
+		if( fflush( fp ) ) return EOF;
+#ifdef _WIN32
+		return _commit( _fileno( fp ) );
+#else // !_WIN32
+		return fsync( fileno( fp ) );
+#endif // _WIN32
+	}
+}
+#endif // FILE_IO_INCLUDED
@@ -40,15 +40,16 @@ namespace Util
 	static const double Epsilon = 1e-10;
 	static const double Infinity = std::numeric_limits< double >::infinity();
 
-	/** This templated class represents a Dim-dimenaional vector */
-	template< unsigned int Dim >
-	class Point : public InnerProductSpace< Point< Dim > >
+	/** This templated class represents a Dim-dimenaional vector, with coefficients of type Real.
+	*** Double precision is the default; single-precision points are used where the memory footprint and SIMD width matter more than the precision. */
+	template< unsigned int Dim , typename Real=double >
+	class Point : public InnerProductSpace< Point< Dim , Real > >
 	{
 		/** The coordinates of the point */
-		double _p[Dim];
+		Real _p[Dim];
 
 		/** Initializes coordinate values from an array */
-		void _init( const double *values , unsigned int sz );
+		void _init( const Real *values , unsigned int sz );
 	public:
 		/** Default constructor, initializes coefficients to zero. */
 		Point( void );
@@ -60,11 +61,15 @@ namespace Util
 		template< typename ... Doubles >
 		Point( Doubles ... values );
 
+		/** This constructor converts a point with coefficients of a different type. */
+		template< typename _Real >
+		explicit Point( const Point< Dim , _Real > &p );
+
 		/** This method returns a reference to the indexed coefficient.*/
-		double &operator[] ( int index );
+		Real &operator[] ( int index );
 
 		/** This method returns a reference to the indexed coefficient.*/
-		const double &operator[] ( int index ) const;
+		const Real &operator[] ( int index ) const;
 
 		/** This method performs a component-wise multiplication of two ponts and returns the product. */
 		Point  operator *  ( const Point &p ) const;
@@ -103,12 +108,12 @@ namespace Util
 	};
 
 	/** Functionality for outputing a point to a stream.*/
-	template< unsigned int Dim >
-	std::ostream &operator << ( std::ostream &stream , const Point< Dim > &p );
+	template< unsigned int Dim , typename Real >
+	std::ostream &operator << ( std::ostream &stream , const Point< Dim , Real > &p );
 
 	/** Functionality for inputing a point from a stream.*/
-	template< unsigned int Dim >
-	std::istream &operator >> ( std::istream &stream , Point< Dim > &p );
+	template< unsigned int Dim , typename Real >
+	std::istream &operator >> ( std::istream &stream , Point< Dim , Real > &p );
 
 	/** This templated class represents a Dim x Dim matrix.
 	*  Matrices are stored in column-major order but are accessed using (row,column) indexing so that:
@@ -247,37 +252,41 @@ namespace Util
 		double operator()( const Point< Dim > &p ) const;
 	};
 
-	/** This templated class represents a Ray.*/
-	template< unsigned int Dim >
+	/** This templated class represents a Ray, with coefficients of type Real.*/
+	template< unsigned int Dim , typename Real=double >
 	class Ray
 	{
 	public:
 		/** The starting point of the ray */
-		Point< Dim > position;
+		Point< Dim , Real > position;
 
 		/** The direction of the ray */
-		Point< Dim > direction;
+		Point< Dim , Real > direction;
 
 		/** The default constructor */
 		Ray( void );
 
 		/** The constructor settign the the position and direction of the ray */
-		Ray( const Point< Dim > &position , const Point< Dim > &direction );
+		Ray( const Point< Dim , Real > &position , const Point< Dim , Real > &direction );
+
+		/** This constructor converts a ray with coefficients of a different type. */
+		template< typename _Real >
+		explicit Ray( const Ray< Dim , _Real > &ray );
 
 		/** This method computes the translation of the ray by p and returns the translated ray.*/
-		Ray  operator +  ( const Point< Dim > &p ) const;
+		Ray  operator +  ( const Point< Dim , Real > &p ) const;
 
 		/** This method translates the current ray by p.*/
-		Ray &operator += ( const Point< Dim > &p );
+		Ray &operator += ( const Point< Dim , Real > &p );
 
 		/** This method computes the translation of the ray by -p and returns the translated ray.*/
-		Ray  operator -  ( const Point< Dim > &p ) const;
+		Ray  operator -  ( const Point< Dim , Real > &p ) const;
 
 		/** This method translates the current ray by -p.*/
-		Ray &operator -= ( const Point< Dim > &p );
+		Ray &operator -= ( const Point< Dim , Real > &p );
 
 		/** This method returns the point at a distance of t along the ray. */
-		Point< Dim > operator() ( double t ) const;
+		Point< Dim , Real > operator() ( double t ) const;
 	};
 
 	/** This method applies a transformation to a ray.*/
@@ -285,8 +294,8 @@ namespace Util
 	Ray< Dim > operator * ( const Matrix< Dim+1 > &m , const Ray< Dim > &ray );
 
 	/** This function prints out the ray.*/
-	template< unsigned int Dim >
-	std::ostream &operator << ( std::ostream &stream , const Ray< Dim > &ray )
+	template< unsigned int Dim , typename Real >
+	std::ostream &operator << ( std::ostream &stream , const Ray< Dim , Real > &ray )
 	{
 		stream << "[ " << ray.position << " ] [ " << ray.direction << " ]";
 		return stream;
@@ -352,7 +361,7 @@ namespace Util
 
 	/** Functionality for outputing a bounding box to a stream.*/
 	template< unsigned int Dim >
-	std::ostream &operator << ( std::ostream &stream , const Point< Dim > &p );
+	std::ostream &operator << ( std::ostream &stream , const BoundingBox< Dim > &b );
 
 	////////////////////////////////////////////
 	// Classes specialized for 2D, 3D, and 4D //
@@ -370,6 +379,9 @@ namespace Util
 	/** A point in 4D */
 	typedef Point< 4 > Point4D;
 
+	/** A single-precision point in 3D */
+	typedef Point< 3 , float > Point3F;
+
 	/** A 1x1 matrix */
 	typedef Matrix< 1 > Matrix1D;
 
@@ -403,6 +415,9 @@ namespace Util
 	/** A ray in 4D */
 	typedef Ray< 4 > Ray4D;
 
+	/** A single-precision ray in 3D */
+	typedef Ray< 3 , float > Ray3F;
+
 	/** A bounding box in 1D */
 	typedef BoundingBox< 1 > BoundingBox1D;
 
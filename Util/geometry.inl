@@ -36,85 +36,89 @@ namespace Util
 	///////////
 	// Point //
 	///////////
-	template< unsigned int Dim >
-	void Point< Dim >::_init( const double *values , unsigned int sz )
+	template< unsigned int Dim , typename Real >
+	void Point< Dim , Real >::_init( const Real *values , unsigned int sz )
 	{
 		if     ( sz==0   ) memset( _p , 0 , sizeof(_p) );
 		else if( sz==Dim ) memcpy( _p , values , sizeof(_p) );
 		else ERROR_OUT( "Should never be called" );
 	}
 
-	template< unsigned int Dim >
-	Point< Dim >::Point( void ){ memset( _p , 0 , sizeof(_p) ); }
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real >::Point( void ){ memset( _p , 0 , sizeof(_p) ); }
 
-	template< unsigned int Dim >
-	Point< Dim >::Point( const Point &p ){ memcpy( _p , p._p , sizeof(_p) ); }
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real >::Point( const Point &p ){ memcpy( _p , p._p , sizeof(_p) ); }
 
-	template< unsigned int Dim >
+	template< unsigned int Dim , typename Real >
+	template< typename _Real >
+	Point< Dim , Real >::Point( const Point< Dim , _Real > &p ){ for( int i=0 ; i<Dim ; i++ ) _p[i] = (Real)p[i]; }
+
+	template< unsigned int Dim , typename Real >
 	template< typename ... Doubles >
-	Point< Dim >::Point( Doubles ... values )
+	Point< Dim , Real >::Point( Doubles ... values )
 	{
 		static_assert( sizeof...(values)==Dim || sizeof...(values)==0 , "[ERROR] Point< Dim >::Point: Invalid number of coefficients" );
-		const double _values[] = { values... };
+		const Real _values[] = { (Real)values... };
 		_init( _values , sizeof...(values) );
 	}
 
-	template< unsigned int Dim >
-	Point< Dim > Point< Dim >::operator * ( double s ) const { Point p ; for( int i=0 ; i<Dim ; i++ ) p._p[i] = _p[i] * s ; return p; }
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > Point< Dim , Real >::operator * ( double s ) const { Point p ; for( int i=0 ; i<Dim ; i++ ) p._p[i] = _p[i] * (Real)s ; return p; }
 
-	template< unsigned int Dim >
-	Point< Dim > Point< Dim >::operator + ( const Point &p ) const { Point q ; for( int i=0 ; i<Dim ; i++ ) q._p[i] += _p[i] + p._p[i] ; return q; }
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > Point< Dim , Real >::operator + ( const Point &p ) const { Point q ; for( int i=0 ; i<Dim ; i++ ) q._p[i] += _p[i] + p._p[i] ; return q; }
 
-	template< unsigned int Dim >
-	double Point< Dim >::dot( const Point &q ) const
+	template< unsigned int Dim , typename Real >
+	double Point< Dim , Real >::dot( const Point &q ) const
 	{
-		double dot = 0;
+		Real dot = 0;
 		for( int i=0 ; i<Dim ; i++ ) dot += _p[i] * q._p[i];
 		return dot;
 	}
 
-	template< unsigned int Dim >
-	double& Point< Dim >::operator[] ( int i ){ return _p[i]; }
+	template< unsigned int Dim , typename Real >
+	Real& Point< Dim , Real >::operator[] ( int i ){ return _p[i]; }
 
-	template< unsigned int Dim >
-	const double &Point< Dim >::operator[] ( int i ) const { return _p[i]; }
+	template< unsigned int Dim , typename Real >
+	const Real &Point< Dim , Real >::operator[] ( int i ) const { return _p[i]; }
 
-	template< unsigned int Dim >
-	Point< Dim >  Point< Dim >::operator * ( const Point &q ) const
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real >  Point< Dim , Real >::operator * ( const Point &q ) const
 	{
 		Point p;
 		for( int i=0 ; i<Dim ; i++ ) p[i] = _p[i]*q._p[i];
 		return p;
 	}
 
-	template< unsigned int Dim >
-	Point< Dim >  Point< Dim >::operator / ( const Point &q ) const
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real >  Point< Dim , Real >::operator / ( const Point &q ) const
 	{
 		Point p;
 		for( int i=0 ; i<Dim ; i++ ) p[i] = _p[i]/q._p[i];
 		return p;
 	}
 
-	template< unsigned int Dim >
-	Point< Dim > &Point< Dim >::operator *= ( const Point &q ){	return (*this) = (*this) * q; }
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > &Point< Dim , Real >::operator *= ( const Point &q ){	return (*this) = (*this) * q; }
 
-	template< unsigned int Dim >
-	Point< Dim > &Point< Dim >::operator /= ( const Point &q ){	return (*this) = (*this) / q; }
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > &Point< Dim , Real >::operator /= ( const Point &q ){	return (*this) = (*this) / q; }
 
-	template< unsigned int Dim >
+	template< unsigned int Dim , typename Real >
 	template< typename ... Points >
-	Point< Dim > Point< Dim >::CrossProduct( Points ... points )
+	Point< Dim , Real > Point< Dim , Real >::CrossProduct( Points ... points )
 	{
 		static_assert( sizeof ... ( points )==Dim-1 , "[ERROR] Number of points in cross-product must be one less than the dimension" );
-		const Point< Dim > _points[] = { points ... };
+		const Point< Dim , Real > _points[] = { points ... };
 		return CrossProduct( _points );
 	}
 
-	template< unsigned int Dim >
-	Point< Dim > Point< Dim >::CrossProduct( Point *points ){ return CrossProduct( (const Point *)points );}
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > Point< Dim , Real >::CrossProduct( Point *points ){ return CrossProduct( (const Point *)points );}
 
-	template< unsigned int Dim >
-	Point< Dim > Point< Dim >::CrossProduct( const Point *points )
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > Point< Dim , Real >::CrossProduct( const Point *points )
 	{
 		Matrix< Dim > M;
 		for( int d=0 ; d<Dim ; d++ ) for( int c=0 ; c<Dim-1 ; c++ ) M(d,c) = points[c][d];
@@ -123,15 +127,15 @@ namespace Util
 		return p;
 	}
 
-	template< unsigned int Dim >
-	std::ostream &operator << ( std::ostream &stream , const Point< Dim > &p )
+	template< unsigned int Dim , typename Real >
+	std::ostream &operator << ( std::ostream &stream , const Point< Dim , Real > &p )
 	{
 		for( int i=0 ; i<Dim-1 ; i++ ) stream << p[i] << " ";
 		stream << p[Dim-1];
 		return stream;
 	}
-	template< unsigned int Dim >
-	std::istream &operator >> ( std::istream &stream , Point< Dim > &p )
+	template< unsigned int Dim , typename Real >
+	std::istream &operator >> ( std::istream &stream , Point< Dim , Real > &p )
 	{
 		for( int i=0 ; i<Dim ; i++ ) stream >> p[i];
 		return stream;
@@ -404,26 +408,30 @@ namespace Util
 	/////////
 	// Ray //
 	/////////
-	template< unsigned int Dim >
-	Ray< Dim >::Ray( void ){}
+	template< unsigned int Dim , typename Real >
+	Ray< Dim , Real >::Ray( void ){}
 
-	template< unsigned int Dim >
-	Ray< Dim >::Ray( const Point< Dim > &p , const Point< Dim > &d ) : position(p) , direction(d) {}
+	template< unsigned int Dim , typename Real >
+	Ray< Dim , Real >::Ray( const Point< Dim , Real > &p , const Point< Dim , Real > &d ) : position(p) , direction(d) {}
 
-	template< unsigned int Dim >
-	Point< Dim > Ray< Dim >::operator() ( double s ) const { return position+direction*s; }
+	template< unsigned int Dim , typename Real >
+	template< typename _Real >
+	Ray< Dim , Real >::Ray( const Ray< Dim , _Real > &ray ) : position( ray.position ) , direction( ray.direction ) {}
 
-	template< unsigned int Dim >
-	Ray< Dim >  Ray< Dim >::operator +  ( const Point< Dim > &p ) const { return Ray( position+p , direction );}
+	template< unsigned int Dim , typename Real >
+	Point< Dim , Real > Ray< Dim , Real >::operator() ( double s ) const { return position+direction*s; }
 
-	template< unsigned int Dim >
-	Ray< Dim > &Ray< Dim >::operator += ( const Point< Dim > &p ){ position += p ; return *this; }
+	template< unsigned int Dim , typename Real >
+	Ray< Dim , Real >  Ray< Dim , Real >::operator +  ( const Point< Dim , Real > &p ) const { return Ray( position+p , direction );}
 
-	template< unsigned int Dim >
-	Ray< Dim >  Ray< Dim >::operator -  ( const Point< Dim > &p ) const { return Ray( position-p , direction );}
+	template< unsigned int Dim , typename Real >
+	Ray< Dim , Real > &Ray< Dim , Real >::operator += ( const Point< Dim , Real > &p ){ position += p ; return *this; }
 
-	template< unsigned int Dim >
-	Ray< Dim > &Ray< Dim >::operator -= ( const Point< Dim > &p ){ position -= p ; return *this; }
+	template< unsigned int Dim , typename Real >
+	Ray< Dim , Real >  Ray< Dim , Real >::operator -  ( const Point< Dim , Real > &p ) const { return Ray( position-p , direction );}
+
+	template< unsigned int Dim , typename Real >
+	Ray< Dim , Real > &Ray< Dim , Real >::operator -= ( const Point< Dim , Real > &p ){ position -= p ; return *this; }
 
 	template< unsigned int Dim >
 	Ray< Dim > operator * ( const Matrix< Dim+1 > &m , const Ray< Dim >& r )
@@ -251,6 +251,93 @@ namespace Util
 	/** A polynomial in four variable of degree Degree */
 	template< unsigned int Degree >
 	using Polynomial4D = Polynomial< 4 , Degree >;
+
+	///////////////////////
+	// RaySubstitution3D //
+	///////////////////////
+	/** This class restricts a polynomial in three variables to rays, returning the 1D polynomial in the ray's parameter.
+	* The coefficients are re-arranged once, when the class is constructed, so that the restriction (computed for every ray tested against an implicit surface)
+	* is evaluated in closed form rather than through the recursive templates of Polynomial::operator().
+	* The class is specialized for degrees 1, 2, and 4. Other degrees fall back on the generic substitution. */
+	template< unsigned int Degree >
+	class RaySubstitution3D
+	{
+		/** The polynomial */
+		Polynomial3D< Degree > _p;
+	public:
+		/** The default constructor restricts the zero polynomial */
+		RaySubstitution3D( void ){}
+
+		/** This constructor restricts the prescribed polynomial */
+		RaySubstitution3D( const Polynomial3D< Degree > &p ) : _p(p) {}
+
+		/** This method returns the 1D polynomial obtained by evaluating the polynomial along the ray.*/
+		Polynomial1D< Degree > operator()( const Ray3D &ray ) const { return _p( ray ); }
+	};
+
+	/** The linear polynomial g.x + c, restricted to the ray p + t*d, is (g.d) t + (g.p + c). */
+	template<>
+	class RaySubstitution3D< 1 >
+	{
+		/** The linear coefficients */
+		Point3D _linear;
+
+		/** The constant coefficient */
+		double _constant;
+	public:
+		/** The default constructor restricts the zero polynomial */
+		RaySubstitution3D( void );
+
+		/** This constructor restricts the prescribed polynomial */
+		RaySubstitution3D( const Polynomial3D< 1 > &p );
+
+		/** This method returns the 1D polynomial obtained by evaluating the polynomial along the ray.*/
+		Polynomial1D< 1 > operator()( const Ray3D &ray ) const;
+	};
+
+	/** The quadratic polynomial x^t A x + b.x + c, restricted to the ray p + t*d, is (d^t A d) t^2 + 2 d.(A p + b/2) t + (p.(A p + b) + c). */
+	template<>
+	class RaySubstitution3D< 2 >
+	{
+		/** The symmetric matrix of quadratic coefficients */
+		double _quadratic[3][3];
+
+		/** Half the linear coefficients */
+		Point3D _halfLinear;
+
+		/** The constant coefficient */
+		double _constant;
+	public:
+		/** The default constructor restricts the zero polynomial */
+		RaySubstitution3D( void );
+
+		/** This constructor restricts the prescribed polynomial */
+		RaySubstitution3D( const Polynomial3D< 2 > &p );
+
+		/** This method returns the 1D polynomial obtained by evaluating the polynomial along the ray.*/
+		Polynomial1D< 2 > operator()( const Ray3D &ray ) const;
+	};
+
+	/** The quartic polynomial is stored as a flat array of coefficients, indexed by the powers of x, y, and z.
+	* It is restricted to the ray with nested Horner schemes in z, y, and x, each multiplying a 1D polynomial by a linear one. */
+	template<>
+	class RaySubstitution3D< 4 >
+	{
+		/** The coefficients, with _coefficients[a][b][c] the coefficient of x^a y^b z^c (and zero for a+b+c>4) */
+		double _coefficients[5][5][5];
+
+		/** This method multiplies the 1D polynomial by p + t*d, dropping terms of degree higher than four */
+		static void _Multiply( double q[5] , double p , double d );
+	public:
+		/** The default constructor restricts the zero polynomial */
+		RaySubstitution3D( void );
+
+		/** This constructor restricts the prescribed polynomial */
+		RaySubstitution3D( const Polynomial3D< 4 > &p );
+
+		/** This method returns the 1D polynomial obtained by evaluating the polynomial along the ray.*/
+		Polynomial1D< 4 > operator()( const Ray3D &ray ) const;
+	};
 }
 #include "polynomial.inl"
 #endif // POLYNOMIAL_INCLUDED
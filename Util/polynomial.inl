@@ -453,4 +453,76 @@ namespace Util
 
 	template< unsigned int Dim , unsigned int Degree1 , unsigned int Degree2 >
 	Polynomial< Dim , Max< Degree1 , Degree2 >::Value > operator - ( const Polynomial< Dim , Degree1 > &p1 , const Polynomial< Dim , Degree2 > &p2 ){ return p1 + (-p2); }
+
+	///////////////////////
+	// RaySubstitution3D //
+	///////////////////////
+	inline RaySubstitution3D< 1 >::RaySubstitution3D( void ) : _constant(0) {}
+
+	inline RaySubstitution3D< 1 >::RaySubstitution3D( const Polynomial3D< 1 > &p )
+	{
+		_linear = Point3D( p.coefficient( 1u , 0u , 0u ) , p.coefficient( 0u , 1u , 0u ) , p.coefficient( 0u , 0u , 1u ) );
+		_constant = p.coefficient( 0u , 0u , 0u );
+	}
+
+	inline Polynomial1D< 1 > RaySubstitution3D< 1 >::operator()( const Ray3D &ray ) const
+	{
+		return Polynomial1D< 1 >( _linear.dot( ray.position ) + _constant , _linear.dot( ray.direction ) );
+	}
+
+	inline RaySubstitution3D< 2 >::RaySubstitution3D( void ) : _constant(0) { memset( _quadratic , 0 , sizeof( _quadratic ) ); }
+
+	inline RaySubstitution3D< 2 >::RaySubstitution3D( const Polynomial3D< 2 > &p )
+	{
+		// The off-diagonal coefficients are split evenly between the two symmetric entries
+		for( unsigned int i=0 ; i<3 ; i++ ) for( unsigned int j=0 ; j<3 ; j++ )
+		{
+			unsigned int e[] = { 0 , 0 , 0 };
+			e[i]++ , e[j]++;
+			_quadratic[i][j] = p.coefficient( e[0] , e[1] , e[2] ) * ( i==j ? 1. : 0.5 );
+		}
+		_halfLinear = Point3D( p.coefficient( 1u , 0u , 0u ) , p.coefficient( 0u , 1u , 0u ) , p.coefficient( 0u , 0u , 1u ) ) / 2;
+		_constant = p.coefficient( 0u , 0u , 0u );
+	}
+
+	inline Polynomial1D< 2 > RaySubstitution3D< 2 >::operator()( const Ray3D &ray ) const
+	{
+		Point3D Ap , Ad;
+		for( int i=0 ; i<3 ; i++ ) for( int j=0 ; j<3 ; j++ ) Ap[i] += _quadratic[i][j] * ray.position[j] , Ad[i] += _quadratic[i][j] * ray.direction[j];
+		const Point3D u = Ap + _halfLinear;
+		return Polynomial1D< 2 >( ray.position.dot( u + _halfLinear ) + _constant , 2. * ray.direction.dot( u ) , ray.direction.dot( Ad ) );
+	}
+
+	inline RaySubstitution3D< 4 >::RaySubstitution3D( void ) { memset( _coefficients , 0 , sizeof( _coefficients ) ); }
+
+	inline RaySubstitution3D< 4 >::RaySubstitution3D( const Polynomial3D< 4 > &p )
+	{
+		memset( _coefficients , 0 , sizeof( _coefficients ) );
+		for( unsigned int a=0 ; a<=4 ; a++ ) for( unsigned int b=0 ; a+b<=4 ; b++ ) for( unsigned int c=0 ; a+b+c<=4 ; c++ ) _coefficients[a][b][c] = p.coefficient( a , b , c );
+	}
+
+	inline void RaySubstitution3D< 4 >::_Multiply( double q[5] , double p , double d )
+	{
+		for( int k=4 ; k>0 ; k-- ) q[k] = q[k] * p + q[k-1] * d;
+		q[0] *= p;
+	}
+
+	inline Polynomial1D< 4 > RaySubstitution3D< 4 >::operator()( const Ray3D &ray ) const
+	{
+		double qx[] = { 0 , 0 , 0 , 0 , 0 };
+		for( int a=4 ; a>=0 ; a-- )
+		{
+			double qy[] = { 0 , 0 , 0 , 0 , 0 };
+			for( int b=4-a ; b>=0 ; b-- )
+			{
+				double qz[] = { 0 , 0 , 0 , 0 , 0 };
+				for( int c=4-a-b ; c>=0 ; c-- ) _Multiply( qz , ray.position[2] , ray.direction[2] ) , qz[0] += _coefficients[a][b][c];
+				_Multiply( qy , ray.position[1] , ray.direction[1] );
+				for( int k=0 ; k<=4 ; k++ ) qy[k] += qz[k];
+			}
+			_Multiply( qx , ray.position[0] , ray.direction[0] );
+			for( int k=0 ; k<=4 ; k++ ) qx[k] += qy[k];
+		}
+		return Polynomial1D< 4 >( qx[0] , qx[1] , qx[2] , qx[3] , qx[4] );
+	}
 }
\ No newline at end of file
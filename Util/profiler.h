@@ -0,0 +1,221 @@
+#ifndef PROFILER_INCLUDED
+#define PROFILER_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Util/exceptions.h>
+
+/** Profiling zones are compiled in for debug builds, and for release builds that define PROFILE (e.g. by building with "make PROFILE=1").
+  * Otherwise the PROFILE_ZONE macro expands to nothing, so release builds pay nothing for the instrumentation. */
+#if !defined( NDEBUG ) || defined( PROFILE )
+#define PROFILER_ENABLED
+#endif // !NDEBUG || PROFILE
+
+#define PROFILER_CONCATENATE_( a , b ) a ## b
+#define PROFILER_CONCATENATE( a , b ) PROFILER_CONCATENATE_( a , b )
+
+#ifdef PROFILER_ENABLED
+/** This macro times the rest of the enclosing scope as a zone with the prescribed name (which must be a string literal) */
+#define PROFILE_ZONE( name ) Util::Profiler::Zone PROFILER_CONCATENATE( _profilerZone , __LINE__ )( name )
+/** This macro is like PROFILE_ZONE, but the zone only counts towards the summary and is left out of the trace.
+  * It is meant for zones entered so often (e.g. once per ray) that they would flush everything else out of the ring buffers. */
+#define PROFILE_COUNT( name ) Util::Profiler::Zone PROFILER_CONCATENATE( _profilerZone , __LINE__ )( name , false )
+#else // !PROFILER_ENABLED
+#define PROFILE_ZONE( name )
+#define PROFILE_COUNT( name )
+#endif // PROFILER_ENABLED
+
+namespace Util
+{
+	/** This class records the zones (named scopes) entered by each thread while it is enabled.
+	  * Each thread appends the zones it closes to its own ring buffer, so recording takes no locks, and once a buffer is full the oldest zones are overwritten.
+	  * (The buffers grow as zones are added, so threads that close few zones do not pay for a full buffer.)
+	  * Running totals per zone name are kept alongside, so the summary covers every zone even if the trace does not.
+	  * Zones nest, and the trace is written out in Chrome's trace_event format (viewable in chrome://tracing or Perfetto), which shows the nesting per thread.
+	  * The buffers are read when the summary or trace is written, which should only be done once the other threads have closed their zones. */
+	class Profiler
+	{
+		/** A closed zone, with its start and duration in nanoseconds since the profiler's epoch */
+		struct _Event
+		{
+			const char *name;
+			long long start , duration;
+		};
+
+		/** The running totals of the zones with the same name */
+		struct _Total
+		{
+			size_t count;
+			long long duration;
+			_Total( void ) : count(0) , duration(0) {}
+		};
+
+		/** The zones closed by one thread */
+		struct _Buffer
+		{
+			/** The index of the thread, in the order in which threads first closed a zone */
+			unsigned int thread;
+
+			/** The ring of events (holding at most BufferSize of them), and the number of events ever added to it */
+			std::vector< _Event > events;
+			size_t eventNum;
+
+			/** The totals, indexed by the address of the (literal) name */
+			std::map< const char * , _Total > totals;
+
+			_Buffer( unsigned int thread ) : thread(thread) , eventNum(0) {}
+
+			void add( const _Event &event )
+			{
+				if( events.size()<BufferSize ) events.push_back( event );
+				else events[ eventNum % events.size() ] = event;
+				eventNum++;
+				addTotal( event.name , event.duration );
+			}
+
+			void addTotal( const char *name , long long duration )
+			{
+				_Total &total = totals[ name ];
+				total.count++ , total.duration += duration;
+			}
+		};
+
+		/** The buffers of all the threads that have closed a zone. They outlive their threads, so that the zones of finished threads are still written out. */
+		static std::vector< std::unique_ptr< _Buffer > > &_Buffers( void ){ static std::vector< std::unique_ptr< _Buffer > > buffers ; return buffers; }
+
+		/** The mutex guarding the list of buffers */
+		static std::mutex &_Mutex( void ){ static std::mutex mutex ; return mutex; }
+
+		/** The flag enabling the recording */
+		static std::atomic< bool > &_Enabled( void ){ static std::atomic< bool > enabled( false ) ; return enabled; }
+
+		/** This method returns the buffer of the calling thread, creating it the first time the thread closes a zone */
+		static _Buffer &_ThreadBuffer( void )
+		{
+			static thread_local _Buffer *buffer = NULL;
+			if( !buffer )
+			{
+				std::lock_guard< std::mutex > lock( _Mutex() );
+				_Buffers().emplace_back( new _Buffer( (unsigned int)_Buffers().size() ) );
+				buffer = _Buffers().back().get();
+			}
+			return *buffer;
+		}
+
+		/** This method returns the time, in nanoseconds, since the profiler's epoch */
+		static long long _Now( void )
+		{
+			static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now() - epoch ).count();
+		}
+
+		/** This method writes out the string with the characters that JSON requires to be escaped, escaped */
+		static void _WriteJSONString( std::ostream &stream , const char *str )
+		{
+			stream << "\"";
+			for( const char *c=str ; *c ; c++ )
+				if     ( *c=='"' || *c=='\\' ) stream << "\\" << *c;
+				else if( (unsigned char)*c<0x20 ) stream << " ";
+				else stream << *c;
+			stream << "\"";
+		}
+
+	public:
+		/** The number of zones each thread's ring buffer holds */
+		static const size_t BufferSize = 1<<18;
+
+		/** This class times the scope in which it lives, recording it with the profiler when it is destroyed (if the profiler was enabled when it was constructed).
+		  * Zones that are not traced only count towards the totals. */
+		class Zone
+		{
+			const char *_name;
+			long long _start;
+			bool _recording , _traced;
+		public:
+			Zone( const char *name , bool traced=true ) : _name(name) , _start(0) , _recording( _Enabled().load( std::memory_order_relaxed ) ) , _traced(traced){ if( _recording ) _start = _Now(); }
+			~Zone( void )
+			{
+				if( !_recording ) return;
+				if( !_traced ) _ThreadBuffer().addTotal( _name , _Now() - _start );
+				else
+				{
+					_Event event;
+					event.name = _name , event.start = _start , event.duration = _Now() - _start;
+					_ThreadBuffer().add( event );
+				}
+			}
+		};
+
+		/** This static method returns the number of zones that have been recorded in the trace */
+		static size_t ZoneNum( void )
+		{
+			std::lock_guard< std::mutex > lock( _Mutex() );
+			size_t count = 0;
+			for( size_t b=0 ; b<_Buffers().size() ; b++ ) count += _Buffers()[b]->eventNum;
+			return count;
+		}
+
+		/** These static methods enable / disable the recording of zones, and return whether it is enabled */
+		static void Enable( bool enabled )
+		{
+			_Now(); // Starts the epoch
+			_Enabled() = enabled;
+		}
+		static bool Enabled( void ){ return _Enabled(); }
+
+		/** This static method writes out the number of times each zone was entered, and the total (inclusive) time spent in it, summed over the threads */
+		static void WriteSummary( std::ostream &stream )
+		{
+			std::lock_guard< std::mutex > lock( _Mutex() );
+			std::map< std::string , _Total > totals;
+			for( size_t b=0 ; b<_Buffers().size() ; b++ ) for( auto iter=_Buffers()[b]->totals.begin() ; iter!=_Buffers()[b]->totals.end() ; iter++ )
+			{
+				_Total &total = totals[ iter->first ];
+				total.count += iter->second.count , total.duration += iter->second.duration;
+			}
+			std::vector< std::pair< std::string , _Total > > sorted( totals.begin() , totals.end() );
+			std::sort( sorted.begin() , sorted.end() , []( const std::pair< std::string , _Total > &t1 , const std::pair< std::string , _Total > &t2 ){ return t1.second.duration>t2.second.duration; } );
+			for( size_t i=0 ; i<sorted.size() ; i++ ) stream << "\t\t" << sorted[i].first << ": " << sorted[i].second.duration/1e9 << " seconds (" << sorted[i].second.count << " zones)" << std::endl;
+		}
+
+		/** This static method writes out the buffered zones in Chrome's trace_event JSON format, as complete ("X") events with times in microseconds */
+		static void WriteTrace( std::string fileName )
+		{
+			std::ofstream stream( fileName );
+			if( !stream ) THROW( "Failed to open file for writing: %s" , fileName.c_str() );
+
+			std::lock_guard< std::mutex > lock( _Mutex() );
+			size_t dropped = 0;
+			bool first = true;
+			stream << std::fixed;
+			stream.precision( 3 );
+			stream << "{\"traceEvents\":[" << std::endl;
+			for( size_t b=0 ; b<_Buffers().size() ; b++ )
+			{
+				const _Buffer &buffer = *_Buffers()[b];
+				size_t count = std::min< size_t >( buffer.eventNum , buffer.events.size() );
+				dropped += buffer.eventNum - count;
+				for( size_t e=buffer.eventNum-count ; e<buffer.eventNum ; e++ )
+				{
+					const _Event &event = buffer.events[ e % buffer.events.size() ];
+					if( !first ) stream << "," << std::endl;
+					first = false;
+					stream << "{\"name\":";
+					_WriteJSONString( stream , event.name );
+					stream << ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer.thread << ",\"ts\":" << event.start/1e3 << ",\"dur\":" << event.duration/1e3 << "}";
+				}
+			}
+			stream << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+			if( dropped ) WARN( "Ring buffers overflowed, %llu oldest zones are not in the trace" , (unsigned long long)dropped );
+		}
+	};
+}
+#endif // PROFILER_INCLUDED
@@ -0,0 +1,269 @@
+#include <cstring>
+#include <cstdlib>
+#include "socket.h"
+#include "exceptions.h"
+
+#if defined( _WIN32 ) || defined( _WIN64 )
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment( lib , "ws2_32.lib" )
+typedef int SocketLength;
+static const Util::SocketHandle InvalidHandle = (Util::SocketHandle)INVALID_SOCKET;
+static void CloseHandle( Util::SocketHandle handle ){ closesocket( (SOCKET)handle ); }
+#else // !_WIN32 && !_WIN64
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+typedef socklen_t SocketLength;
+static const Util::SocketHandle InvalidHandle = -1;
+static void CloseHandle( Util::SocketHandle handle ){ ::close( handle ); }
+#endif // _WIN32 || _WIN64
+
+#ifdef MSG_NOSIGNAL
+static const int SendFlags = MSG_NOSIGNAL;
+#else // !MSG_NOSIGNAL
+static const int SendFlags = 0;
+#endif // MSG_NOSIGNAL
+
+using namespace Util;
+
+/** This function initializes the socket library (once) */
+static void InitializeSockets( void )
+{
+#if defined( _WIN32 ) || defined( _WIN64 )
+	static bool initialized = false;
+	if( !initialized )
+	{
+		WSADATA wsaData;
+		if( WSAStartup( MAKEWORD( 2 , 2 ) , &wsaData ) ) THROW( "failed to initialize winsock" );
+		initialized = true;
+	}
+#endif // _WIN32 || _WIN64
+}
+
+/** This function configures a newly connected socket */
+static void ConfigureConnection( SocketHandle handle )
+{
+	int one = 1;
+	// Tile requests are small and latency-sensitive
+	setsockopt( handle , IPPROTO_TCP , TCP_NODELAY , (const char *)&one , sizeof(one) );
+#ifdef SO_NOSIGPIPE
+	setsockopt( handle , SOL_SOCKET , SO_NOSIGPIPE , (const char *)&one , sizeof(one) );
+#endif // SO_NOSIGPIPE
+}
+
+////////////
+// Socket //
+////////////
+Socket::Socket( void ) : _handle( InvalidHandle ) {}
+
+Socket::Socket( SocketHandle handle ) : _handle( handle ) {}
+
+Socket::Socket( Socket &&socket ) : _handle( socket._handle ){ socket._handle = InvalidHandle; }
+
+Socket &Socket::operator = ( Socket &&socket )
+{
+	if( this!=&socket )
+	{
+		close();
+		_handle = socket._handle;
+		socket._handle = InvalidHandle;
+	}
+	return *this;
+}
+
+Socket::~Socket( void ){ close(); }
+
+bool Socket::isValid( void ) const { return _handle!=InvalidHandle; }
+
+void Socket::close( void )
+{
+	if( _handle!=InvalidHandle ) CloseHandle( _handle );
+	_handle = InvalidHandle;
+}
+
+void Socket::setTimeout( double seconds )
+{
+	if( !isValid() ) return;
+#if defined( _WIN32 ) || defined( _WIN64 )
+	DWORD timeout = (DWORD)( seconds*1000 );
+#else // !_WIN32 && !_WIN64
+	struct timeval timeout;
+	timeout.tv_sec = (long)seconds;
+	timeout.tv_usec = (long)( ( seconds - timeout.tv_sec ) * 1e6 );
+#endif // _WIN32 || _WIN64
+	setsockopt( _handle , SOL_SOCKET , SO_RCVTIMEO , (const char *)&timeout , sizeof(timeout) );
+	setsockopt( _handle , SOL_SOCKET , SO_SNDTIMEO , (const char *)&timeout , sizeof(timeout) );
+}
+
+bool Socket::send( const void *data , size_t size )
+{
+	const char *_data = (const char *)data;
+	while( size && isValid() )
+	{
+		int sent = (int)::send( _handle , _data , (int)size , SendFlags );
+		if( sent<=0 ){ close() ; return false; }
+		_data += sent , size -= sent;
+	}
+	return isValid();
+}
+
+bool Socket::receive( void *data , size_t size )
+{
+	char *_data = (char *)data;
+	while( size && isValid() )
+	{
+		int received = (int)::recv( _handle , _data , (int)size , 0 );
+		if( received<=0 ){ close() ; return false; }
+		_data += received , size -= received;
+	}
+	return isValid();
+}
+
+bool Socket::sendUInt( uint32_t value )
+{
+	value = htonl( value );
+	return send( &value , sizeof(value) );
+}
+
+bool Socket::receiveUInt( uint32_t &value )
+{
+	if( !receive( &value , sizeof(value) ) ) return false;
+	value = ntohl( value );
+	return true;
+}
+
+bool Socket::sendUInt64( uint64_t value ){ return sendUInt( (uint32_t)( value>>32 ) ) && sendUInt( (uint32_t)( value & 0xffffffff ) ); }
+
+bool Socket::receiveUInt64( uint64_t &value )
+{
+	uint32_t high , low;
+	if( !receiveUInt( high ) || !receiveUInt( low ) ) return false;
+	value = ( (uint64_t)high<<32 ) | low;
+	return true;
+}
+
+bool Socket::sendDouble( double value )
+{
+	uint64_t bits;
+	memcpy( &bits , &value , sizeof(bits) );
+	return sendUInt64( bits );
+}
+
+bool Socket::receiveDouble( double &value )
+{
+	uint64_t bits;
+	if( !receiveUInt64( bits ) ) return false;
+	memcpy( &value , &bits , sizeof(value) );
+	return true;
+}
+
+bool Socket::sendString( const std::string &str ){ return send( str.c_str() , str.size() ); }
+
+bool Socket::receiveLine( std::string &line )
+{
+	line.clear();
+	char c;
+	while( receive( &c , 1 ) )
+	{
+		if( c=='\n' )
+		{
+			if( line.size() && line.back()=='\r' ) line.pop_back();
+			return true;
+		}
+		line.push_back( c );
+	}
+	return false;
+}
+
+Socket Socket::Connect( const std::string &host , int port )
+{
+	InitializeSockets();
+
+	struct addrinfo hints , *addresses = NULL;
+	memset( &hints , 0 , sizeof(hints) );
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	std::string service = std::to_string( port );
+	if( getaddrinfo( host.c_str() , service.c_str() , &hints , &addresses ) || !addresses ) THROW( "failed to resolve address: %s:%d" , host.c_str() , port );
+
+	SocketHandle handle = InvalidHandle;
+	for( struct addrinfo *a=addresses ; a ; a=a->ai_next )
+	{
+		handle = (SocketHandle)socket( a->ai_family , a->ai_socktype , a->ai_protocol );
+		if( handle==InvalidHandle ) continue;
+		if( !connect( handle , a->ai_addr , (SocketLength)a->ai_addrlen ) ) break;
+		CloseHandle( handle );
+		handle = InvalidHandle;
+	}
+	freeaddrinfo( addresses );
+	if( handle==InvalidHandle ) THROW( "failed to connect to: %s:%d" , host.c_str() , port );
+	ConfigureConnection( handle );
+	return Socket( handle );
+}
+
+//////////////////
+// ListenSocket //
+//////////////////
+ListenSocket::ListenSocket( int port , bool loopbackOnly ) : _handle( InvalidHandle ) , _port( port )
+{
+	InitializeSockets();
+
+	_handle = (SocketHandle)socket( AF_INET , SOCK_STREAM , 0 );
+	if( _handle==InvalidHandle ) THROW( "failed to create socket" );
+
+	int one = 1;
+	setsockopt( _handle , SOL_SOCKET , SO_REUSEADDR , (const char *)&one , sizeof(one) );
+
+	struct sockaddr_in address;
+	memset( &address , 0 , sizeof(address) );
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY );
+	address.sin_port = htons( (unsigned short)port );
+	if( bind( _handle , (struct sockaddr *)&address , sizeof(address) ) ){ CloseHandle( _handle ) ; THROW( "failed to bind to port: %d" , port ); }
+	if( listen( _handle , SOMAXCONN ) ){ CloseHandle( _handle ) ; THROW( "failed to listen on port: %d" , port ); }
+
+	SocketLength length = sizeof(address);
+	if( !getsockname( _handle , (struct sockaddr *)&address , &length ) ) _port = ntohs( address.sin_port );
+}
+
+ListenSocket::~ListenSocket( void ){ if( _handle!=InvalidHandle ) CloseHandle( _handle ); }
+
+int ListenSocket::port( void ) const { return _port; }
+
+bool ListenSocket::waitForConnection( double seconds ) const
+{
+	fd_set readSet;
+	FD_ZERO( &readSet );
+	FD_SET( _handle , &readSet );
+	struct timeval timeout;
+	timeout.tv_sec = (long)seconds;
+	timeout.tv_usec = (long)( ( seconds - timeout.tv_sec ) * 1e6 );
+	return select( (int)_handle+1 , &readSet , NULL , NULL , &timeout )>0;
+}
+
+Socket ListenSocket::accept( void ) const
+{
+	SocketHandle handle = (SocketHandle)::accept( _handle , NULL , NULL );
+	if( handle!=InvalidHandle ) ConfigureConnection( handle );
+	return Socket( handle );
+}
+
+namespace Util
+{
+	void ParseHostAndPort( const std::string &address , std::string &host , int &port )
+	{
+		size_t colon = address.rfind( ':' );
+		std::string _port = colon==std::string::npos ? address : address.substr( colon+1 );
+		host = colon==std::string::npos || !colon ? std::string( "localhost" ) : address.substr( 0 , colon );
+		char *end;
+		port = (int)strtol( _port.c_str() , &end , 10 );
+		if( _port.empty() || *end || port<0 || port>65535 ) THROW( "poorly formed address, expected <host>:<port>: %s" , address.c_str() );
+	}
+}
@@ -0,0 +1,123 @@
+#ifndef SOCKET_INCLUDED
+#define SOCKET_INCLUDED
+
+#include <string>
+#include <cstdint>
+
+namespace Util
+{
+#if defined( _WIN32 ) || defined( _WIN64 )
+	/** The type of the native socket handle (SOCKET) */
+	typedef uintptr_t SocketHandle;
+#else // !_WIN32 && !_WIN64
+	/** The type of the native socket handle (file descriptor) */
+	typedef int SocketHandle;
+#endif // _WIN32 || _WIN64
+
+	/** This class represents a connected, blocking, TCP socket.
+	*** The object owns the connection, which is closed in the destructor. It can be moved but not copied. */
+	class Socket
+	{
+		/** The native handle */
+		SocketHandle _handle;
+
+	public:
+		/** The default constructor creates an invalid (unconnected) socket */
+		Socket( void );
+
+		/** This constructor takes ownership of a native handle */
+		explicit Socket( SocketHandle handle );
+
+		/** The move constructor */
+		Socket( Socket &&socket );
+
+		/** The move assignment operator */
+		Socket &operator = ( Socket &&socket );
+
+		Socket( const Socket & ) = delete;
+		Socket &operator = ( const Socket & ) = delete;
+
+		/** The destructor closes the connection */
+		~Socket( void );
+
+		/** This method returns true if the socket is connected */
+		bool isValid( void ) const;
+
+		/** This method closes the connection */
+		void close( void );
+
+		/** This method sets the time (in seconds) after which blocking sends and receives fail. A value of zero disables the time-out. */
+		void setTimeout( double seconds );
+
+		/** This method sends the prescribed number of bytes, returning false if the connection failed. */
+		bool send( const void *data , size_t size );
+
+		/** This method receives exactly the prescribed number of bytes, returning false if the connection failed or was closed. */
+		bool receive( void *data , size_t size );
+
+		/** This method sends a 32-bit unsigned integer in network byte order. */
+		bool sendUInt( uint32_t value );
+
+		/** This method receives a 32-bit unsigned integer sent in network byte order. */
+		bool receiveUInt( uint32_t &value );
+
+		/** This method sends a 64-bit unsigned integer in network byte order. */
+		bool sendUInt64( uint64_t value );
+
+		/** This method receives a 64-bit unsigned integer sent in network byte order. */
+		bool receiveUInt64( uint64_t &value );
+
+		/** This method sends a double as its 64-bit IEEE representation. */
+		bool sendDouble( double value );
+
+		/** This method receives a double sent as its 64-bit IEEE representation. */
+		bool receiveDouble( double &value );
+
+		/** This method sends the characters of the string (without a terminating null). */
+		bool sendString( const std::string &str );
+
+		/** This method receives characters up to (and discarding) the next new-line, returning false if the connection failed or was closed.
+		*** A trailing carriage-return is also discarded. */
+		bool receiveLine( std::string &line );
+
+		/** This static method opens a connection to the prescribed host and port.
+		*** An exception is thrown if the connection cannot be established. */
+		static Socket Connect( const std::string &host , int port );
+	};
+
+	/** This class represents a TCP socket listening for incoming connections. */
+	class ListenSocket
+	{
+		/** The native handle */
+		SocketHandle _handle;
+
+		/** The port the socket is bound to */
+		int _port;
+
+	public:
+		/** This constructor binds the socket to the prescribed port and starts listening.
+		*** If the port is zero, the system chooses an available port. If loopbackOnly is set, only connections from the local machine are accepted.
+		*** An exception is thrown if the socket cannot be bound. */
+		ListenSocket( int port , bool loopbackOnly=false );
+
+		ListenSocket( const ListenSocket & ) = delete;
+		ListenSocket &operator = ( const ListenSocket & ) = delete;
+
+		/** The destructor stops listening */
+		~ListenSocket( void );
+
+		/** This method returns the port the socket is bound to */
+		int port( void ) const;
+
+		/** This method waits (at most the prescribed number of seconds) for an incoming connection, returning true if one is pending. */
+		bool waitForConnection( double seconds ) const;
+
+		/** This method accepts the next incoming connection, blocking until one arrives. */
+		Socket accept( void ) const;
+	};
+
+	/** This function splits a "host:port" string into its host and port.
+	*** If no host is given, "localhost" is used. An exception is thrown if the port cannot be parsed. */
+	void ParseHostAndPort( const std::string &address , std::string &host , int &port );
+}
+#endif // SOCKET_INCLUDED
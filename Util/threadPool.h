@@ -0,0 +1,186 @@
+#ifndef THREAD_POOL_INCLUDED
+#define THREAD_POOL_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Util
+{
+	/** This class runs tasks on a fixed set of worker threads, in the order in which they are submitted.
+	  * Threads waiting on a task through the pool help run the queued tasks, so tasks can be nested. */
+	class ThreadPool
+	{
+		/** The worker threads */
+		std::vector< std::thread > _workers;
+
+		/** The tasks waiting for a worker */
+		std::deque< std::function< void ( void ) > > _tasks;
+
+		/** The mutex guarding the tasks */
+		std::mutex _mutex;
+
+		/** The condition variable on which idle workers wait for tasks */
+		std::condition_variable _condition;
+
+		/** The condition variable on which threads waiting for a future sleep until a task is queued or completed */
+		std::condition_variable _waitCondition;
+
+		/** The number of threads sleeping on the wait condition */
+		unsigned int _waiterNum;
+
+		/** Set when the pool is being destroyed */
+		bool _stopping;
+
+		/** This method wakes the threads waiting for a future, so that they can check whether it has become ready */
+		void _notifyWaiters( void )
+		{
+			std::lock_guard< std::mutex > lock( _mutex );
+			if( _waiterNum ) _waitCondition.notify_all();
+		}
+
+		/** This method runs the next queued task on the calling thread, returning false if there was none */
+		bool _runTask( void )
+		{
+			std::function< void ( void ) > task;
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				if( _tasks.empty() ) return false;
+				task = std::move( _tasks.front() );
+				_tasks.pop_front();
+			}
+			task();
+			_notifyWaiters();
+			return true;
+		}
+
+		/** The function run by the workers, executing tasks until the pool is stopped and no tasks remain */
+		void _run( void )
+		{
+			while( true )
+			{
+				std::function< void ( void ) > task;
+				{
+					std::unique_lock< std::mutex > lock( _mutex );
+					_condition.wait( lock , [&]( void ){ return _stopping || !_tasks.empty(); } );
+					if( _tasks.empty() ) return;
+					task = std::move( _tasks.front() );
+					_tasks.pop_front();
+				}
+				task();
+				_notifyWaiters();
+			}
+		}
+
+	public:
+		/** The constructor starts the prescribed number of workers. If threadNum is zero, one worker is started per hardware thread. */
+		ThreadPool( unsigned int threadNum=0 ) : _waiterNum(0) , _stopping(false)
+		{
+			if( !threadNum ) threadNum = std::max< unsigned int >( 1 , std::thread::hardware_concurrency() );
+			for( unsigned int i=0 ; i<threadNum ; i++ ) _workers.emplace_back( [&]( void ){ _run(); } );
+		}
+
+		/** The destructor runs the tasks that are still queued and then stops the workers */
+		~ThreadPool( void )
+		{
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				_stopping = true;
+			}
+			_condition.notify_all();
+			for( size_t i=0 ; i<_workers.size() ; i++ ) _workers[i].join();
+		}
+
+		/** This method returns the number of workers */
+		unsigned int threadNum( void ) const { return (unsigned int)_workers.size(); }
+
+		/** This method queues the function and returns a future holding its result (or the exception it throws) */
+		template< typename Function >
+		std::future< decltype( std::declval< Function & >()() ) > submit( Function function )
+		{
+			typedef decltype( std::declval< Function & >()() ) Result;
+			std::shared_ptr< std::packaged_task< Result ( void ) > > task = std::make_shared< std::packaged_task< Result ( void ) > >( std::move( function ) );
+			std::future< Result > future = task->get_future();
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				_tasks.emplace_back( [task]( void ){ (*task)(); } );
+				if( _waiterNum ) _waitCondition.notify_all();
+			}
+			_condition.notify_one();
+			return future;
+		}
+
+		/** This method waits for the future, running queued tasks on the calling thread in the meantime, and sleeping when there are none.
+		  * Since a waiting thread keeps working, tasks may wait on the tasks they submit without exhausting the workers.
+		  * [WARNING] Tasks should wait through this method rather than calling get on the future directly, as a blocked task removes a worker from the pool. */
+		template< typename Result >
+		void wait( const std::future< Result > &future )
+		{
+			auto ready = [&]( void ){ return future.wait_for( std::chrono::seconds(0) )==std::future_status::ready; };
+			while( !ready() )
+			{
+				if( _runTask() ) continue;
+				// The future is set before the task completing it notifies the waiters, so checking it under the lock cannot miss the wake-up
+				std::unique_lock< std::mutex > lock( _mutex );
+				_waiterNum++;
+				_waitCondition.wait( lock , [&]( void ){ return !_tasks.empty() || ready(); } );
+				_waiterNum--;
+			}
+		}
+
+		/** This method calls the function on each index in [begin,end), and returns once all the calls have completed.
+		  * The range is split into contiguous chunks, one per task, with the first run on the calling thread.
+		  * If the pool already has enough queued tasks to keep the workers busy, the range is processed serially instead,
+		  * so that nested loops (e.g. over the levels of a scene-graph) only spawn tasks near the top. */
+		template< typename Function >
+		void parallelFor( size_t begin , size_t end , Function function )
+		{
+			const size_t maxTasks = 4 * _workers.size();
+			size_t chunkNum = std::min< size_t >( end>begin ? end-begin : 0 , maxTasks );
+			if( chunkNum>1 )
+			{
+				std::lock_guard< std::mutex > lock( _mutex );
+				if( _tasks.size()>=maxTasks ) chunkNum = 1;
+			}
+			if( chunkNum<=1 )
+			{
+				for( size_t i=begin ; i<end ; i++ ) function( i );
+				return;
+			}
+
+			auto chunk = [&]( size_t c ){ for( size_t i=begin+(end-begin)*c/chunkNum ; i<begin+(end-begin)*(c+1)/chunkNum ; i++ ) function( i ); };
+			std::vector< std::future< void > > futures;
+			futures.reserve( chunkNum-1 );
+			for( size_t c=1 ; c<chunkNum ; c++ ) futures.push_back( submit( [&chunk,c]( void ){ chunk(c); } ) );
+
+			// The tasks reference the locals, so all of them must complete before an exception is propagated
+			std::exception_ptr exception;
+			try{ chunk(0); }
+			catch( ... ){ exception = std::current_exception(); }
+			for( size_t c=0 ; c<futures.size() ; c++ )
+			{
+				wait( futures[c] );
+				try{ futures[c].get(); }
+				catch( ... ){ if( !exception ) exception = std::current_exception(); }
+			}
+			if( exception ) std::rethrow_exception( exception );
+		}
+
+		/** This static method returns the process-wide pool, with one worker per hardware thread */
+		static ThreadPool &Default( void )
+		{
+			static ThreadPool pool;
+			return pool;
+		}
+	};
+}
+#endif // THREAD_POOL_INCLUDED
@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <functional>
+#include <Util/cmdLineParser.h>
+#include <Util/timer.h>
+#include <Ray/scene.h>
+#include <Ray/box.h>
+#include <Ray/cone.h>
+#include <Ray/cylinder.h>
+#include <Ray/sphere.h>
+#include <Ray/torus.h>
+#include <Ray/triangle.h>
+#include <Ray/fileInstance.h>
+#include <Ray/directionalLight.h>
+#include <Ray/pointLight.h>
+#include <Ray/spotLight.h>
+#include <Ray/sphereLight.h>
+
+using namespace std;
+using namespace Ray;
+using namespace Util;
+using namespace Image;
+
+CmdLineParameter< string > OutputFile( "out" );
+CmdLineParameter< string > ChessFile( "chess" , "static3d/chess/scene.ray" );
+CmdLineParameter< int > ImageWidth( "width" , 320 );
+CmdLineParameter< int > ImageHeight( "height" , 240 );
+CmdLineParameter< int > RecursionLimit( "rLimit" , 5 );
+CmdLineParameter< float > CutOffThreshold( "cutOff" , 0.0001f );
+CmdLineParameter< int > LightSamples( "lSamples" , 16 );
+CmdLineParameter< int > MeshResolution( "meshResolution" , 724 );
+CmdLineParameter< int > KernelIterations( "iterations" , 1<<22 );
+CmdLineParameter< int > Repeat( "repeat" , 3 );
+CmdLineReadable NoKernels( "noKernels" ) , NoRenders( "noRenders" );
+
+CmdLineReadable* params[] =
+{
+	&OutputFile , &ChessFile , &ImageWidth , &ImageHeight , &RecursionLimit , &CutOffThreshold , &LightSamples ,
+	&MeshResolution , &KernelIterations , &Repeat , &NoKernels , &NoRenders ,
+	NULL
+};
+
+void ShowUsage( const string &ex )
+{
+	cout << "Usage " << ex << ":" << endl;
+	cout << "\t[--" << OutputFile.name << " <output JSON file>]" << endl;
+	cout << "\t[--" << ChessFile.name << " <chess scene>=" << ChessFile.value << "]" << endl;
+	cout << "\t[--" << ImageWidth.name << " <image width>=" << ImageWidth.value << "]" << endl;
+	cout << "\t[--" << ImageHeight.name << " <image height>=" << ImageHeight.value << "]" << endl;
+	cout << "\t[--" << RecursionLimit.name << " <recursion limit>=" << RecursionLimit.value << "]" << endl;
+	cout << "\t[--" << CutOffThreshold.name << " <cut-off threshold>=" << CutOffThreshold.value << "]" << endl;
+	cout << "\t[--" << LightSamples.name << " <light samples>=" << LightSamples.value << "]" << endl;
+	cout << "\t[--" << MeshResolution.name << " <generated mesh resolution>=" << MeshResolution.value << "]" << endl;
+	cout << "\t[--" << KernelIterations.name << " <kernel iterations>=" << KernelIterations.value << "]" << endl;
+	cout << "\t[--" << Repeat.name << " <kernel repetitions>=" << Repeat.value << "]" << endl;
+	cout << "\t[--" << NoKernels.name << "]" << endl;
+	cout << "\t[--" << NoRenders.name << "]" << endl;
+}
+
+/** The number of distinct inputs the kernels cycle through */
+const size_t KernelInputNum = 4096;
+
+/** This function returns a JSON string literal */
+string JSONString( const string &str )
+{
+	string s = "\"";
+	for( size_t i=0 ; i<str.size() ; i++ )
+		if     ( str[i]=='"' || str[i]=='\\' ) s += string( "\\" ) + str[i];
+		else if( str[i]=='\n' ) s += "\\n";
+		else if( (unsigned char)str[i]>=32 ) s += str[i];
+	return s + "\"";
+}
+
+/** This function generates rays starting outside a ball of radius 4 about the origin and aimed at the [-1.25,1.25]^3 cube, so that some miss the unit-sized kernel shapes */
+vector< Ray3D > KernelRays( void )
+{
+	mt19937 generator( 0 );
+	uniform_real_distribution< double > distribution( -1. , 1. );
+	vector< Ray3D > rays( KernelInputNum );
+	for( size_t i=0 ; i<rays.size() ; i++ )
+	{
+		Point3D p , q;
+		do p = Point3D( distribution( generator ) , distribution( generator ) , distribution( generator ) );
+		while( !p.squareNorm() || p.squareNorm()>1 );
+		p = p / p.length() * 4;
+		for( int d=0 ; d<3 ; d++ ) q[d] = distribution( generator ) * 1.25;
+		rays[i] = Ray3D( p , ( q-p ) / ( q-p ).length() );
+	}
+	return rays;
+}
+
+/** This function times the kernel over the prescribed number of iterations, taking the fastest of the repetitions, and returns the JSON record.
+*** The kernel is passed the index of the input it should use and returns true if it found an intersection. */
+string TimeKernel( const string &name , function< bool ( size_t ) > kernel , size_t iterations , int repeat )
+{
+	double seconds = Infinity;
+	size_t hits = 0;
+	for( int r=0 ; r<repeat ; r++ )
+	{
+		hits = 0;
+		Timer timer;
+		for( size_t i=0 ; i<iterations ; i++ ) if( kernel( i % KernelInputNum ) ) hits++;
+		seconds = std::min< double >( seconds , timer.elapsed() );
+	}
+	cerr << "\t" << name << ": " << seconds * 1e9 / iterations << " ns/intersection" << endl;
+
+	stringstream stream;
+	stream << "{ \"name\" : " << JSONString( name ) << " , \"intersections\" : " << iterations << " , \"seconds\" : " << seconds;
+	stream << " , \"nsPerIntersection\" : " << seconds * 1e9 / iterations << " , \"hitRate\" : " << (double)hits / iterations << " }";
+	return stream.str();
+}
+
+/** This function runs the kernel benchmarks and returns the JSON records */
+vector< string > KernelBenchmarks( size_t iterations , int repeat )
+{
+	vector< string > records;
+	vector< Ray3D > rays = KernelRays();
+
+	// The shapes only need a material and the vertices of the triangle
+	LocalSceneData data;
+	data.materials.resize( 1 );
+	data.vertices.resize( 3 );
+	data.vertices[0].position = Point3D( -1 , -1 , 0 );
+	data.vertices[1].position = Point3D(  1 , -1 , 0 );
+	data.vertices[2].position = Point3D(  0 ,  1 , 0 );
+	for( int i=0 ; i<3 ; i++ ) data.vertices[i].normal = Point3D( 0 , 0 , 1 );
+
+	// Sphere
+	{
+		Sphere sphere;
+		stringstream( "0  0 0 0  1" ) >> sphere;
+		sphere.init( data );
+		sphere.updateBoundingBox();
+		records.push_back( TimeKernel( "sphere" , [&]( size_t i ){ RayShapeIntersectionInfo iInfo ; return sphere.intersect( rays[i] , iInfo )<Infinity; } , iterations , repeat ) );
+	}
+
+	// Triangle
+	{
+		Triangle triangle;
+		stringstream( "0 1 2" ) >> triangle;
+		triangle.init( data );
+		triangle.updateBoundingBox();
+		records.push_back( TimeKernel( "triangle" , [&]( size_t i ){ RayShapeIntersectionInfo iInfo ; return triangle.intersect( rays[i] , iInfo )<Infinity; } , iterations , repeat ) );
+		Triangle::SinglePrecision = true;
+		records.push_back( TimeKernel( "triangleSinglePrecision" , [&]( size_t i ){ RayShapeIntersectionInfo iInfo ; return triangle.intersect( rays[i] , iInfo )<Infinity; } , iterations , repeat ) );
+		Triangle::SinglePrecision = false;
+	}
+
+	// Bounding-box slab test
+	{
+		ShapeBoundingBox bBox( BoundingBox3D( Point3D( -1 , -1 , -1 ) , Point3D( 1 , 1 , 1 ) ) );
+		records.push_back( TimeKernel( "boundingBox" , [&]( size_t i ){ return !bBox.intersect( rays[i] ).isEmpty(); } , iterations , repeat ) );
+
+		// The same test against rays whose inverse directions have already been computed
+		vector< SlabRay > slabRays;
+		for( size_t i=0 ; i<rays.size() ; i++ ) slabRays.push_back( SlabRay( rays[i] ) );
+		records.push_back( TimeKernel( "boundingBoxSlab" , [&]( size_t i ){ double tEntry , tExit ; return bBox.intersect( slabRays[i] , tEntry , tExit ); } , iterations , repeat ) );
+
+		// Four boxes (the octants of the cube above with z>0, shrunk) tested at once
+		BoundingBoxPacket packet;
+		for( int j=0 ; j<BoundingBoxPacket::Size ; j++ )
+		{
+			Point3D corner( (j&1) ? 0.1 : -1 , (j&2) ? 0.1 : -1 , 0.1 );
+			packet.set( j , BoundingBox3D( corner , corner + Point3D( 0.9 , 0.9 , 0.9 ) ) );
+		}
+		records.push_back( TimeKernel( "boundingBoxPacket" , [&]( size_t i ){ float tEntry[ BoundingBoxPacket::Size ] , tExit[ BoundingBoxPacket::Size ] ; return packet.intersect( slabRays[i] , tEntry , tExit )!=0; } , iterations , repeat ) );
+	}
+
+	// Quartic solve, on polynomials with random roots and (with probability one half) a pair of complex roots
+	{
+		mt19937 generator( 0 );
+		uniform_real_distribution< double > distribution( -1. , 1. );
+		vector< Polynomial1D< 4 > > quartics( KernelInputNum );
+		for( size_t i=0 ; i<quartics.size() ; i++ )
+		{
+			Polynomial1D< 4 > q( 1. );
+			for( int j=0 ; j<2 ; j++ )
+			{
+				double a = distribution( generator ) , b = distribution( generator );
+				// (x-a)^2 + b has real roots iff b<=0
+				q = q * Polynomial1D< 2 >( a*a + b , -2*a , 1. );
+			}
+			quartics[i] = q;
+		}
+		records.push_back( TimeKernel( "quarticSolve" , [&]( size_t i ){ double roots[4] ; return quartics[i].roots( roots )>0; } , iterations , repeat ) );
+	}
+
+	// Affine transformation of a sphere
+	{
+		StaticAffineShape affineShape;
+		stringstream( "0.8 0.6 0 0  -0.6 0.8 0 0  0 0 1.2 0  0.1 0.2 0 1\n#shape_sphere  0  0 0 0  1" ) >> affineShape;
+		affineShape.init( data );
+		affineShape.updateBoundingBox();
+		records.push_back( TimeKernel( "affineShape" , [&]( size_t i ){ RayShapeIntersectionInfo iInfo ; return affineShape.intersect( rays[i] , iInfo )<Infinity; } , iterations , repeat ) );
+	}
+	return records;
+}
+
+/** This function writes out a height-field mesh with 2 x resolution x resolution triangles.
+*** Since ShapeList intersection tests all of a list's children, the triangles are grouped into a quad-tree of nested shape lists. */
+void WriteMeshScene( ostream &stream , int resolution )
+{
+	stream << "#camera  0 7 11  0 -0.55 -0.835  0 0.835 -0.55  0.7" << endl;
+	stream << "#light_point  0.1 0.1 0.1  1 1 1  1 1 1  5 8 5  1 0 0" << endl;
+	stream << "#material  0 0 0  0.1 0.1 0.1  0.7 0.7 0.7  0.2 0.2 0.2 16  0 0 0  1  -1  !!" << endl;
+	for( int j=0 ; j<=resolution ; j++ ) for( int i=0 ; i<=resolution ; i++ )
+	{
+		double x = -8. + 16. * i / resolution , z = -8. + 16. * j / resolution;
+		stream << "#vertex  " << x << " " << 0.5 * sin( x*1.3 ) * cos( z*1.1 ) << " " << z << "  0 1 0  " << (double)i/resolution << " " << (double)j/resolution << endl;
+	}
+
+	function< void ( int , int , int , int ) > WriteCells = [&]( int i0 , int i1 , int j0 , int j1 )
+	{
+		stream << "#shape_list_begin" << endl;
+		if( (i1-i0)*(j1-j0)<=64 )
+			for( int j=j0 ; j<j1 ; j++ ) for( int i=i0 ; i<i1 ; i++ )
+			{
+				int a = j*(resolution+1) + i , b = a+1 , c = a+resolution+1 , d = c+1;
+				stream << "#shape_triangle  " << a << " " << c << " " << b << endl;
+				stream << "#shape_triangle  " << b << " " << c << " " << d << endl;
+			}
+		else
+		{
+			int iMid = (i0+i1)/2 , jMid = (j0+j1)/2;
+			if( i1-i0>1 && j1-j0>1 ) WriteCells( i0 , iMid , j0 , jMid ) , WriteCells( iMid , i1 , j0 , jMid ) , WriteCells( i0 , iMid , jMid , j1 ) , WriteCells( iMid , i1 , jMid , j1 );
+			else if( i1-i0>1 ) WriteCells( i0 , iMid , j0 , j1 ) , WriteCells( iMid , i1 , j0 , j1 );
+			else WriteCells( i0 , i1 , j0 , jMid ) , WriteCells( i0 , i1 , jMid , j1 );
+		}
+		stream << "#shape_list_end" << endl;
+	};
+	stream << "#shape_triangles  0" << endl;
+	WriteCells( 0 , resolution , 0 , resolution );
+}
+
+/** This function writes out a scene lit by 60 point lights and 4 sphere lights */
+void WriteManyLightScene( ostream &stream )
+{
+	stream << "#camera  0 6 14  0 -0.4 -0.917  0 0.917 -0.4  0.7" << endl;
+	for( int j=0 ; j<8 ; j++ ) for( int i=0 ; i<8 ; i++ )
+	{
+		double x = -7. + 2. * i , z = -7. + 2. * j;
+		if( (i%4) || (j%4) ) stream << "#light_point  0.01 0.01 0.01  0.05 0.05 0.05  0.05 0.05 0.05  " << x << " 6 " << z << "  1 0 0" << endl;
+		else          stream << "#light_sphere  0.01 0.01 0.01  0.05 0.05 0.05  0.05 0.05 0.05  " << x << " 6 " << z << "  0.5  1 0 0" << endl;
+	}
+	stream << "#material  0 0 0  0.1 0.1 0.1  0.8 0.3 0.3  0.5 0.5 0.5 32  0 0 0  1  -1  !!" << endl;
+	stream << "#material  0 0 0  0.1 0.1 0.1  0.7 0.7 0.7  0.2 0.2 0.2 16  0 0 0  1  -1  !!" << endl;
+	stream << "#vertex  -10 0 -10  0 1 0  0 0" << endl;
+	stream << "#vertex   10 0 -10  0 1 0  1 0" << endl;
+	stream << "#vertex   10 0  10  0 1 0  1 1" << endl;
+	stream << "#vertex  -10 0  10  0 1 0  0 1" << endl;
+	for( int j=0 ; j<5 ; j++ ) for( int i=0 ; i<5 ; i++ ) stream << "#shape_sphere  0  " << -6. + 3. * i << " 1 " << -6. + 3. * j << "  0.8" << endl;
+	stream << "#shape_triangles  1" << endl;
+	stream << "#shape_list_begin" << endl;
+	stream << "#shape_triangle  0 2 1" << endl;
+	stream << "#shape_triangle  0 3 2" << endl;
+	stream << "#shape_list_end" << endl;
+}
+
+/** This function reads in the scene and renders it, returning the JSON record.
+*** The scene is first rendered once, untimed, with every pixel guarded so that a scene using unsupported features is reported rather than terminating the benchmark. */
+string RenderBenchmark( const string &name , istream &istream , const string &baseDir , int width , int height , int rLimit , double cLimit , unsigned int lightSamples )
+{
+	stringstream stream;
+	stream << "{ \"name\" : " << JSONString( name ) << " , \"width\" : " << width << " , \"height\" : " << height;
+	try
+	{
+		Scene::BaseDir = baseDir;
+		Scene scene;
+		Timer timer;
+		istream >> scene;
+		double readSeconds = timer.elapsed();
+
+		// Warm up
+		scene.updateBoundingBox();
+		for( int j=0 ; j<height ; j++ ) for( int i=0 ; i<width ; i++ )
+			scene.getColor( scene.camera().getRay( i , height-j-1 , width , height ) , rLimit , Point3D( cLimit , cLimit , cLimit ) , lightSamples );
+
+		RayTracingStats::Reset();
+		timer.reset();
+		scene.rayTrace( width , height , rLimit , cLimit , lightSamples );
+		double seconds = timer.elapsed();
+		size_t rayNum = RayTracingStats::RayNum() , intersectionNum = RayTracingStats::RayPrimitiveIntersectionNum() + RayTracingStats::RayBoundingBoxIntersectionNum();
+		cerr << "\t" << name << ": " << rayNum / seconds << " rays/second" << endl;
+
+		stream << " , \"primitives\" : " << scene.primitiveNum() << " , \"readSeconds\" : " << readSeconds << " , \"seconds\" : " << seconds;
+		stream << " , \"rays\" : " << rayNum << " , \"raysPerSecond\" : " << rayNum / seconds;
+		stream << " , \"primitiveIntersections\" : " << RayTracingStats::RayPrimitiveIntersectionNum() << " , \"boundingBoxIntersections\" : " << RayTracingStats::RayBoundingBoxIntersectionNum();
+		stream << " , \"nsPerIntersection\" : " << ( intersectionNum ? seconds * 1e9 / intersectionNum : 0. ) << " }";
+	}
+	catch( const exception &e )
+	{
+		cerr << "\t" << name << ": failed" << endl << e.what() << endl;
+		stream << " , \"error\" : " << JSONString( e.what() ) << " }";
+	}
+	return stream.str();
+}
+
+int main( int argc , char *argv[] )
+{
+	CmdLineParse( argc-1 , argv+1 , params );
+	if( KernelIterations.value<=0 || Repeat.value<=0 || MeshResolution.value<=0 ){ ShowUsage( argv[0] ) ; return EXIT_FAILURE; }
+
+	ShapeList::ShapeFactories[ Box              ::Directive() ] = new DerivedFactory< Shape , Box >();
+	ShapeList::ShapeFactories[ Cone             ::Directive() ] = new DerivedFactory< Shape , Cone >();
+	ShapeList::ShapeFactories[ Cylinder         ::Directive() ] = new DerivedFactory< Shape , Cylinder >();
+	ShapeList::ShapeFactories[ Sphere           ::Directive() ] = new DerivedFactory< Shape , Sphere >();
+	ShapeList::ShapeFactories[ Torus            ::Directive() ] = new DerivedFactory< Shape , Torus >();
+	ShapeList::ShapeFactories[ Triangle         ::Directive() ] = new DerivedFactory< Shape , Triangle >();
+	ShapeList::ShapeFactories[ FileInstance     ::Directive() ] = new DerivedFactory< Shape , FileInstance >();
+	ShapeList::ShapeFactories[ ShapeList        ::Directive() ] = new DerivedFactory< Shape , ShapeList >();
+	ShapeList::ShapeFactories[ TriangleList     ::Directive() ] = new DerivedFactory< Shape , TriangleList >();
+	ShapeList::ShapeFactories[ StaticAffineShape::Directive() ] = new DerivedFactory< Shape , StaticAffineShape >();
+	ShapeList::ShapeFactories[ Union            ::Directive() ] = new DerivedFactory< Shape , Union >();
+	ShapeList::ShapeFactories[ Intersection     ::Directive() ] = new DerivedFactory< Shape , Intersection >();
+	ShapeList::ShapeFactories[ Difference       ::Directive() ] = new DerivedFactory< Shape , Difference >();
+
+	GlobalSceneData::LightFactories[ DirectionalLight::Directive() ] = new DerivedFactory< Light , DirectionalLight >();
+	GlobalSceneData::LightFactories[ PointLight      ::Directive() ] = new DerivedFactory< Light , PointLight >();
+	GlobalSceneData::LightFactories[ SpotLight       ::Directive() ] = new DerivedFactory< Light , SpotLight >();
+	GlobalSceneData::LightFactories[ SphereLight     ::Directive() ] = new DerivedFactory< Light , SphereLight >();
+
+	vector< string > kernels , renders;
+	if( !NoKernels.set )
+	{
+		cerr << "Kernels:" << endl;
+		kernels = KernelBenchmarks( KernelIterations.value , Repeat.value );
+	}
+	if( !NoRenders.set )
+	{
+		cerr << "Renders:" << endl;
+		{
+			ifstream istream( ChessFile.value );
+			if( !istream ) renders.push_back( "{ \"name\" : \"chess\" , \"error\" : " + JSONString( "Failed to open file for reading: " + ChessFile.value ) + " }" );
+			else renders.push_back( RenderBenchmark( "chess" , istream , GetFileDirectory( ChessFile.value ) , ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value ) );
+		}
+		{
+			stringstream stream;
+			WriteMeshScene( stream , MeshResolution.value );
+			renders.push_back( RenderBenchmark( "mesh" , stream , "." , ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value ) );
+		}
+		{
+			stringstream stream;
+			WriteManyLightScene( stream );
+			renders.push_back( RenderBenchmark( "manyLights" , stream , "." , ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value ) );
+		}
+	}
+
+	stringstream json;
+	json << "{" << endl;
+	json << "  \"kernels\" : [" << endl;
+	for( size_t i=0 ; i<kernels.size() ; i++ ) json << "    " << kernels[i] << ( i+1<kernels.size() ? " ," : "" ) << endl;
+	json << "  ] ," << endl;
+	json << "  \"renders\" : [" << endl;
+	for( size_t i=0 ; i<renders.size() ; i++ ) json << "    " << renders[i] << ( i+1<renders.size() ? " ," : "" ) << endl;
+	json << "  ]" << endl;
+	json << "}" << endl;
+
+	if( OutputFile.set )
+	{
+		ofstream ostream( OutputFile.value );
+		if( !ostream ){ cerr << "Failed to open file for writing: " << OutputFile.value << endl ; return EXIT_FAILURE; }
+		ostream << json.str();
+	}
+	else cout << json.str();
+
+	for( auto iter=ShapeList::ShapeFactories.begin() ; iter!=ShapeList::ShapeFactories.end() ; iter++ ) delete iter->second;
+	for( auto iter=GlobalSceneData::LightFactories.begin() ; iter!=GlobalSceneData::LightFactories.end() ; iter++ ) delete iter->second;
+
+	return EXIT_SUCCESS;
+}
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <Util/cmdLineParser.h>
 #include <Util/timer.h>
+#include <Util/profiler.h>
 #include <Ray/scene.h>
 #include <Ray/box.h>
 #include <Ray/cone.h>
@@ -11,11 +12,17 @@
 #include <Ray/sphere.h>
 #include <Ray/torus.h>
 #include <Ray/triangle.h>
+#include <Ray/outOfCoreMesh.h>
 #include <Ray/fileInstance.h>
 #include <Ray/directionalLight.h>
 #include <Ray/pointLight.h>
 #include <Ray/spotLight.h>
 #include <Ray/sphereLight.h>
+#include <Ray/renderFarm.h>
+#include <Ray/renderServer.h>
+#include <Ray/renderCheckpoint.h>
+#include <Ray/shadowDenoiser.h>
+#include <Util/socket.h>
 
 using namespace std;
 using namespace Ray;
@@ -31,11 +38,44 @@ CmdLineParameter< int > ImageHeight( "height" , 480 );
 CmdLineParameter< int > RecursionLimit( "rLimit" , 5 );
 CmdLineParameter< float > CutOffThreshold( "cutOff" , 0.0001f );
 CmdLineParameter< int > LightSamples( "lSamples" , 100 );
+CmdLineParameter< int > CoordinatorPort( "coordinator" , 0 );
+CmdLineParameter< string > WorkerAddress( "worker" );
+CmdLineParameter< int > TileSize( "tileSize" , 32 );
+CmdLineParameter< float > FarmTimeOut( "farmTimeOut" , 60.f );
+CmdLineParameter< int > ServerPort( "server" , 0 );
+CmdLineParameter< string > CheckpointFile( "checkpoint" );
+CmdLineParameter< float > CheckpointInterval( "checkpointInterval" , 60.f );
+CmdLineReadable Resume( "resume" );
+CmdLineReadable HeatMap( "heatMap" );
+CmdLineReadable SinglePrecision( "singlePrecision" );
+CmdLineParameter< float > GeomBudget( "geomBudget" );
+CmdLineParameter< string > GeomDir( "geomDir" );
+CmdLineParameter< int > ClusterSize( "clusterSize" , (int)OutOfCoreMesh::ClusterSize );
+CmdLineReadable Denoise( "denoise" );
+CmdLineParameter< int > DenoiseIterations( "denoiseIterations" , 5 );
+CmdLineReadable AuxBuffers( "auxBuffers" );
+CmdLineReadable AdaptiveLightSamples( "adaptive" );
+CmdLineParameter< int > InitialLightSamples( "lInitialSamples" , (int)SphereLight::InitialSamples );
+CmdLineParameter< int > LightSampleBudget( "lBudget" , 0 );
+CmdLineParameter< float > RouletteThreshold( "roulette" , 1.f/32 );
+CmdLineParameter< float > ContributionCutOff( "contributionCutOff" , 0.5f/255 );
+CmdLineReadable FrustumCull( "cull" );
+CmdLineReadable FlattenTransforms( "flatten" );
+CmdLineReadable StreamOutput( "stream" );
+CmdLineParameter< string > ProfileFile( "profile" );
 
 
 CmdLineReadable* params[] =
 {
 	&InputRayFile , &OutputImageFile , &ImageWidth , &ImageHeight , &RecursionLimit , &CutOffThreshold , &LightSamples ,
+	&CoordinatorPort , &WorkerAddress , &TileSize , &FarmTimeOut , &ServerPort ,
+	&CheckpointFile , &CheckpointInterval , &Resume ,
+	&HeatMap , &SinglePrecision ,
+	&GeomBudget , &GeomDir , &ClusterSize ,
+	&Denoise , &DenoiseIterations , &AuxBuffers ,
+	&AdaptiveLightSamples , &InitialLightSamples , &LightSampleBudget ,
+	&RouletteThreshold , &ContributionCutOff , &FrustumCull , &FlattenTransforms ,
+	&StreamOutput , &ProfileFile ,
 	NULL
 };
 
@@ -49,6 +89,31 @@ void ShowUsage( const string &ex )
 	cout << "\t[--" << RecursionLimit.name << " <recursion limit>=" << RecursionLimit.value << "]" << endl;
 	cout << "\t[--" << CutOffThreshold.name << " <cut-off threshold>=" << CutOffThreshold.value << "]" << endl;
 	cout << "\t[--" << LightSamples.name << " <light samples>=" << LightSamples.value << "]" << endl;
+	cout << "\t[--" << CoordinatorPort.name << " <port on which to hand out tiles to workers>]" << endl;
+	cout << "\t[--" << WorkerAddress.name << " <coordinator host:port from which to receive tiles>]" << endl;
+	cout << "\t[--" << TileSize.name << " <render farm tile size>=" << TileSize.value << "]" << endl;
+	cout << "\t[--" << FarmTimeOut.name << " <seconds before an unresponsive worker is dropped>=" << FarmTimeOut.value << "]" << endl;
+	cout << "\t[--" << ServerPort.name << " <port on which to serve render requests>]" << endl;
+	cout << "\t[--" << CheckpointFile.name << " <file to which completed tiles are periodically saved>]" << endl;
+	cout << "\t[--" << CheckpointInterval.name << " <seconds between checkpoints>=" << CheckpointInterval.value << "]" << endl;
+	cout << "\t[--" << Resume.name << "]" << endl;
+	cout << "\t[--" << HeatMap.name << "]" << endl;
+	cout << "\t[--" << SinglePrecision.name << "]" << endl;
+	cout << "\t[--" << GeomBudget.name << " <megabytes of triangle-mesh geometry kept in memory>]" << endl;
+	cout << "\t[--" << GeomDir.name << " <directory in which out-of-core geometry is stored>]" << endl;
+	cout << "\t[--" << ClusterSize.name << " <triangles per out-of-core cluster>=" << ClusterSize.value << "]" << endl;
+	cout << "\t[--" << Denoise.name << "]" << endl;
+	cout << "\t[--" << DenoiseIterations.name << " <shadow denoiser passes>=" << DenoiseIterations.value << "]" << endl;
+	cout << "\t[--" << AuxBuffers.name << "]" << endl;
+	cout << "\t[--" << AdaptiveLightSamples.name << "]" << endl;
+	cout << "\t[--" << InitialLightSamples.name << " <initial light samples when sampling adaptively>=" << InitialLightSamples.value << "]" << endl;
+	cout << "\t[--" << LightSampleBudget.name << " <additional light samples per frame when sampling adaptively (0 for no limit)>=" << LightSampleBudget.value << "]" << endl;
+	cout << "\t[--" << RouletteThreshold.name << " <contribution below which secondary rays are subject to Russian roulette>=" << RouletteThreshold.value << "]" << endl;
+	cout << "\t[--" << ContributionCutOff.name << " <contribution below which secondary rays are skipped>=" << ContributionCutOff.value << "]" << endl;
+	cout << "\t[--" << FrustumCull.name << "]" << endl;
+	cout << "\t[--" << FlattenTransforms.name << "]" << endl;
+	cout << "\t[--" << StreamOutput.name << " (write the output image out in bands of " << TileSize.name << " rows, as they are traced)]" << endl;
+	cout << "\t[--" << ProfileFile.name << " <output Chrome trace file>]" << endl;
 }
 
 /** A wrapper class for size_t that prints out comma-separated numbers */
@@ -87,6 +152,18 @@ int main( int argc , char *argv[] )
 {
 	CmdLineParse( argc-1 , argv+1 , params );
 	if( !InputRayFile.set ){ ShowUsage( argv[0] ) ; return EXIT_FAILURE; }
+	Triangle::SinglePrecision = SinglePrecision.set;
+	SphereLight::Adaptive = AdaptiveLightSamples.set;
+	SphereLight::InitialSamples = std::max< int >( InitialLightSamples.value , 1 );
+	SphereLight::SampleBudget = std::max< int >( LightSampleBudget.value , 0 );
+	Scene::CullPrimaryRays = FrustumCull.set;
+	Scene::FlattenTransforms = FlattenTransforms.set;
+	// Contribution-based termination is opt-in, since it changes the (otherwise deterministic) set of rays traced
+	if( RouletteThreshold.set || ContributionCutOff.set )
+	{
+		Scene::RouletteThreshold = RouletteThreshold.set ? RouletteThreshold.value : 0;
+		Scene::ContributionCutOff = ContributionCutOff.value;
+	}
 
 	Scene::BaseDir = GetFileDirectory( InputRayFile.value );
 	Scene scene;
@@ -105,6 +182,19 @@ int main( int argc , char *argv[] )
 		ShapeList::ShapeFactories[ Union            ::Directive() ] = new DerivedFactory< Shape , Union >();
 		ShapeList::ShapeFactories[ Intersection     ::Directive() ] = new DerivedFactory< Shape , Intersection >();
 		ShapeList::ShapeFactories[ Difference       ::Directive() ] = new DerivedFactory< Shape , Difference >();
+		// With a geometry budget, triangle meshes are kept on disk and paged in as rays reach them
+		if( GeomBudget.set )
+		{
+			if( GeomBudget.value<=0 ) THROW( "Geometry budget must be positive: %g" , GeomBudget.value );
+			if( ClusterSize.value<=0 ) THROW( "Cluster size must be positive: %d" , ClusterSize.value );
+			delete ShapeList::ShapeFactories[ TriangleList::Directive() ];
+			ShapeList::ShapeFactories[ OutOfCoreMesh::Directive() ] = new DerivedFactory< Shape , OutOfCoreMesh >();
+			ClusterCache::Budget = (size_t)( GeomBudget.value * (1<<20) );
+			OutOfCoreMesh::ClusterSize = ClusterSize.value;
+			if( GeomDir.set ) OutOfCoreMesh::Directory = GeomDir.value;
+			Scene::BatchPrimaryRays = true;
+			if( FrustumCull.set ) WARN( "Primary rays are not frustum-culled when tracing them in batches" );
+		}
 
 		GlobalSceneData::LightFactories[ DirectionalLight::Directive() ] = new DerivedFactory< Light , DirectionalLight >();
 		GlobalSceneData::LightFactories[ PointLight      ::Directive() ] = new DerivedFactory< Light , PointLight >();
@@ -115,21 +205,117 @@ int main( int argc , char *argv[] )
 		istream.open( InputRayFile.value );
 		if( !istream ) THROW( "Failed to open file for reading: %s\n" , InputRayFile.value.c_str() );
 
+		if( ProfileFile.set ) Profiler::Enable( true );
+
 		Timer timer;
 		istream >> scene;
 		std::cout << "\tRead: " << timer.elapsed() << " seconds" << std::endl;
 
-		timer.reset();
-		RayTracingStats::Reset();
-		Image32 img = scene.rayTrace( ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value );
-		std::cout << "\tRay-traced: " << timer.elapsed() << " seconds" << std::endl;
-		std::cout << "\tPixels: " << Size_t( ImageWidth.value ) << " x " << Size_t( ImageHeight.value ) << std::endl;
-		std::cout << "\tPrimitives: " << Size_t( scene.primitiveNum() ) << std::endl;
-		std::cout << "\tRays: " << Size_t( RayTracingStats::RayNum() ) << " (" << (double)RayTracingStats::RayNum()/(ImageWidth.value*ImageHeight.value) << " rays/pixel)" << std::endl;
-		std::cout << "\tPrimitive intersections: " << Size_t( RayTracingStats::RayPrimitiveIntersectionNum() ) << " (" << (double)RayTracingStats::RayPrimitiveIntersectionNum()/RayTracingStats::RayNum() << " intersections/ray)" << std::endl;
-		std::cout << "\tBounding-box intersections: " << Size_t( RayTracingStats::RayBoundingBoxIntersectionNum() ) << " (" << (double)RayTracingStats::RayBoundingBoxIntersectionNum()/RayTracingStats::RayNum() << " intersections/ray)" << std::endl;
-
-		if( OutputImageFile.set ) img.write( OutputImageFile.value );
+		if( ServerPort.set )
+		{
+			size_t requestNum = RenderServer::Serve( scene , ServerPort.value );
+			std::cout << "\tRequests: " << Size_t( requestNum ) << std::endl;
+		}
+		else if( WorkerAddress.set )
+		{
+			string host;
+			int port;
+			ParseHostAndPort( WorkerAddress.value , host , port );
+			timer.reset();
+			size_t tileNum = RenderFarm::Work( scene , host , port );
+			std::cout << "\tRay-traced: " << timer.elapsed() << " seconds" << std::endl;
+			std::cout << "\tTiles: " << Size_t( tileNum ) << std::endl;
+		}
+		else
+		{
+			Image32 img;
+			bool streamed = false;
+			timer.reset();
+			if( CoordinatorPort.set )
+			{
+				img = RenderFarm::Coordinate( scene , CoordinatorPort.value , ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value , TileSize.value , FarmTimeOut.value );
+				std::cout << "\tRay-traced: " << timer.elapsed() << " seconds" << std::endl;
+				std::cout << "\tPixels: " << Size_t( ImageWidth.value ) << " x " << Size_t( ImageHeight.value ) << std::endl;
+			}
+			else
+			{
+				RayTracingStats::Reset();
+				ShadowDenoiser denoiser;
+				denoiser.iterations = DenoiseIterations.value;
+				ShadowDenoiser *_denoiser = ( Denoise.set || AuxBuffers.set ) ? &denoiser : NULL;
+				if( StreamOutput.set && ( CheckpointFile.set || HeatMap.set || _denoiser ) ) WARN( "Output is not streamed when checkpointing, recording heat maps, or denoising" );
+				else if( StreamOutput.set && !OutputImageFile.set ) WARN( "Output is only streamed to an output image" );
+				if( CheckpointFile.set )
+				{
+					if( HeatMap.set ) WARN( "Heat maps are not recorded when checkpointing" );
+					if( _denoiser ) WARN( "Shadows are not denoised when checkpointing" );
+					RenderCheckpoint checkpoint( scene , ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value , TileSize.value );
+					if( Resume.set )
+					{
+						if( checkpoint.read( CheckpointFile.value ) ) std::cout << "\tResumed: " << Size_t( checkpoint.completedNum() ) << " tiles" << std::endl;
+						else WARN( "No checkpoint to resume from: %s" , CheckpointFile.value.c_str() );
+					}
+					checkpoint.rayTrace( scene , CheckpointFile.value , CheckpointInterval.value );
+					img = checkpoint.image();
+				}
+				else if( HeatMap.set )
+				{
+					RenderCostMap costMap;
+					img = scene.rayTrace( ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value , &costMap , _denoiser );
+					if( OutputImageFile.set ) costMap.write( OutputImageFile.value );
+					else WARN( "Heat maps are only written alongside an output image" );
+				}
+				else if( StreamOutput.set && OutputImageFile.set && !_denoiser )
+				{
+					std::unique_ptr< ImageWriter > writer = ImageWriter::Get( OutputImageFile.value , ImageWidth.value , ImageHeight.value );
+					scene.rayTrace( ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value , *writer , TileSize.value );
+					streamed = true;
+				}
+				else img = scene.rayTrace( ImageWidth.value , ImageHeight.value , RecursionLimit.value , CutOffThreshold.value , LightSamples.value , NULL , _denoiser );
+				std::cout << "\tRay-traced: " << timer.elapsed() << " seconds" << std::endl;
+				if( _denoiser && !CheckpointFile.set )
+				{
+					if( AuxBuffers.set )
+					{
+						if( OutputImageFile.set ) denoiser.write( OutputImageFile.value );
+						else WARN( "Auxiliary buffers are only written alongside an output image" );
+					}
+					if( Denoise.set )
+					{
+						timer.reset();
+						img = denoiser.denoise( img );
+						std::cout << "\tDenoised: " << timer.elapsed() << " seconds" << std::endl;
+					}
+				}
+				std::cout << "\tPixels: " << Size_t( ImageWidth.value ) << " x " << Size_t( ImageHeight.value ) << std::endl;
+				std::cout << "\tPrimitives: " << Size_t( scene.primitiveNum() ) << std::endl;
+				std::cout << "\tRays: " << Size_t( RayTracingStats::RayNum() ) << " (" << (double)RayTracingStats::RayNum()/(ImageWidth.value*ImageHeight.value) << " rays/pixel)" << std::endl;
+				std::cout << "\tPrimitive intersections: " << Size_t( RayTracingStats::RayPrimitiveIntersectionNum() ) << " (" << (double)RayTracingStats::RayPrimitiveIntersectionNum()/RayTracingStats::RayNum() << " intersections/ray)" << std::endl;
+				std::cout << "\tBounding-box intersections: " << Size_t( RayTracingStats::RayBoundingBoxIntersectionNum() ) << " (" << (double)RayTracingStats::RayBoundingBoxIntersectionNum()/RayTracingStats::RayNum() << " intersections/ray)" << std::endl;
+				if( GeomBudget.set )
+				{
+					std::cout << "\tGeometry page-ins: " << Size_t( ClusterCache::PageInNum() ) << " (" << ClusterCache::BytesRead()/(double)(1<<20) << " MB read)" << std::endl;
+					std::cout << "\tGeometry cache hits: " << Size_t( ClusterCache::HitNum() ) << std::endl;
+				}
+			}
+			if( OutputImageFile.set && !streamed ) img.write( OutputImageFile.value );
+			// The checkpoint is only discarded once the image is safely written out
+			if( CheckpointFile.set && OutputImageFile.set ) remove( CheckpointFile.value.c_str() );
+		}
+
+		// The rendered image has been released by now, so its pixels only show in the peak
+		MemoryStats memory = scene.memoryStats();
+		std::cout << "\tMemory: " << memory.total()/(double)(1<<20) << " MB" << std::endl;
+		for( int c=0 ; c<MemoryStats::CATEGORY_NUM ; c++ ) std::cout << "\t\t" << MemoryStats::CategoryNames[c] << ": " << memory.bytes[c]/(double)(1<<20) << " MB" << std::endl;
+		std::cout << "\tPeak image memory: " << Image32::PeakAllocatedBytes()/(double)(1<<20) << " MB" << std::endl;
+
+		if( ProfileFile.set )
+		{
+			if( !Profiler::ZoneNum() ) WARN( "No zones were recorded (they are compiled out of release builds unless PROFILE is defined)" );
+			std::cout << "\tProfile:" << std::endl;
+			Profiler::WriteSummary( std::cout );
+			Profiler::WriteTrace( ProfileFile.value );
+		}
 	}
 	catch( const exception &e )
 	{